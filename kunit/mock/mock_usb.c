@@ -66,6 +66,18 @@ void usb_deregister(struct usb_driver *driver)
 {
 }
 
+/* dispatch as the rx bulk callback does, with the payload viewed in place */
+static void mock_dispatch_msg(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_t *msg)
+{
+	apt_usbtrx_msg_view_t view = {
+		.id = msg->id,
+		.payload_size = msg->payload_size,
+		.payload = msg->payload,
+	};
+
+	apt_usbtrx_dispatch_msg(dev, data, &view);
+}
+
 /* drivers/usb/core/message.c */
 int usb_bulk_msg(struct usb_device *usb_dev, unsigned int pipe, void *data, int len, int *actual_length, int timeout)
 {
@@ -82,7 +94,7 @@ int usb_bulk_msg(struct usb_device *usb_dev, unsigned int pipe, void *data, int
 		build_response_get_status(&resp_data, &msg);
 
 		/* proc interrupt context */
-		apt_usbtrx_dispatch_msg(dev, (u8 *)&resp_data, &msg);
+		mock_dispatch_msg(dev, (u8 *)&resp_data, &msg);
 		break;
 	}
 	case EP1_CH02A_CMD_GetStatus: {
@@ -91,7 +103,7 @@ int usb_bulk_msg(struct usb_device *usb_dev, unsigned int pipe, void *data, int
 		build_response_ep1_ch02a_get_status(&resp_data, &msg);
 
 		/* proc interrupt context */
-		apt_usbtrx_dispatch_msg(dev, (u8 *)&resp_data, &msg);
+		mock_dispatch_msg(dev, (u8 *)&resp_data, &msg);
 		break;
 	}
 	case EP1_CH02A_CMD_SetBitTiming: {
@@ -107,7 +119,7 @@ int usb_bulk_msg(struct usb_device *usb_dev, unsigned int pipe, void *data, int
 		mock_request_ep1_ch02a_set_bit_timing(data, len);
 
 		/* proc interrupt context */
-		apt_usbtrx_dispatch_msg(dev, (u8 *)&ack, &msg);
+		mock_dispatch_msg(dev, (u8 *)&ack, &msg);
 		break;
 	}
 	case EP1_CH02A_CMD_GetBitTiming: {
@@ -116,7 +128,7 @@ int usb_bulk_msg(struct usb_device *usb_dev, unsigned int pipe, void *data, int
 		build_response_ep1_ch02a_get_bit_timing(&resp_data, &msg);
 
 		/* proc interrupt context */
-		apt_usbtrx_dispatch_msg(dev, (u8 *)&resp_data, &msg);
+		mock_dispatch_msg(dev, (u8 *)&resp_data, &msg);
 		break;
 	}
 	}
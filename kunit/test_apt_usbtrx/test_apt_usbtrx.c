@@ -5,6 +5,7 @@
 #include <kunit/test.h>
 
 #include "test_apt_usbtrx.h"
+#include "test_apt_usbtrx_clock.h"
 #include "test_ep1_ag08a.h"
 #include "test_ep1_ch02a.h"
 
@@ -107,7 +108,7 @@ void fake_dev_terminate(struct kunit *test, apt_usbtrx_dev_t *dev)
 }
 
 static void _build_data_and_message(struct kunit *test, u8 cmd, u8 *payload, u8 payload_size, void *data,
-				    apt_usbtrx_msg_t *msg)
+				    apt_usbtrx_msg_view_t *msg)
 {
 	struct msg_header *header = (struct msg_header *)data;
 	u8 *data_payload = (u8 *)data + sizeof(struct msg_header);
@@ -129,13 +130,13 @@ static void _build_data_and_message(struct kunit *test, u8 cmd, u8 *payload, u8
 
 	/* build msg */
 	msg->id = cmd;
-	memcpy(msg->payload, payload, payload_size);
+	msg->payload = data_payload;
 	msg->payload_size = payload_size;
 }
 
 int send_message(struct kunit *test, apt_usbtrx_dev_t *dev, u8 cmd_id, u8 *payload, size_t payload_size)
 {
-	apt_usbtrx_msg_t msg;
+	apt_usbtrx_msg_view_t msg;
 	int result;
 
 	const size_t data_size = sizeof(struct msg_header) + payload_size + sizeof(struct msg_footer);
@@ -237,9 +238,19 @@ static void apt_usbtrx_test_exit(struct kunit *test)
 }
 
 static struct kunit_case apt_usbtrx_test_cases[] = {
+	// clock estimator
+	KUNIT_CASE(test_apt_usbtrx_clock_fit),
+	KUNIT_CASE(test_apt_usbtrx_clock_reject_skew),
+	KUNIT_CASE(test_apt_usbtrx_clock_reset_on_backward),
+	KUNIT_CASE(test_apt_usbtrx_clock_max_span),
 	// EP1-AG08A
 	KUNIT_CASE(test_ep1_ag08a_dispatch_msg_notify_analog_input),
+	KUNIT_CASE(test_ep1_ag08a_read_whole_frames),
+	KUNIT_CASE(test_ep1_ag08a_rx_overflow_marker),
+	KUNIT_CASE(test_ep1_ag08a_rx_capture_flight_recorder),
 	KUNIT_CASE(test_ep1_ag08a_dispatch_msg_invalid_id),
+	KUNIT_CASE(test_ep1_ag08a_rx_resync_garbage),
+	KUNIT_CASE(test_ep1_ag08a_rx_resync_truncated_header),
 	KUNIT_CASE(test_ep1_ag08a_ioctl_get_status),
 	KUNIT_CASE(test_ep1_ag08a_ioctl_invalid_cmd),
 	// EP1-CH02A
@@ -0,0 +1,147 @@
+/*!
+ * Copyright (C) 2020 aptpod Inc.
+ */
+
+#include <kunit/test.h>
+#include <linux/math64.h>
+#include <linux/time.h>
+
+#include "test_apt_usbtrx.h"
+#include "test_apt_usbtrx_clock.h"
+
+#include "../apt_usbtrx/apt_usbtrx_clock.h"
+
+/*
+ * Feed one frame per interval on host = offset + dev * (1 + skew), plus a later
+ * frame of the same interval with a larger delay that must not be picked.
+ */
+static void add_samples(apt_usbtrx_clock_t *clock, int first, int last, s64 interval_us, s64 offset_us,
+			s64 skew_ppb)
+{
+	int i;
+
+	for (i = first; i <= last; i++) {
+		s64 dev_us = i * interval_us;
+		s64 host_us = offset_us + dev_us + div_s64(dev_us * skew_ppb, NSEC_PER_SEC);
+
+		apt_usbtrx_clock_add_sample(clock, dev_us, host_us);
+		apt_usbtrx_clock_add_sample(clock, dev_us + 100000, host_us + 100000 + 500);
+	}
+}
+
+static apt_usbtrx_clock_t *clock_alloc(struct kunit *test)
+{
+	apt_usbtrx_clock_t *clock = kunit_kzalloc(test, sizeof(apt_usbtrx_clock_t), GFP_KERNEL);
+
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, clock);
+	apt_usbtrx_clock_init(clock);
+
+	return clock;
+}
+
+void test_apt_usbtrx_clock_fit(struct kunit *test)
+{
+	apt_usbtrx_clock_t *clock = clock_alloc(test);
+	s64 skew_ppb;
+	s64 offset_us;
+	unsigned int count;
+	s64 host_us;
+	s64 dev_us;
+	bool valid;
+
+	/* a sample is taken when the next interval starts */
+	add_samples(clock, 0, 3, USEC_PER_SEC, 1000, 50000);
+	valid = apt_usbtrx_clock_get_fit(clock, &skew_ppb, &offset_us, &count);
+	KUNIT_EXPECT_FALSE(test, valid);
+	KUNIT_EXPECT_EQ(test, 3U, count);
+	KUNIT_EXPECT_FALSE(test, apt_usbtrx_clock_translate(clock, 0, &host_us));
+
+	add_samples(clock, 4, 10, USEC_PER_SEC, 1000, 50000);
+	valid = apt_usbtrx_clock_get_fit(clock, &skew_ppb, &offset_us, &count);
+	KUNIT_EXPECT_TRUE(test, valid);
+	KUNIT_EXPECT_EQ(test, 10U, count);
+	KUNIT_EXPECT_EQ(test, (s64)50000, skew_ppb);
+	KUNIT_EXPECT_EQ(test, (s64)(1000 + 225), offset_us); /* at the mean device time of 4.5 s */
+
+	KUNIT_EXPECT_TRUE(test, apt_usbtrx_clock_translate(clock, 0, &host_us));
+	KUNIT_EXPECT_EQ(test, (s64)1000, host_us);
+	KUNIT_EXPECT_TRUE(test, apt_usbtrx_clock_translate(clock, 20 * USEC_PER_SEC, &host_us));
+	KUNIT_EXPECT_EQ(test, (s64)(1000 + 20 * USEC_PER_SEC + 1000), host_us);
+
+	KUNIT_EXPECT_TRUE(test, apt_usbtrx_clock_translate_to_device(clock, 1000, &dev_us));
+	KUNIT_EXPECT_EQ(test, (s64)0, dev_us);
+}
+
+void test_apt_usbtrx_clock_reject_skew(struct kunit *test)
+{
+	apt_usbtrx_clock_t *clock = clock_alloc(test);
+	s64 skew_ppb;
+	s64 offset_us;
+	unsigned int count;
+	bool valid;
+
+	/* within APT_USBTRX_CLOCK_MAX_SKEW_PPB */
+	add_samples(clock, 0, 4, USEC_PER_SEC, 0, 900000);
+	valid = apt_usbtrx_clock_get_fit(clock, &skew_ppb, &offset_us, &count);
+	KUNIT_EXPECT_TRUE(test, valid);
+	KUNIT_EXPECT_EQ(test, (s64)900000, skew_ppb);
+
+	/* out of range, the estimator is reset */
+	apt_usbtrx_clock_reset(clock);
+	add_samples(clock, 0, 4, USEC_PER_SEC, 0, 2 * APT_USBTRX_CLOCK_MAX_SKEW_PPB);
+	valid = apt_usbtrx_clock_get_fit(clock, &skew_ppb, &offset_us, &count);
+	KUNIT_EXPECT_FALSE(test, valid);
+	KUNIT_EXPECT_EQ(test, 0U, count);
+	KUNIT_EXPECT_EQ(test, (s64)0, skew_ppb);
+}
+
+void test_apt_usbtrx_clock_reset_on_backward(struct kunit *test)
+{
+	apt_usbtrx_clock_t *clock = clock_alloc(test);
+	s64 skew_ppb;
+	s64 offset_us;
+	unsigned int count;
+	bool valid;
+
+	add_samples(clock, 0, 5, USEC_PER_SEC, 1000, 0);
+	valid = apt_usbtrx_clock_get_fit(clock, &skew_ppb, &offset_us, &count);
+	KUNIT_EXPECT_TRUE(test, valid);
+	KUNIT_EXPECT_EQ(test, 5U, count);
+	KUNIT_EXPECT_EQ(test, (s64)1000, offset_us);
+
+	/* device timestamp goes back to 2 s, samples before it must not be mixed in */
+	add_samples(clock, 2, 2, USEC_PER_SEC, 5000, 0);
+	valid = apt_usbtrx_clock_get_fit(clock, &skew_ppb, &offset_us, &count);
+	KUNIT_EXPECT_FALSE(test, valid);
+	KUNIT_EXPECT_EQ(test, 0U, count);
+
+	add_samples(clock, 3, 7, USEC_PER_SEC, 5000, 0);
+	valid = apt_usbtrx_clock_get_fit(clock, &skew_ppb, &offset_us, &count);
+	KUNIT_EXPECT_TRUE(test, valid);
+	KUNIT_EXPECT_EQ(test, 5U, count);
+	KUNIT_EXPECT_EQ(test, (s64)0, skew_ppb);
+	KUNIT_EXPECT_EQ(test, (s64)5000, offset_us);
+}
+
+void test_apt_usbtrx_clock_max_span(struct kunit *test)
+{
+	apt_usbtrx_clock_t *clock = clock_alloc(test);
+	s64 skew_ppb;
+	s64 offset_us;
+	unsigned int count;
+	bool valid;
+
+	/* sparse frames: samples at 0, 80, ..., 560 s, only those within 256 s of the newest are kept */
+	add_samples(clock, 0, 8, 80 * USEC_PER_SEC, 1000, 10000);
+	valid = apt_usbtrx_clock_get_fit(clock, &skew_ppb, &offset_us, &count);
+	KUNIT_EXPECT_TRUE(test, valid);
+	KUNIT_EXPECT_EQ(test, 4U, count);
+	KUNIT_EXPECT_EQ(test, (s64)10000, skew_ppb);
+
+	/* samples further apart than the span never reach APT_USBTRX_CLOCK_MIN_SAMPLES */
+	apt_usbtrx_clock_reset(clock);
+	add_samples(clock, 0, 8, 100 * USEC_PER_SEC, 1000, 10000);
+	valid = apt_usbtrx_clock_get_fit(clock, &skew_ppb, &offset_us, &count);
+	KUNIT_EXPECT_FALSE(test, valid);
+	KUNIT_EXPECT_EQ(test, 3U, count);
+}
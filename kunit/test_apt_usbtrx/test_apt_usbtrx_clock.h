@@ -0,0 +1,8 @@
+#pragma once
+
+#include "test_apt_usbtrx.h"
+
+void test_apt_usbtrx_clock_fit(struct kunit *test);
+void test_apt_usbtrx_clock_reject_skew(struct kunit *test);
+void test_apt_usbtrx_clock_reset_on_backward(struct kunit *test);
+void test_apt_usbtrx_clock_max_span(struct kunit *test);
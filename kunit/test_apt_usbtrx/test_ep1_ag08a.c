@@ -7,6 +7,7 @@
 #include "test_apt_usbtrx.h"
 #include "test_ep1_ag08a.h"
 
+#include "../apt_usbtrx/apt_usbtrx_core.h"
 #include "../apt_usbtrx/apt_usbtrx_msg.h"
 #include "../apt_usbtrx/apt_usbtrx_fops.h"
 #include "../apt_usbtrx/apt_usbtrx_ioctl.h"
@@ -126,6 +127,174 @@ void test_ep1_ag08a_dispatch_msg_notify_analog_input(struct kunit *test)
 	fake_dev_terminate(test, dev);
 }
 
+void test_ep1_ag08a_read_whole_frames(struct kunit *test)
+{
+	struct apt_usbtrx_test_data *test_data = test->priv;
+	apt_usbtrx_dev_t *dev = test_data->dev;
+	u8 cmd_id = EP1_AG08A_CMD_NotifyAnalogInput;
+	struct payload_ep1_ag08a_notify_analog_input_1ch exp_payload_1ch = payload_notify_analog_input_1ch;
+	struct payload_ep1_ag08a_notify_analog_input_8ch exp_payload_8ch = payload_notify_analog_input_8ch;
+	struct payload_ep1_ag08a_notify_analog_input_8ch act_payload;
+	apt_usbtrx_ioctl_get_rx_queued_t act_queued;
+	int result;
+	ssize_t rsize;
+
+	fake_dev_init(test, dev, EP1_AG08A);
+
+	result = send_message(test, dev, cmd_id, (u8 *)&exp_payload_1ch, sizeof(exp_payload_1ch));
+	KUNIT_ASSERT_EQ(test, RESULT_Success, result);
+	result = send_message(test, dev, cmd_id, (u8 *)&exp_payload_8ch, sizeof(exp_payload_8ch));
+	KUNIT_ASSERT_EQ(test, RESULT_Success, result);
+
+	check_ioctl(test, dev, APT_USBTRX_IOCTL_GET_RX_QUEUED, (unsigned long)&act_queued, 0);
+	KUNIT_EXPECT_EQ(test, 2U, act_queued.frames);
+	KUNIT_EXPECT_EQ(test, (unsigned int)(sizeof(exp_payload_1ch) + sizeof(exp_payload_8ch)), act_queued.bytes);
+
+	/* the 8ch frame does not fit into the rest of the buffer */
+	rsize = recv_message(test, dev, (u8 *)&act_payload, sizeof(act_payload));
+	KUNIT_EXPECT_EQ(test, (ssize_t)sizeof(exp_payload_1ch), rsize);
+	expect_eq_all(test, (u8 *)&exp_payload_1ch, sizeof(exp_payload_1ch), (u8 *)&act_payload, rsize);
+
+	/* a frame is never split */
+	rsize = recv_message(test, dev, (u8 *)&act_payload, sizeof(exp_payload_1ch));
+	KUNIT_EXPECT_EQ(test, (ssize_t)-EINVAL, rsize);
+
+	rsize = recv_message(test, dev, (u8 *)&act_payload, sizeof(act_payload));
+	KUNIT_EXPECT_EQ(test, (ssize_t)sizeof(exp_payload_8ch), rsize);
+	expect_eq_all(test, (u8 *)&exp_payload_8ch, sizeof(exp_payload_8ch), (u8 *)&act_payload, rsize);
+
+	fake_dev_terminate(test, dev);
+}
+
+void test_ep1_ag08a_rx_overflow_marker(struct kunit *test)
+{
+	struct apt_usbtrx_test_data *test_data = test->priv;
+	apt_usbtrx_dev_t *dev = test_data->dev;
+	u8 cmd_id = EP1_AG08A_CMD_NotifyAnalogInput;
+	struct payload_ep1_ag08a_notify_analog_input_8ch exp_payload = payload_notify_analog_input_8ch;
+	const size_t exp_payload_size = sizeof(exp_payload);
+	apt_usbtrx_ioctl_rx_overflow_marker_t param = { .enable = 1 };
+	apt_usbtrx_rx_overflow_marker_t act_marker;
+	int total_send_size = 0;
+	int result;
+	ssize_t rsize;
+	int i;
+
+	fake_dev_init(test, dev, EP1_AG08A);
+
+	check_ioctl(test, dev, APT_USBTRX_IOCTL_SET_RX_OVERFLOW_MARKER, (unsigned long)&param, 0);
+
+	while (total_send_size + exp_payload_size <= dev->rx_data_size) {
+		result = send_message(test, dev, cmd_id, (u8 *)&exp_payload, exp_payload_size);
+		KUNIT_ASSERT_EQ(test, RESULT_Success, result);
+		total_send_size += exp_payload_size;
+	}
+
+	/* drop 2 frames, then make room for the marker and the next frame */
+	for (i = 0; i < 2; i++) {
+		result = send_message(test, dev, cmd_id, (u8 *)&exp_payload, exp_payload_size);
+		KUNIT_EXPECT_EQ(test, RESULT_Success, result);
+	}
+	KUNIT_ASSERT_EQ(test, (u64)(2 * exp_payload_size), dev->rx_data.skip_count);
+
+	for (i = 0; i < 3; i++) {
+		rsize = recv_message(test, dev, (u8 *)&act_marker, exp_payload_size);
+		KUNIT_EXPECT_EQ(test, (ssize_t)exp_payload_size, rsize);
+		total_send_size -= exp_payload_size;
+	}
+
+	result = send_message(test, dev, cmd_id, (u8 *)&exp_payload, exp_payload_size);
+	KUNIT_EXPECT_EQ(test, RESULT_Success, result);
+
+	/* frames stored before the loss, then the marker, then the next frame */
+	while (total_send_size > 0) {
+		rsize = recv_message(test, dev, (u8 *)&act_marker, exp_payload_size);
+		KUNIT_EXPECT_EQ(test, (ssize_t)exp_payload_size, rsize);
+		total_send_size -= exp_payload_size;
+	}
+
+	rsize = recv_message(test, dev, (u8 *)&act_marker, sizeof(act_marker));
+	KUNIT_ASSERT_EQ(test, (ssize_t)sizeof(act_marker), rsize);
+	KUNIT_EXPECT_EQ(test, (unsigned int)APT_USBTRX_RX_OVERFLOW_MARKER, act_marker.ts_usec);
+	KUNIT_EXPECT_EQ(test, 2U, act_marker.frames);
+	KUNIT_EXPECT_EQ(test, (unsigned int)(2 * exp_payload_size), act_marker.bytes);
+	KUNIT_EXPECT_EQ(test, exp_payload.timestamp.ts_sec, act_marker.first_ts_sec);
+	KUNIT_EXPECT_EQ(test, exp_payload.timestamp.ts_usec, act_marker.last_ts_usec);
+
+	rsize = recv_message(test, dev, (u8 *)&act_marker, sizeof(act_marker));
+	KUNIT_EXPECT_EQ(test, (ssize_t)exp_payload_size, rsize);
+	expect_eq_all(test, (u8 *)&exp_payload, exp_payload_size, (u8 *)&act_marker, rsize);
+
+	fake_dev_terminate(test, dev);
+}
+
+void test_ep1_ag08a_rx_capture_flight_recorder(struct kunit *test)
+{
+	struct apt_usbtrx_test_data *test_data = test->priv;
+	apt_usbtrx_dev_t *dev = test_data->dev;
+	u8 cmd_id = EP1_AG08A_CMD_NotifyAnalogInput;
+	struct payload_ep1_ag08a_notify_analog_input_8ch exp_payload = payload_notify_analog_input_8ch;
+	struct payload_ep1_ag08a_notify_analog_input_8ch act_payload;
+	const size_t exp_payload_size = sizeof(exp_payload);
+	apt_usbtrx_ioctl_rx_capture_t param = {
+		.mode = APT_USBTRX_RX_CAPTURE_MODE_FLIGHT_RECORDER,
+		.post_frames = 1,
+	};
+	apt_usbtrx_ioctl_rx_capture_t invalid_param = {
+		.mode = APT_USBTRX_RX_CAPTURE_MODE_FLIGHT_RECORDER,
+	};
+	apt_usbtrx_ioctl_rx_capture_t act_param;
+	apt_usbtrx_ioctl_get_rx_queued_t act_queued;
+	u32 send_frames;
+	u32 i;
+	int result;
+	ssize_t rsize;
+
+	fake_dev_init(test, dev, EP1_AG08A);
+	send_frames = dev->rx_data.buffer_size / exp_payload_size + 10;
+
+	/* post-trigger frames would overwrite the trigger frame */
+	invalid_param.post_frames = dev->rx_data.buffer_size / APT_USBTRX_RX_RECORD_MAX_SIZE;
+	check_ioctl(test, dev, APT_USBTRX_IOCTL_SET_RX_CAPTURE, (unsigned long)&invalid_param, -EINVAL);
+
+	check_ioctl(test, dev, APT_USBTRX_IOCTL_SET_RX_CAPTURE, (unsigned long)&param, 0);
+
+	/* the oldest frames are overwritten while armed */
+	for (i = 0; i < send_frames; i++) {
+		exp_payload.timestamp.ts_usec = i;
+		result = send_message(test, dev, cmd_id, (u8 *)&exp_payload, exp_payload_size);
+		KUNIT_ASSERT_EQ(test, RESULT_Success, result);
+	}
+	KUNIT_EXPECT_EQ(test, (u64)0, dev->rx_data.skip_count);
+
+	check_ioctl(test, dev, APT_USBTRX_IOCTL_GET_RX_CAPTURE, (unsigned long)&act_param, 0);
+	KUNIT_EXPECT_EQ(test, (int)APT_USBTRX_RX_CAPTURE_STATE_ARMED, act_param.state);
+
+	/* one post-trigger frame is stored, then the ring is frozen */
+	check_ioctl(test, dev, APT_USBTRX_IOCTL_TRIGGER_RX_CAPTURE, 0, 0);
+	for (i = send_frames; i < send_frames + 2; i++) {
+		exp_payload.timestamp.ts_usec = i;
+		result = send_message(test, dev, cmd_id, (u8 *)&exp_payload, exp_payload_size);
+		KUNIT_ASSERT_EQ(test, RESULT_Success, result);
+	}
+	KUNIT_EXPECT_EQ(test, (u64)exp_payload_size, dev->rx_data.skip_count);
+
+	check_ioctl(test, dev, APT_USBTRX_IOCTL_GET_RX_CAPTURE, (unsigned long)&act_param, 0);
+	KUNIT_EXPECT_EQ(test, (int)APT_USBTRX_RX_CAPTURE_STATE_FROZEN, act_param.state);
+
+	check_ioctl(test, dev, APT_USBTRX_IOCTL_GET_RX_QUEUED, (unsigned long)&act_queued, 0);
+	KUNIT_EXPECT_EQ(test, (unsigned int)(dev->rx_data.buffer_size / exp_payload_size), act_queued.frames);
+
+	/* the newest frames up to the post-trigger frame are kept */
+	for (i = send_frames + 1 - act_queued.frames; i < send_frames + 1; i++) {
+		rsize = recv_message(test, dev, (u8 *)&act_payload, sizeof(act_payload));
+		KUNIT_ASSERT_EQ(test, (ssize_t)exp_payload_size, rsize);
+		KUNIT_EXPECT_EQ(test, i, act_payload.timestamp.ts_usec);
+	}
+
+	fake_dev_terminate(test, dev);
+}
+
 void test_ep1_ag08a_dispatch_msg_invalid_id(struct kunit *test)
 {
 	struct apt_usbtrx_test_data *test_data = test->priv;
@@ -145,6 +314,92 @@ void test_ep1_ag08a_dispatch_msg_invalid_id(struct kunit *test)
 	fake_dev_terminate(test, dev);
 }
 
+static size_t build_record(u8 *data, u8 cmd_id, const void *payload, size_t payload_size)
+{
+	data[0] = APT_USBTRX_MSG_SOB;
+	data[1] = APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(payload_size);
+	data[2] = cmd_id;
+	memcpy(&data[3], payload, payload_size);
+	data[3 + payload_size] = APT_USBTRX_MSG_EOB;
+
+	return APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(payload_size);
+}
+
+void test_ep1_ag08a_rx_resync_garbage(struct kunit *test)
+{
+	struct apt_usbtrx_test_data *test_data = test->priv;
+	apt_usbtrx_dev_t *dev = test_data->dev;
+	u8 cmd_id = EP1_AG08A_CMD_NotifyAnalogInput;
+	struct payload_ep1_ag08a_notify_analog_input_1ch exp_payload_1ch = payload_notify_analog_input_1ch;
+	struct payload_ep1_ag08a_notify_analog_input_8ch exp_payload_8ch = payload_notify_analog_input_8ch;
+	struct payload_ep1_ag08a_notify_analog_input_8ch act_payload;
+	/* garbage including a SOB with an invalid length */
+	const u8 garbage[] = { 0x00, 0x55, APT_USBTRX_MSG_SOB, 0x01, 0xAA };
+	u8 data[64];
+	size_t size = 0;
+	int processed_size;
+	ssize_t rsize;
+
+	fake_dev_init(test, dev, EP1_AG08A);
+
+	memcpy(data, garbage, sizeof(garbage));
+	size += sizeof(garbage);
+	size += build_record(&data[size], cmd_id, &exp_payload_1ch, sizeof(exp_payload_1ch));
+	size += build_record(&data[size], cmd_id, &exp_payload_8ch, sizeof(exp_payload_8ch));
+
+	processed_size = apt_usbtrx_parse_rx_data(dev, data, size, size);
+	KUNIT_EXPECT_EQ(test, (int)size, processed_size);
+	KUNIT_EXPECT_EQ(test, (s64)1, (s64)atomic64_read(&dev->rx_resync_count));
+	KUNIT_EXPECT_EQ(test, (s64)sizeof(garbage), (s64)atomic64_read(&dev->rx_resync_bytes));
+
+	/* dispatch resumed at the first valid record */
+	rsize = recv_message(test, dev, (u8 *)&act_payload, sizeof(exp_payload_1ch));
+	KUNIT_EXPECT_EQ(test, (ssize_t)sizeof(exp_payload_1ch), rsize);
+	expect_eq_all(test, (u8 *)&exp_payload_1ch, sizeof(exp_payload_1ch), (u8 *)&act_payload, rsize);
+
+	rsize = recv_message(test, dev, (u8 *)&act_payload, sizeof(exp_payload_8ch));
+	KUNIT_EXPECT_EQ(test, (ssize_t)sizeof(exp_payload_8ch), rsize);
+	expect_eq_all(test, (u8 *)&exp_payload_8ch, sizeof(exp_payload_8ch), (u8 *)&act_payload, rsize);
+
+	fake_dev_terminate(test, dev);
+}
+
+void test_ep1_ag08a_rx_resync_truncated_header(struct kunit *test)
+{
+	struct apt_usbtrx_test_data *test_data = test->priv;
+	apt_usbtrx_dev_t *dev = test_data->dev;
+	u8 cmd_id = EP1_AG08A_CMD_NotifyAnalogInput;
+	struct payload_ep1_ag08a_notify_analog_input_1ch exp_payload = payload_notify_analog_input_1ch;
+	struct payload_ep1_ag08a_notify_analog_input_1ch act_payload;
+	/* header of a record whose payload was lost */
+	const u8 header[] = { APT_USBTRX_MSG_SOB, APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(sizeof(exp_payload)), cmd_id };
+	u8 data[64];
+	size_t size = 0;
+	int processed_size;
+	ssize_t rsize;
+
+	fake_dev_init(test, dev, EP1_AG08A);
+
+	memcpy(data, header, sizeof(header));
+	size += sizeof(header);
+	size += build_record(&data[size], cmd_id, &exp_payload, sizeof(exp_payload));
+	/* a header at the end is kept for the next transfer */
+	memcpy(&data[size], header, sizeof(header));
+	size += sizeof(header);
+
+	processed_size = apt_usbtrx_parse_rx_data(dev, data, size, size);
+	KUNIT_EXPECT_EQ(test, (int)(size - sizeof(header)), processed_size);
+	KUNIT_EXPECT_EQ(test, (s64)1, (s64)atomic64_read(&dev->rx_resync_count));
+	KUNIT_EXPECT_EQ(test, (s64)sizeof(header), (s64)atomic64_read(&dev->rx_resync_bytes));
+
+	/* dispatch resumed at the record following the truncated header */
+	rsize = recv_message(test, dev, (u8 *)&act_payload, sizeof(act_payload));
+	KUNIT_EXPECT_EQ(test, (ssize_t)sizeof(exp_payload), rsize);
+	expect_eq_all(test, (u8 *)&exp_payload, sizeof(exp_payload), (u8 *)&act_payload, rsize);
+
+	fake_dev_terminate(test, dev);
+}
+
 void test_ep1_ag08a_ioctl_get_status(struct kunit *test)
 {
 	struct apt_usbtrx_test_data *test_data = test->priv;
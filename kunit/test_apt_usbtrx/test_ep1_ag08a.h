@@ -3,6 +3,11 @@
 #include "test_apt_usbtrx.h"
 
 void test_ep1_ag08a_dispatch_msg_notify_analog_input(struct kunit *test);
+void test_ep1_ag08a_read_whole_frames(struct kunit *test);
+void test_ep1_ag08a_rx_overflow_marker(struct kunit *test);
+void test_ep1_ag08a_rx_capture_flight_recorder(struct kunit *test);
 void test_ep1_ag08a_dispatch_msg_invalid_id(struct kunit *test);
+void test_ep1_ag08a_rx_resync_garbage(struct kunit *test);
+void test_ep1_ag08a_rx_resync_truncated_header(struct kunit *test);
 void test_ep1_ag08a_ioctl_get_status(struct kunit *test);
 void test_ep1_ag08a_ioctl_invalid_cmd(struct kunit *test);
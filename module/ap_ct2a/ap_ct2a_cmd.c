@@ -6,8 +6,6 @@
  * Copyright (C) 2020 aptpod Inc.
  */
 
-#include <linux/slab.h>
-
 #include "../apt_usbtrx_core.h" /* send_msg(), wait_msg() */
 #include "ap_ct2a_cmd.h"
 #include "ap_ct2a_msg.h"
@@ -18,6 +16,7 @@
 int apt_usbtrx_set_mode(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_mode_t *param, bool *success)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_SET_MODE;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_ACK;
 	char *resp_data;
@@ -28,18 +27,9 @@ int apt_usbtrx_set_mode(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_mode_t *param,
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = APT_USBTRX_CMD_SetMode;
@@ -47,8 +37,7 @@ int apt_usbtrx_set_mode(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_mode_t *param,
 	result = apt_usbtrx_msg_pack_set_mode(param, req_msg.payload, req_msg.payload_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack_set_mode().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -62,16 +51,14 @@ int apt_usbtrx_set_mode(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_mode_t *param,
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -79,30 +66,26 @@ int apt_usbtrx_set_mode(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_mode_t *param,
 	result = apt_usbtrx_wait_msg(dev, APT_USBTRX_CMD_ACK, APT_USBTRX_CMD_NACK, resp_data, resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &id);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_ack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	if (id != APT_USBTRX_CMD_SetMode) {
 		EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, id);
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	switch (resp_msg.id) {
@@ -114,8 +97,7 @@ int apt_usbtrx_set_mode(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_mode_t *param,
 		break;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -127,6 +109,7 @@ int apt_usbtrx_set_mode(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_mode_t *param,
 int apt_usbtrx_get_status(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_resp_get_status_t *status)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_GET_STATUS;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_RESPONSE_GET_STATUS;
 	char *resp_data;
@@ -136,18 +119,9 @@ int apt_usbtrx_get_status(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_resp_get_status_
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = APT_USBTRX_CMD_GetStatus;
@@ -155,16 +129,14 @@ int apt_usbtrx_get_status(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_resp_get_status_
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -173,16 +145,14 @@ int apt_usbtrx_get_status(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_resp_get_status_
 				     resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -196,13 +166,11 @@ int apt_usbtrx_get_status(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_resp_get_status_
 	result = apt_usbtrx_msg_parse_response_get_status(resp_msg.payload, resp_msg.payload_size, status);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_response_get_status().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -214,6 +182,7 @@ int apt_usbtrx_get_status(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_resp_get_status_
 int apt_usbtrx_reset_can_summary(apt_usbtrx_dev_t *dev, bool *success)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_RESET_CAN_SUMMARY;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_ACK;
 	char *resp_data;
@@ -224,18 +193,9 @@ int apt_usbtrx_reset_can_summary(apt_usbtrx_dev_t *dev, bool *success)
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = APT_USBTRX_CMD_ResetCANSummary;
@@ -243,16 +203,14 @@ int apt_usbtrx_reset_can_summary(apt_usbtrx_dev_t *dev, bool *success)
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -260,30 +218,26 @@ int apt_usbtrx_reset_can_summary(apt_usbtrx_dev_t *dev, bool *success)
 	result = apt_usbtrx_wait_msg(dev, APT_USBTRX_CMD_ACK, APT_USBTRX_CMD_NACK, resp_data, resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &id);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_ack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	if (id != APT_USBTRX_CMD_ResetCANSummary) {
 		EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, id);
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	switch (resp_msg.id) {
@@ -295,8 +249,7 @@ int apt_usbtrx_reset_can_summary(apt_usbtrx_dev_t *dev, bool *success)
 		break;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -308,6 +261,7 @@ int apt_usbtrx_reset_can_summary(apt_usbtrx_dev_t *dev, bool *success)
 int apt_usbtrx_start_stop_can(apt_usbtrx_dev_t *dev, bool start, bool *success)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_START_STOP_CAN;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_ACK;
 	char *resp_data;
@@ -318,18 +272,9 @@ int apt_usbtrx_start_stop_can(apt_usbtrx_dev_t *dev, bool start, bool *success)
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = APT_USBTRX_CMD_StartStopCAN;
@@ -337,8 +282,7 @@ int apt_usbtrx_start_stop_can(apt_usbtrx_dev_t *dev, bool start, bool *success)
 	result = apt_usbtrx_msg_pack_start_stop_can(start, req_msg.payload, req_msg.payload_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack_start_stop_can().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -352,16 +296,14 @@ int apt_usbtrx_start_stop_can(apt_usbtrx_dev_t *dev, bool start, bool *success)
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -369,30 +311,26 @@ int apt_usbtrx_start_stop_can(apt_usbtrx_dev_t *dev, bool start, bool *success)
 	result = apt_usbtrx_wait_msg(dev, APT_USBTRX_CMD_ACK, APT_USBTRX_CMD_NACK, resp_data, resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &id);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_ack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	if (id != APT_USBTRX_CMD_StartStopCAN) {
 		EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, id);
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	switch (resp_msg.id) {
@@ -404,8 +342,7 @@ int apt_usbtrx_start_stop_can(apt_usbtrx_dev_t *dev, bool start, bool *success)
 		break;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	return RESULT_Success;
 }
@@ -416,6 +353,7 @@ int apt_usbtrx_start_stop_can(apt_usbtrx_dev_t *dev, bool start, bool *success)
 int apt_usbtrx_set_trigger(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_trigger_t *param, bool *success)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_SET_TRIGGER;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_ACK;
 	char *resp_data;
@@ -426,18 +364,9 @@ int apt_usbtrx_set_trigger(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_trigger_t *
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = APT_USBTRX_CMD_SetTrigger;
@@ -445,8 +374,7 @@ int apt_usbtrx_set_trigger(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_trigger_t *
 	result = apt_usbtrx_msg_pack_set_trigger(param, req_msg.payload, req_msg.payload_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack_set_trigger().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -460,16 +388,14 @@ int apt_usbtrx_set_trigger(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_trigger_t *
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -477,30 +403,26 @@ int apt_usbtrx_set_trigger(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_trigger_t *
 	result = apt_usbtrx_wait_msg(dev, APT_USBTRX_CMD_ACK, APT_USBTRX_CMD_NACK, resp_data, resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &id);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_ack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	if (id != APT_USBTRX_CMD_SetTrigger) {
 		EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, id);
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	switch (resp_msg.id) {
@@ -512,8 +434,7 @@ int apt_usbtrx_set_trigger(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_set_trigger_t *
 		break;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -9,6 +9,7 @@
 #include <linux/version.h>
 #include <linux/can/dev.h>
 
+#include "../apt_usbtrx_core.h" /* apt_usbtrx_complete_echo_skb(), apt_usbtrx_free_echo_skb() */
 #include "ap_ct2a_core.h"
 #include "ap_ct2a_cmd_def.h"
 #include "ap_ct2a_msg.h"
@@ -62,6 +63,7 @@ static void apt_usbtrx_unique_can_rx_can_msg(apt_usbtrx_dev_t *dev,
 		return;
 	}
 
+	apt_usbtrx_add_clock_sample(dev, &recv_can_frame->timestamp);
 	apt_usbtrx_convert_timestamp_to_timespec64(&recv_can_frame->timestamp, &ts);
 	hwts = skb_hwtstamps(skb);
 	hwts->hwtstamp = timespec64_to_ktime(ts);
@@ -84,97 +86,102 @@ static void apt_usbtrx_unique_can_rx_can_msg(apt_usbtrx_dev_t *dev,
 #endif
 
 /*!
- * @brief dispatch message
+ * @brief dispatch NotifyRecvCANFrame (message handler)
  */
-int apt_usbtrx_unique_can_dispatch_msg(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_t *msg)
+int apt_usbtrx_unique_can_dispatch_recv_can_frame(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg)
 {
 	apt_usbtrx_unique_data_can_t *unique_data = get_unique_data(dev);
-
-	switch (msg->id) {
-	case APT_USBTRX_CMD_NotifyRecvCANFrame: {
-		int if_type = atomic_read(&unique_data->if_type);
-
-		if (if_type == APT_USBTRX_CAN_IF_TYPE_FILE) {
-			apt_usbtrx_ringbuffer_write(&dev->rx_data, msg->payload, msg->payload_size);
-			wake_up_interruptible(&dev->rx_data.wq);
-		} else if (if_type == APT_USBTRX_CAN_IF_TYPE_NET) {
+	apt_usbtrx_payload_notify_recv_can_frame_t *recv_can_frame =
+		(apt_usbtrx_payload_notify_recv_can_frame_t *)msg->payload;
+	int if_type = atomic_read(&unique_data->if_type);
+
+	if (if_type == APT_USBTRX_CAN_IF_TYPE_FILE) {
+		u32 can_id = recv_can_frame->id[0] | recv_can_frame->id[1] << 8 | recv_can_frame->id[2] << 16 |
+			     (u32)recv_can_frame->id[3] << 24;
+
+		apt_usbtrx_rx_capture_match_can_id(dev, can_id);
+		apt_usbtrx_write_rx_data(dev, &recv_can_frame->timestamp, msg->payload, msg->payload_size);
+		apt_usbtrx_notify_rx_data(dev);
+	} else if (if_type == APT_USBTRX_CAN_IF_TYPE_NET) {
 #ifdef SUPPORT_NETDEV
-			apt_usbtrx_unique_can_rx_can_msg(dev,
-							 (apt_usbtrx_payload_notify_recv_can_frame_t *)msg->payload);
+		apt_usbtrx_unique_can_rx_can_msg(dev, recv_can_frame);
 #endif
-		}
-		break;
 	}
-	case APT_USBTRX_CMD_NotifyCANSummary: {
-		u32 count;
-		struct can_frame frame;
-		int result;
-
-		result = apt_usbtrx_msg_parse_notify_recv_can_summary(msg->payload, msg->payload_size, &count, &frame);
-		if (result != RESULT_Success) {
-			EMSG("apt_usbtrx_msg_parse_notify_recv_can_summary().. Error");
-			break;
-		}
 
-		if (frame.can_id & CAN_ERR_FLAG) {
-			apt_usbtrx_update_stats(&unique_data->summary.err, jiffies, count);
-		} else if (frame.can_id & CAN_RTR_FLAG) {
-			if (frame.can_id & CAN_EFF_FLAG) {
-				apt_usbtrx_update_stats(&unique_data->summary.rtr_ext, jiffies, count);
-			} else {
-				apt_usbtrx_update_stats(&unique_data->summary.rtr_std, jiffies, count);
-			}
+	return RESULT_Success;
+}
+
+/*!
+ * @brief dispatch NotifyCANSummary (message handler)
+ */
+int apt_usbtrx_unique_can_dispatch_can_summary(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg)
+{
+	apt_usbtrx_unique_data_can_t *unique_data = get_unique_data(dev);
+	u32 count;
+	struct can_frame frame;
+	int result;
+
+	result = apt_usbtrx_msg_parse_notify_recv_can_summary(msg->payload, msg->payload_size, &count, &frame);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_msg_parse_notify_recv_can_summary().. Error");
+		return RESULT_Success;
+	}
+
+	if (frame.can_id & CAN_ERR_FLAG) {
+		apt_usbtrx_update_stats(&unique_data->summary.err, jiffies, count);
+	} else if (frame.can_id & CAN_RTR_FLAG) {
+		if (frame.can_id & CAN_EFF_FLAG) {
+			apt_usbtrx_update_stats(&unique_data->summary.rtr_ext, jiffies, count);
 		} else {
-			if (frame.can_id & CAN_EFF_FLAG) {
-				apt_usbtrx_update_stats(&unique_data->summary.dat_ext, jiffies, count);
-			} else {
-				apt_usbtrx_update_stats(&unique_data->summary.dat_std, jiffies, count);
-			}
+			apt_usbtrx_update_stats(&unique_data->summary.rtr_std, jiffies, count);
 		}
-		break;
-	}
-	case APT_USBTRX_CMD_ResponseGetStatus: {
-		if (dev->rx_complete.id == APT_USBTRX_CMD_GetStatus) {
-			DMSG("complete!, <id:0x%02x> length=%d", msg->id,
-			     APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size));
-			dev->rx_complete.data_size = APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size);
-			memcpy(dev->rx_complete.buffer, data, dev->rx_complete.data_size);
-			complete(&dev->rx_complete.complete);
+	} else {
+		if (frame.can_id & CAN_EFF_FLAG) {
+			apt_usbtrx_update_stats(&unique_data->summary.dat_ext, jiffies, count);
+		} else {
+			apt_usbtrx_update_stats(&unique_data->summary.dat_std, jiffies, count);
 		}
-		break;
-	}
-	default:
-		return RESULT_Failure;
 	}
 
 	return RESULT_Success;
 }
 
+/*!
+ * @brief message dispatch table
+ */
+const apt_usbtrx_msg_entry_t apt_usbtrx_unique_can_msg_table[APT_USBTRX_MSG_ID_MAX] = {
+	APT_USBTRX_MSG_COMMON_ENTRIES,
+	AP_CT2A_MSG_ENTRIES,
+};
+
 /*!
  * @brief write bulk callback
+ * NOTE: status is -ECANCELED for messages dropped by the driver.
  */
-void apt_usbtrx_unique_can_write_bulk_callback(struct urb *urb)
+void apt_usbtrx_unique_can_write_bulk_callback(apt_usbtrx_dev_t *dev, int msg_count, int status)
 {
 #ifdef SUPPORT_NETDEV
-	apt_usbtrx_dev_t *dev = urb->context;
 	apt_usbtrx_unique_data_can_t *unique_data = get_unique_data(dev);
 	struct net_device *netdev = unique_data->netdev;
 	struct net_device_stats *stats = &netdev->stats;
-	apt_usbtrx_candev_t *candev = netdev_priv(netdev);
+	u64 bytes;
 
-	if (!netif_device_present(netdev)) {
+	if (atomic_read(&unique_data->if_type) != APT_USBTRX_CAN_IF_TYPE_NET) {
 		return;
 	}
 
-	stats->tx_packets++;
-	stats->tx_bytes += candev->tx_data_size;
+	if (!netif_device_present(netdev)) {
+		return;
+	}
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 12, 0)
-	can_get_echo_skb(netdev, 0, NULL);
-#else
-	can_get_echo_skb(netdev, 0);
-#endif
-	netif_wake_queue(netdev);
+	if (status == 0) {
+		stats->tx_packets += apt_usbtrx_complete_echo_skb(dev, netdev, msg_count, &bytes);
+		stats->tx_bytes += bytes;
+	} else if (status == -ECANCELED) {
+		stats->tx_dropped += apt_usbtrx_free_echo_skb(dev, netdev, msg_count);
+	} else {
+		stats->tx_errors += apt_usbtrx_free_echo_skb(dev, netdev, msg_count);
+	}
 #endif
 
 	return;
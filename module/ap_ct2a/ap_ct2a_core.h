@@ -13,9 +13,27 @@
 #include "ap_ct2a_def.h"
 
 /*!
- * @brief unique function prototype
+ * @brief message dispatch table entries (inherited by ep1_ch02a)
  */
-int apt_usbtrx_unique_can_dispatch_msg(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_t *msg);
+#define AP_CT2A_MSG_ENTRIES                                                                                   \
+	APT_USBTRX_MSG_HANDLER(APT_USBTRX_CMD_NotifyRecvCANFrame, apt_usbtrx_unique_can_dispatch_recv_can_frame), \
+	APT_USBTRX_MSG_HANDLER(APT_USBTRX_CMD_NotifyCANSummary, apt_usbtrx_unique_can_dispatch_can_summary),      \
+	APT_USBTRX_MSG_RESPONSE(APT_USBTRX_CMD_ResponseGetStatus, APT_USBTRX_CMD_GetStatus)
+
+/*!
+ * @brief message dispatch table
+ */
+extern const apt_usbtrx_msg_entry_t apt_usbtrx_unique_can_msg_table[APT_USBTRX_MSG_ID_MAX];
+
+/*!
+ * @brief dispatch NotifyRecvCANFrame (message handler)
+ */
+int apt_usbtrx_unique_can_dispatch_recv_can_frame(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg);
+
+/*!
+ * @brief dispatch NotifyCANSummary (message handler)
+ */
+int apt_usbtrx_unique_can_dispatch_can_summary(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg);
 
 /*!
  * @brief init stats
@@ -25,6 +43,6 @@ void apt_usbtrx_init_stats(apt_usbtrx_stats_t *stats);
 /*!
  * @brief write bulk callback
  */
-void apt_usbtrx_unique_can_write_bulk_callback(struct urb *urb);
+void apt_usbtrx_unique_can_write_bulk_callback(apt_usbtrx_dev_t *dev, int msg_count, int status);
 
 #endif /* __AP_CT2A_CORE_H__ */
@@ -28,7 +28,7 @@
 #define APT_USBTRX_FW_DATA_SIZE (384 * 1024)
 #define AP_CT2A_CLOCK 10000000 /* TODO: bittiming settings implement */
 #define AP_CT2A_DEFAULT_BAUDRATE 500000
-#define AP_CT2A_RXDATA_BUFFER_SIZE (4 * 1024)
+#define AP_CT2A_RXDATA_BUFFER_SIZE (64 * 1024)
 
 /*!
  * @brief stats
@@ -75,7 +75,6 @@ typedef struct apt_usbtrx_unique_data_can_s apt_usbtrx_unique_data_can_t;
  */
 struct apt_usbtrx_candev_s {
 	struct can_priv can; /* must be the first member */
-	u8 tx_data_size;
 	apt_usbtrx_dev_t *dev;
 };
 typedef struct apt_usbtrx_candev_s apt_usbtrx_candev_t;
@@ -10,6 +10,7 @@
 #include <linux/uaccess.h>
 
 #include "../apt_usbtrx_fops.h" /* apt_usbtrx_write_tx_rb() */
+#include "../apt_usbtrx_core.h" /* apt_usbtrx_put_echo_skb() */
 #include "ap_ct2a_fops.h"
 #include "ap_ct2a_cmd_def.h"
 #include "ap_ct2a_cmd.h"
@@ -45,24 +46,6 @@ int apt_usbtrx_unique_can_get_write_payload_size(const void *payload)
 	return sizeof(apt_usbtrx_payload_send_can_frame_t);
 }
 
-/*!
- * @brief get read-payload timestamp
- *
- * FIXME: It is assumed that it can be acquired
- */
-apt_usbtrx_timestamp_t *apt_usbtrx_unique_can_get_read_payload_timestamp(const void *payload)
-{
-	apt_usbtrx_payload_notify_recv_can_frame_t *read_payload;
-
-	if (payload == NULL) {
-		return NULL;
-	}
-
-	read_payload = (apt_usbtrx_payload_notify_recv_can_frame_t *)payload;
-
-	return &read_payload->timestamp;
-}
-
 /*!
  * @brief get write cmd id
  */
@@ -419,10 +402,14 @@ int apt_usbtrx_unique_can_netdev_open(struct net_device *netdev)
 		return -EBUSY;
 	}
 
+	/* tx_data is not resized while the netdev is open */
+	apt_usbtrx_data_buffer_get(dev);
+
 	/* common open */
 	err = open_candev(netdev);
 	if (err) {
 		netdev_err(netdev, "candev open failed: %d\n", err);
+		apt_usbtrx_data_buffer_put(dev);
 		return err;
 	}
 
@@ -431,9 +418,11 @@ int apt_usbtrx_unique_can_netdev_open(struct net_device *netdev)
 	if (err) {
 		netdev_err(netdev, "couldn't start device: %d\n", err);
 		close_candev(netdev);
+		apt_usbtrx_data_buffer_put(dev);
 		return err;
 	}
 
+	apt_usbtrx_reset_echo_skb(dev);
 	netif_start_queue(netdev);
 
 	return 0;
@@ -460,6 +449,7 @@ int apt_usbtrx_unique_can_netdev_close(struct net_device *netdev)
 
 	candev->can.state = CAN_STATE_STOPPED;
 	atomic_set(&unique_data->if_type, APT_USBTRX_CAN_IF_TYPE_NONE);
+	apt_usbtrx_data_buffer_put(dev);
 
 	return 0;
 }
@@ -469,7 +459,6 @@ netdev_tx_t apt_usbtrx_unique_can_netdev_start_xmit(struct sk_buff *skb, struct
 	apt_usbtrx_candev_t *candev = netdev_priv(netdev);
 	struct can_frame *cf = (struct can_frame *)skb->data;
 	apt_usbtrx_payload_send_can_frame_t send_cf;
-	int tx_data_size;
 	int result;
 	bool silent = candev->can.ctrlmode & CAN_CTRLMODE_LISTENONLY ? true : false;
 
@@ -481,8 +470,7 @@ netdev_tx_t apt_usbtrx_unique_can_netdev_start_xmit(struct sk_buff *skb, struct
 		return NETDEV_TX_OK;
 	}
 
-	tx_data_size = sizeof(send_cf.data) / sizeof(send_cf.data[0]);
-	if (tx_data_size < cf->can_dlc) {
+	if (ARRAY_SIZE(send_cf.data) < cf->can_dlc) {
 		EMSG("tx error. unsupported tx data size.");
 		return NETDEV_TX_BUSY;
 	}
@@ -498,25 +486,36 @@ netdev_tx_t apt_usbtrx_unique_can_netdev_start_xmit(struct sk_buff *skb, struct
 
 	memcpy(send_cf.data, cf->data, cf->can_dlc);
 
-	candev->tx_data_size = tx_data_size;
-
-	netif_stop_queue(netdev);
+	/* SOF_TIMESTAMPING_TX_SOFTWARE, before the echo skb may replace skb with a clone */
+	skb_tx_timestamp(skb);
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 12, 0)
-	can_put_echo_skb(skb, netdev, 0, 0);
-#else
-	can_put_echo_skb(skb, netdev, 0);
-#endif
+	result = apt_usbtrx_put_echo_skb(candev->dev, netdev, skb, cf->can_dlc);
+	if (result != RESULT_Success) {
+		return NETDEV_TX_BUSY;
+	}
 
 	result = apt_usbtrx_write_tx_rb(candev->dev, &send_cf, sizeof(send_cf));
 	if (result < 0) {
 		EMSG("apt_usbtrx_write_rb().. Error");
-		return NETDEV_TX_BUSY;
+		/* the echo skb already owns the frame, drop it instead of requeueing */
+		apt_usbtrx_cancel_echo_skb(candev->dev, netdev);
+		netdev->stats.tx_dropped++;
+		return NETDEV_TX_OK;
 	}
 
 	return NETDEV_TX_OK;
 }
 
+/*!
+ * @brief get timestamping info (ethtool operation)
+ */
+int apt_usbtrx_unique_can_netdev_get_ts_info(struct net_device *netdev, apt_usbtrx_ethtool_ts_info_t *info)
+{
+	apt_usbtrx_candev_t *candev = netdev_priv(netdev);
+
+	return apt_usbtrx_ptp_get_ts_info(candev->dev, info);
+}
+
 /*!
  * @brief set mode (netdev)
  */
@@ -11,13 +11,13 @@
 #include <linux/netdevice.h>
 #include <linux/can/dev.h>
 #include "../apt_usbtrx_def.h"
+#include "../apt_usbtrx_ptp.h"
 
 /*!
  * @brief unique function prototype
  */
 int apt_usbtrx_unique_can_get_read_payload_size(const void *payload);
 int apt_usbtrx_unique_can_get_write_payload_size(const void *payload);
-apt_usbtrx_timestamp_t *apt_usbtrx_unique_can_get_read_payload_timestamp(const void *payload);
 int apt_usbtrx_unique_can_get_write_cmd_id(void);
 int apt_usbtrx_unique_can_get_fw_size(void);
 long apt_usbtrx_unique_can_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
@@ -32,5 +32,6 @@ int apt_usbtrx_unique_can_netdev_set_bittiming(struct net_device *netdev);
 int apt_usbtrx_unique_can_netdev_close(struct net_device *netdev);
 int apt_usbtrx_unique_can_netdev_open(struct net_device *netdev);
 netdev_tx_t apt_usbtrx_unique_can_netdev_start_xmit(struct sk_buff *skb, struct net_device *netdev);
+int apt_usbtrx_unique_can_netdev_get_ts_info(struct net_device *netdev, apt_usbtrx_ethtool_ts_info_t *info);
 
 #endif /* __AP_CT2A_FOPS_H__ */
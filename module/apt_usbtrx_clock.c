@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Device driver for sending and receiving data to and from
+ * EDGEPLANT USB peripherals.
+ *
+ * Copyright (C) 2018 aptpod Inc.
+ */
+
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/time.h>
+
+#include "apt_usbtrx_clock.h"
+#include "apt_usbtrx_def.h"
+
+/*!
+ * @brief reset (lock held)
+ */
+static void apt_usbtrx_clock_reset_locked(apt_usbtrx_clock_t *clock)
+{
+	clock->count = 0;
+	clock->pos = 0;
+	clock->has_candidate = false;
+	clock->interval_start_us = 0;
+	clock->last_dev_us = 0;
+	clock->valid = false;
+	clock->mean_dev_us = 0;
+	clock->mean_host_us = 0;
+	clock->skew_ppb = 0;
+}
+
+/*!
+ * @brief get the i-th oldest sample (lock held)
+ */
+static const apt_usbtrx_clock_sample_t *apt_usbtrx_clock_sample_at(apt_usbtrx_clock_t *clock, unsigned int i)
+{
+	return &clock->samples[(clock->pos + APT_USBTRX_CLOCK_WINDOW - clock->count + i) % APT_USBTRX_CLOCK_WINDOW];
+}
+
+/*!
+ * @brief fit samples with least squares (lock held)
+ * NOTE: |dx| stays below APT_USBTRX_CLOCK_MAX_SPAN_US, so that the sums of squares of the window do not overflow.
+ */
+static void apt_usbtrx_clock_fit(apt_usbtrx_clock_t *clock)
+{
+	const apt_usbtrx_clock_sample_t *base = apt_usbtrx_clock_sample_at(clock, 0);
+	unsigned int n = clock->count;
+	s64 sum_x = 0;
+	s64 sum_y = 0;
+	s64 mean_x;
+	s64 mean_y;
+	s64 sxx = 0;
+	s64 sxy = 0;
+	s64 num;
+	s64 den;
+	unsigned int i;
+
+	clock->valid = false;
+	if (n < APT_USBTRX_CLOCK_MIN_SAMPLES) {
+		return;
+	}
+
+	/* use the oldest sample as origin to keep sums small */
+	for (i = 0; i < n; i++) {
+		const apt_usbtrx_clock_sample_t *sample = apt_usbtrx_clock_sample_at(clock, i);
+
+		sum_x += sample->dev_us - base->dev_us;
+		sum_y += sample->host_us - base->host_us;
+	}
+	mean_x = div64_s64(sum_x, n);
+	mean_y = div64_s64(sum_y, n);
+
+	for (i = 0; i < n; i++) {
+		const apt_usbtrx_clock_sample_t *sample = apt_usbtrx_clock_sample_at(clock, i);
+		s64 dx = sample->dev_us - base->dev_us - mean_x;
+		s64 dy = sample->host_us - base->host_us - mean_y;
+
+		sxx += dx * dx;
+		sxy += dx * dy;
+	}
+
+	den = div64_s64(sxx, USEC_PER_SEC);
+	if (den <= 0) {
+		return;
+	}
+
+	/* slope = sxy / sxx = 1 + skew */
+	num = sxy - sxx;
+	if (abs(num) > div64_s64(sxx, NSEC_PER_SEC / APT_USBTRX_CLOCK_MAX_SKEW_PPB)) {
+		WMSG("clock skew is out of range, reset estimator");
+		apt_usbtrx_clock_reset_locked(clock);
+		return;
+	}
+
+	clock->skew_ppb = div64_s64(num * (NSEC_PER_SEC / USEC_PER_SEC), den);
+	clock->mean_dev_us = base->dev_us + mean_x;
+	clock->mean_host_us = base->host_us + mean_y;
+	clock->valid = true;
+}
+
+/*!
+ * @brief initialize
+ */
+void apt_usbtrx_clock_init(apt_usbtrx_clock_t *clock)
+{
+	spin_lock_init(&clock->lock);
+	apt_usbtrx_clock_reset_locked(clock);
+}
+
+/*!
+ * @brief reset (discard all samples)
+ * NOTE: call when the device timestamp or basetime is reset.
+ */
+void apt_usbtrx_clock_reset(apt_usbtrx_clock_t *clock)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&clock->lock, flags);
+	apt_usbtrx_clock_reset_locked(clock);
+	spin_unlock_irqrestore(&clock->lock, flags);
+}
+
+/*!
+ * @brief add sample
+ */
+void apt_usbtrx_clock_add_sample(apt_usbtrx_clock_t *clock, s64 dev_us, s64 host_us)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&clock->lock, flags);
+
+	if (dev_us < clock->last_dev_us) {
+		/* device timestamp has been reset */
+		apt_usbtrx_clock_reset_locked(clock);
+	}
+	clock->last_dev_us = dev_us;
+
+	if (clock->has_candidate != true) {
+		clock->candidate.dev_us = dev_us;
+		clock->candidate.host_us = host_us;
+		clock->interval_start_us = dev_us;
+		clock->has_candidate = true;
+	} else if (dev_us - clock->interval_start_us >= APT_USBTRX_CLOCK_SAMPLE_INTERVAL_US) {
+		clock->samples[clock->pos] = clock->candidate;
+		clock->pos = (clock->pos + 1) % APT_USBTRX_CLOCK_WINDOW;
+		if (clock->count < APT_USBTRX_CLOCK_WINDOW) {
+			clock->count++;
+		}
+		/* sparse frames stretch the intervals, bound the window by time as well */
+		while (clock->count > 1 && clock->candidate.dev_us - apt_usbtrx_clock_sample_at(clock, 0)->dev_us >
+						   APT_USBTRX_CLOCK_MAX_SPAN_US) {
+			clock->count--;
+		}
+		apt_usbtrx_clock_fit(clock);
+
+		clock->candidate.dev_us = dev_us;
+		clock->candidate.host_us = host_us;
+		clock->interval_start_us = dev_us;
+	} else if (host_us - dev_us < clock->candidate.host_us - clock->candidate.dev_us) {
+		clock->candidate.dev_us = dev_us;
+		clock->candidate.host_us = host_us;
+	}
+
+	spin_unlock_irqrestore(&clock->lock, flags);
+}
+
+/*!
+ * @brief translate device time to host time
+ * @return false if not enough samples
+ */
+bool apt_usbtrx_clock_translate(apt_usbtrx_clock_t *clock, s64 dev_us, s64 *host_us)
+{
+	unsigned long flags;
+	s64 dx;
+
+	spin_lock_irqsave(&clock->lock, flags);
+
+	if (clock->valid != true) {
+		spin_unlock_irqrestore(&clock->lock, flags);
+		return false;
+	}
+
+	/* correction in msec resolution to avoid overflow, the error is below 1 usec */
+	dx = dev_us - clock->mean_dev_us;
+	*host_us = clock->mean_host_us + dx +
+		   div_s64(div_s64(dx, USEC_PER_MSEC) * clock->skew_ppb, NSEC_PER_SEC / MSEC_PER_SEC);
+
+	spin_unlock_irqrestore(&clock->lock, flags);
+
+	return true;
+}
+
+/*!
+ * @brief translate host time to device time
+ * NOTE: first order inverse of apt_usbtrx_clock_translate(), exact enough for |skew| <= 1000 ppm.
+ * @return false if not enough samples
+ */
+bool apt_usbtrx_clock_translate_to_device(apt_usbtrx_clock_t *clock, s64 host_us, s64 *dev_us)
+{
+	unsigned long flags;
+	s64 dy;
+
+	spin_lock_irqsave(&clock->lock, flags);
+
+	if (clock->valid != true) {
+		spin_unlock_irqrestore(&clock->lock, flags);
+		return false;
+	}
+
+	dy = host_us - clock->mean_host_us;
+	*dev_us = clock->mean_dev_us + dy -
+		  div_s64(div_s64(dy, USEC_PER_MSEC) * clock->skew_ppb, NSEC_PER_SEC / MSEC_PER_SEC);
+
+	spin_unlock_irqrestore(&clock->lock, flags);
+
+	return true;
+}
+
+/*!
+ * @brief get fit result
+ * @return false if not enough samples
+ */
+bool apt_usbtrx_clock_get_fit(apt_usbtrx_clock_t *clock, s64 *skew_ppb, s64 *offset_us, unsigned int *count)
+{
+	unsigned long flags;
+	bool valid;
+
+	spin_lock_irqsave(&clock->lock, flags);
+	valid = clock->valid;
+	*skew_ppb = valid ? clock->skew_ppb : 0;
+	*offset_us = valid ? clock->mean_host_us - clock->mean_dev_us : 0;
+	*count = clock->count;
+	spin_unlock_irqrestore(&clock->lock, flags);
+
+	return valid;
+}
@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * EDGEPLANT USB Peripherals Device Driver for Linux.
+ *
+ * Copyright (C) 2018 aptpod Inc.
+ */
+#ifndef __APT_USBTRX_CLOCK_H__
+#define __APT_USBTRX_CLOCK_H__
+
+#include <linux/types.h>
+#include <linux/spinlock.h>
+
+#define APT_USBTRX_CLOCK_WINDOW (64)
+#define APT_USBTRX_CLOCK_MIN_SAMPLES (4)
+#define APT_USBTRX_CLOCK_SAMPLE_INTERVAL_US (1000000)
+#define APT_USBTRX_CLOCK_MAX_SKEW_PPB (1000000)
+#define APT_USBTRX_CLOCK_MAX_SPAN_US (256 * 1000000LL) /* keeps the sums of squares within s64 */
+
+/*!
+ * @brief clock sample (device time and host time of the same frame)
+ */
+struct apt_usbtrx_clock_sample_s {
+	s64 dev_us; /*!< device timestamp */
+	s64 host_us; /*!< host time at urb completion, relative to basetime */
+};
+typedef struct apt_usbtrx_clock_sample_s apt_usbtrx_clock_sample_t;
+
+/*!
+ * @brief device to host clock estimator
+ *
+ * One sample per interval is kept, the one with the smallest host - device
+ * delay, so that USB and scheduling latency do not bias the fit.
+ * The last APT_USBTRX_CLOCK_WINDOW samples within APT_USBTRX_CLOCK_MAX_SPAN_US
+ * of device time are fitted with least squares:
+ *   host_us = mean_host_us + (dev_us - mean_dev_us) * (1 + skew_ppb / 10^9)
+ */
+struct apt_usbtrx_clock_s {
+	spinlock_t lock; /*!< */
+	apt_usbtrx_clock_sample_t samples[APT_USBTRX_CLOCK_WINDOW]; /*!< */
+	unsigned int count; /*!< number of valid samples, the oldest is at pos - count */
+	unsigned int pos; /*!< next sample position */
+	apt_usbtrx_clock_sample_t candidate; /*!< best sample in the current interval */
+	bool has_candidate; /*!< */
+	s64 interval_start_us; /*!< device time the current interval started */
+	s64 last_dev_us; /*!< to detect device timestamp reset */
+
+	/* fit result */
+	bool valid; /*!< */
+	s64 mean_dev_us; /*!< */
+	s64 mean_host_us; /*!< */
+	s64 skew_ppb; /*!< */
+};
+typedef struct apt_usbtrx_clock_s apt_usbtrx_clock_t;
+
+/*!
+ * @brief initialize
+ */
+void apt_usbtrx_clock_init(apt_usbtrx_clock_t *clock);
+
+/*!
+ * @brief reset (discard all samples)
+ */
+void apt_usbtrx_clock_reset(apt_usbtrx_clock_t *clock);
+
+/*!
+ * @brief add sample
+ */
+void apt_usbtrx_clock_add_sample(apt_usbtrx_clock_t *clock, s64 dev_us, s64 host_us);
+
+/*!
+ * @brief translate device time to host time
+ */
+bool apt_usbtrx_clock_translate(apt_usbtrx_clock_t *clock, s64 dev_us, s64 *host_us);
+
+/*!
+ * @brief translate host time to device time
+ */
+bool apt_usbtrx_clock_translate_to_device(apt_usbtrx_clock_t *clock, s64 host_us, s64 *dev_us);
+
+/*!
+ * @brief get fit result
+ */
+bool apt_usbtrx_clock_get_fit(apt_usbtrx_clock_t *clock, s64 *skew_ppb, s64 *offset_us, unsigned int *count);
+
+#endif /* __APT_USBTRX_CLOCK_H__ */
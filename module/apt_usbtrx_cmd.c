@@ -4,8 +4,6 @@
  *
  * Copyright (C) 2018 aptpod Inc.
  */
-#include <linux/slab.h>
-
 #include "apt_usbtrx_cmd_def.h"
 #include "apt_usbtrx_cmd.h"
 #include "apt_usbtrx_msg.h"
@@ -17,6 +15,7 @@
 int apt_usbtrx_get_device_id(apt_usbtrx_dev_t *dev, char *device_id, int device_id_size, int *channel)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_GET_DEVICE_ID;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_RESPONSE_GET_DEVICE_ID;
 	char *resp_data;
@@ -41,18 +40,9 @@ int apt_usbtrx_get_device_id(apt_usbtrx_dev_t *dev, char *device_id, int device_
 		return RESULT_Failure;
 	}
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = APT_USBTRX_CMD_GetDeviceId;
@@ -60,16 +50,14 @@ int apt_usbtrx_get_device_id(apt_usbtrx_dev_t *dev, char *device_id, int device_
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -78,16 +66,14 @@ int apt_usbtrx_get_device_id(apt_usbtrx_dev_t *dev, char *device_id, int device_
 				     resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -95,13 +81,11 @@ int apt_usbtrx_get_device_id(apt_usbtrx_dev_t *dev, char *device_id, int device_
 							     channel);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_response_get_device_id().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -113,6 +97,7 @@ int apt_usbtrx_get_device_id(apt_usbtrx_dev_t *dev, char *device_id, int device_
 int apt_usbtrx_get_fw_version(apt_usbtrx_dev_t *dev, int *major_version, int *minor_version)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_GET_FW_VERSION;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_RESPONSE_GET_FW_VERSION;
 	char *resp_data;
@@ -122,18 +107,9 @@ int apt_usbtrx_get_fw_version(apt_usbtrx_dev_t *dev, int *major_version, int *mi
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = APT_USBTRX_CMD_GetFWVersion;
@@ -141,16 +117,14 @@ int apt_usbtrx_get_fw_version(apt_usbtrx_dev_t *dev, int *major_version, int *mi
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -159,16 +133,14 @@ int apt_usbtrx_get_fw_version(apt_usbtrx_dev_t *dev, int *major_version, int *mi
 				     resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -176,13 +148,11 @@ int apt_usbtrx_get_fw_version(apt_usbtrx_dev_t *dev, int *major_version, int *mi
 							      minor_version);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_response_get_fw_version().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -194,6 +164,7 @@ int apt_usbtrx_get_fw_version(apt_usbtrx_dev_t *dev, int *major_version, int *mi
 int apt_usbtrx_get_fw_version_revision(apt_usbtrx_dev_t *dev, int *major_version, int *minor_version, int *revision)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_GET_FW_VERSION_REVISION;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_RESPONSE_GET_FW_VERSION_REVISION;
 	char *resp_data;
@@ -203,18 +174,9 @@ int apt_usbtrx_get_fw_version_revision(apt_usbtrx_dev_t *dev, int *major_version
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = APT_USBTRX_CMD_GetFWVersionRevision;
@@ -222,16 +184,14 @@ int apt_usbtrx_get_fw_version_revision(apt_usbtrx_dev_t *dev, int *major_version
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -241,16 +201,14 @@ int apt_usbtrx_get_fw_version_revision(apt_usbtrx_dev_t *dev, int *major_version
 	if (result != RESULT_Success) {
 		/* Some devices do not support this command, so it is not an error. */
 		//EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -258,13 +216,11 @@ int apt_usbtrx_get_fw_version_revision(apt_usbtrx_dev_t *dev, int *major_version
 								       major_version, minor_version, revision);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_response_get_fw_version_revision().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -276,6 +232,7 @@ int apt_usbtrx_get_fw_version_revision(apt_usbtrx_dev_t *dev, int *major_version
 int apt_usbtrx_enable_reset_ts(apt_usbtrx_dev_t *dev, bool *success)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_ENABLE_RESET_TS;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_ACK;
 	char *resp_data;
@@ -286,18 +243,9 @@ int apt_usbtrx_enable_reset_ts(apt_usbtrx_dev_t *dev, bool *success)
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = APT_USBTRX_CMD_EnableResetTS;
@@ -305,16 +253,14 @@ int apt_usbtrx_enable_reset_ts(apt_usbtrx_dev_t *dev, bool *success)
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -322,30 +268,26 @@ int apt_usbtrx_enable_reset_ts(apt_usbtrx_dev_t *dev, bool *success)
 	result = apt_usbtrx_wait_msg(dev, APT_USBTRX_CMD_ACK, APT_USBTRX_CMD_NACK, resp_data, resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &id);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_ack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	if (id != APT_USBTRX_CMD_EnableResetTS) {
 		EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, id);
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	switch (resp_msg.id) {
@@ -357,8 +299,7 @@ int apt_usbtrx_enable_reset_ts(apt_usbtrx_dev_t *dev, bool *success)
 		break;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -370,6 +311,7 @@ int apt_usbtrx_enable_reset_ts(apt_usbtrx_dev_t *dev, bool *success)
 int apt_usbtrx_reset_ts(apt_usbtrx_dev_t *dev, bool *success)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_RESET_TS;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_ACK;
 	char *resp_data;
@@ -381,18 +323,9 @@ int apt_usbtrx_reset_ts(apt_usbtrx_dev_t *dev, bool *success)
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** set resettime ***/
 	get_ts64(dev, &ts);
@@ -405,16 +338,14 @@ int apt_usbtrx_reset_ts(apt_usbtrx_dev_t *dev, bool *success)
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -424,35 +355,30 @@ int apt_usbtrx_reset_ts(apt_usbtrx_dev_t *dev, bool *success)
 		if (result == RESULT_Timeout) {
 			WMSG("maybe connect sync cable ?");
 			*success = true;
-			kfree(req_data);
-			kfree(resp_data);
+			apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 			return RESULT_Timeout;
 		}
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &id);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_ack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	if (id != APT_USBTRX_CMD_ResetTS) {
 		EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, id);
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	switch (resp_msg.id) {
@@ -464,8 +390,7 @@ int apt_usbtrx_reset_ts(apt_usbtrx_dev_t *dev, bool *success)
 		break;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -477,17 +402,15 @@ int apt_usbtrx_reset_ts(apt_usbtrx_dev_t *dev, bool *success)
 int apt_usbtrx_reset_device(apt_usbtrx_dev_t *dev, bool *success)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_RESET_DEVICE;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int result;
 	apt_usbtrx_msg_t req_msg;
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
 
 	/*** request ***/
 	req_msg.id = APT_USBTRX_CMD_ResetDevice;
@@ -495,14 +418,14 @@ int apt_usbtrx_reset_device(apt_usbtrx_dev_t *dev, bool *success)
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_async(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_async().. Error");
-		kfree(req_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -545,7 +468,7 @@ int apt_usbtrx_reset_device(apt_usbtrx_dev_t *dev, bool *success)
 	}
 #endif
 
-	kfree(req_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -557,6 +480,7 @@ int apt_usbtrx_reset_device(apt_usbtrx_dev_t *dev, bool *success)
 int apt_usbtrx_get_serial_no(apt_usbtrx_dev_t *dev, char *serial_no, int serial_no_size, int *channel, int *sync_pulse)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_GET_SERIAL_NO;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_RESPONSE_GET_SERIAL_NO;
 	char *resp_data;
@@ -586,18 +510,9 @@ int apt_usbtrx_get_serial_no(apt_usbtrx_dev_t *dev, char *serial_no, int serial_
 		return RESULT_Failure;
 	}
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = APT_USBTRX_CMD_GetSerialNo;
@@ -605,16 +520,14 @@ int apt_usbtrx_get_serial_no(apt_usbtrx_dev_t *dev, char *serial_no, int serial_
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -623,16 +536,14 @@ int apt_usbtrx_get_serial_no(apt_usbtrx_dev_t *dev, char *serial_no, int serial_
 				     resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -640,13 +551,11 @@ int apt_usbtrx_get_serial_no(apt_usbtrx_dev_t *dev, char *serial_no, int serial_
 							     channel, sync_pulse);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_response_get_serial_no().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -655,17 +564,15 @@ int apt_usbtrx_get_serial_no(apt_usbtrx_dev_t *dev, char *serial_no, int serial_
 int apt_usbtrx_move_dfu(apt_usbtrx_dev_t *dev, bool *success)
 {
 	int req_data_size = APT_USBTRX_CMD_LENGTH_MOVE_DFU;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int result;
 	apt_usbtrx_msg_t req_msg;
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
 
 	/*** request ***/
 	req_msg.id = APT_USBTRX_CMD_MoveDFU;
@@ -673,14 +580,14 @@ int apt_usbtrx_move_dfu(apt_usbtrx_dev_t *dev, bool *success)
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_async(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_async().. Error");
-		kfree(req_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -696,30 +603,26 @@ int apt_usbtrx_move_dfu(apt_usbtrx_dev_t *dev, bool *success)
 	result = apt_usbtrx_wait_msg(dev, APT_USBTRX_CMD_ACK, APT_USBTRX_CMD_NACK, resp_data, resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &id);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_ack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	if (id != APT_USBTRX_CMD_MoveDFU) {
 		EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, id);
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	switch (resp_msg.id) {
@@ -732,7 +635,7 @@ int apt_usbtrx_move_dfu(apt_usbtrx_dev_t *dev, bool *success)
 	}
 #endif
 
-	kfree(req_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -6,7 +6,9 @@
  */
 
 #include <linux/slab.h>
+#include <linux/log2.h>
 #include <linux/kthread.h>
+#include <linux/rcupdate.h>
 
 #include "apt_usbtrx_def.h"
 #include "apt_usbtrx_core.h"
@@ -19,7 +21,7 @@
 /*!
  * @brief dump message
  */
-static void apt_usbtrx_dump_msg(apt_usbtrx_msg_t *msg)
+static void apt_usbtrx_dump_msg(apt_usbtrx_msg_view_t *msg)
 {
 	int n = 0;
 
@@ -72,102 +74,132 @@ static void apt_usbtrx_dump_msg(apt_usbtrx_msg_t *msg)
 }
 
 /*!
- * @brief get request command from response command
+ * @brief dispatch NotifyBufferStatus (message handler)
  */
-static inline int get_request_command_from_response_command(int response)
+int apt_usbtrx_dispatch_notify_buffer_status(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg)
 {
-	switch (response) {
-	case APT_USBTRX_CMD_ResponseGetDeviceId:
-		return APT_USBTRX_CMD_GetDeviceId;
+	int rate;
+	int result;
 
-	case APT_USBTRX_CMD_ResponseGetSerialNo:
-		return APT_USBTRX_CMD_GetSerialNo;
+	result = apt_usbtrx_msg_parse_notify_buffer_status(msg->payload, msg->payload_size, &rate);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_msg_parse_notify_buffer_status().. Error");
+		return RESULT_Success;
+	}
+	atomic_set(&dev->tx_buffer_rate, rate);
+	if (rate > APT_USBTRX_TX_TRANSFER_LIMIT_RATE) {
+		WMSG("(%s-if%02d) buffer status:%d", dev->serial_no, dev->ch, rate);
+	}
 
-	case APT_USBTRX_CMD_ResponseGetFWVersion:
-		return APT_USBTRX_CMD_GetFWVersion;
+	return RESULT_Success;
+}
 
-	case APT_USBTRX_CMD_ResponseGetFWVersionRevision:
-		return APT_USBTRX_CMD_GetFWVersionRevision;
+/*!
+ * @brief dispatch ACK/NACK (message handler)
+ */
+int apt_usbtrx_dispatch_ack(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg)
+{
+	int id;
+	int result;
 
-	default:
-		return APT_USBTRX_CMD_Unknown;
+	result = apt_usbtrx_msg_parse_ack(msg->payload, msg->payload_size, &id);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_msg_parse_ack().. Error");
+		return RESULT_Success;
 	}
+	if (id == APT_USBTRX_CMD_ResetTS && msg->id == APT_USBTRX_CMD_ACK) {
+		dev->basetime = *dev->resettime;
+		apt_usbtrx_clock_reset(&dev->clock);
+	}
+	apt_usbtrx_complete_cmd(dev, id, data, APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size));
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief dispatch response to the in-flight request (message handler)
+ * NOTE: the request id is taken from the dispatch table entry of the response.
+ */
+int apt_usbtrx_dispatch_response(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg)
+{
+	u8 request_id = dev->unique_func.msg_table[msg->id].request_id;
+
+	apt_usbtrx_complete_cmd(dev, request_id, data, APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size));
+
+	return RESULT_Success;
 }
 
 /*!
  * @brief dispatch message
  */
-STATIC int apt_usbtrx_dispatch_msg(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_t *msg)
+STATIC int apt_usbtrx_dispatch_msg(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg)
 {
+	const apt_usbtrx_msg_entry_t *entry;
 	bool rx_ongoing = atomic_read(&dev->rx_ongoing);
+	int result;
+
 	if (!rx_ongoing) {
 		return RESULT_Success;
 	}
 
-	switch (msg->id) {
-	case APT_USBTRX_CMD_NotifyBufferStatus: {
-		int rate;
-		int result;
-
-		result = apt_usbtrx_msg_parse_notify_buffer_status(msg->payload, msg->payload_size, &rate);
-		if (result != RESULT_Success) {
-			EMSG("apt_usbtrx_msg_parse_notify_buffer_status().. Error");
-			break;
-		}
-		atomic_set(&dev->tx_buffer_rate, rate);
-		if (rate > APT_USBTRX_TX_TRANSFER_LIMIT_RATE) {
-			WMSG("(%s-if%02d) buffer status:%d", dev->serial_no, dev->ch, rate);
-		}
-		break;
+	entry = &dev->unique_func.msg_table[msg->id];
+	if (entry->handler == NULL) {
+		EMSG_RL("msg is not supported, <id:0x%02x>", msg->id);
+		apt_usbtrx_dump_msg(msg);
+		return RESULT_Failure;
 	}
-	case APT_USBTRX_CMD_ResponseGetDeviceId:
-	case APT_USBTRX_CMD_ResponseGetSerialNo:
-	case APT_USBTRX_CMD_ResponseGetFWVersion:
-	case APT_USBTRX_CMD_ResponseGetFWVersionRevision: {
-		if (dev->rx_complete.id == get_request_command_from_response_command(msg->id)) {
-			DMSG("complete!, <id:0x%02x> length=%d", msg->id,
-			     APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size));
-			dev->rx_complete.data_size = APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size);
-			memcpy(dev->rx_complete.buffer, data, dev->rx_complete.data_size);
-			complete(&dev->rx_complete.complete);
-		}
-		break;
+
+	result = entry->handler(dev, data, msg);
+	if (result != RESULT_Success) {
+		EMSG_RL("dispatch_msg().. Error");
+		apt_usbtrx_dump_msg(msg);
+		return RESULT_Failure;
 	}
-	case APT_USBTRX_CMD_ACK:
-	case APT_USBTRX_CMD_NACK: {
-		int id;
-		int result;
 
-		result = apt_usbtrx_msg_parse_ack(msg->payload, msg->payload_size, &id);
+	return RESULT_Success;
+}
+
+/*!
+ * @brief parse and dispatch received messages in place
+ * NOTE: Parsing stops once limit bytes have been consumed, or at an incomplete message.
+ * @return processed size
+ */
+STATIC int apt_usbtrx_parse_rx_data(apt_usbtrx_dev_t *dev, u8 *data, int data_size, int limit)
+{
+	int processed_size = 0;
+	int remain_size = data_size;
+	int result;
+
+	while (processed_size < limit && remain_size >= APT_USBTRX_CMD_MIN_LENGTH) {
+		apt_usbtrx_msg_view_t msg;
+
+		result = apt_usbtrx_msg_parse_view(&data[processed_size], remain_size, &msg);
 		if (result != RESULT_Success) {
-			EMSG("apt_usbtrx_msg_parse_ack().. Error");
-			break;
-		}
-		if (id == APT_USBTRX_CMD_ResetTS && msg->id == APT_USBTRX_CMD_ACK) {
-			dev->basetime = *dev->resettime;
-		}
-		if (dev->rx_complete.id == id) {
-			DMSG("complete!, <id:0x%02x> length=%d", msg->id,
-			     APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size));
-			dev->rx_complete.data_size = APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size);
-			memcpy(dev->rx_complete.buffer, data, dev->rx_complete.data_size);
-			complete(&dev->rx_complete.complete);
+			int skip_size;
+
+			if (result == RESULT_NotEnough) {
+				break;
+			}
+			skip_size = apt_usbtrx_msg_resync(&data[processed_size], remain_size);
+			atomic64_inc(&dev->rx_resync_count);
+			atomic64_add(skip_size, &dev->rx_resync_bytes);
+			processed_size += skip_size;
+			remain_size -= skip_size;
+			continue;
 		}
-		break;
-	}
-	default: {
-		int result;
-		result = dev->unique_func.dispatch_msg(dev, data, msg);
+
+		result = apt_usbtrx_dispatch_msg(dev, &data[processed_size], &msg);
 		if (result != RESULT_Success) {
-			EMSG_RL("dispatch_msg().. Error");
-			apt_usbtrx_dump_msg(msg);
-			return RESULT_Failure;
 		}
-		break;
-	}
+
+#if 0
+		DMSG("msg is coming!, <id:0x%02x> length=%d", msg.id, APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg.payload_size));
+#endif
+		processed_size += APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg.payload_size);
+		remain_size -= APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg.payload_size);
 	}
 
-	return RESULT_Success;
+	return processed_size;
 }
 
 /*!
@@ -179,9 +211,12 @@ static void apt_usbtrx_read_bulk_callback(struct urb *urb)
 	int recv_size;
 	int result;
 	u8 *buf = dev->rx_transfer.buffer;
+	u8 *urb_buf = urb->transfer_buffer;
+	int carry_size;
 	int total_size;
 	int remain_size;
 	int processed_size;
+	int pos;
 	bool onclosing;
 
 	onclosing = atomic_read(&dev->onclosing);
@@ -210,206 +245,1565 @@ static void apt_usbtrx_read_bulk_callback(struct urb *urb)
 			EMSG("usb_submit_urb().. Error, <errno:%d>", result);
 			return;
 		}
-		return;
+		return;
+	}
+
+	/* host timestamp of every message completed by this urb */
+	dev->rx_urb_time_ns = apt_usbtrx_get_relative_time_ns(dev, &dev->basetime);
+
+	recv_size = urb->actual_length;
+	pos = 0;
+
+	/*
+	 * Only a message straddling the previous urb is reassembled in rx_transfer,
+	 * all others are dispatched directly from the urb buffer.
+	 */
+	carry_size = dev->rx_transfer.data_size;
+	if (carry_size > 0) {
+		int copy_size = min_t(int, recv_size, APT_USBTRX_CMD_MAX_LENGTH);
+
+		memcpy(&buf[carry_size], urb_buf, copy_size);
+		total_size = carry_size + copy_size;
+		processed_size = apt_usbtrx_parse_rx_data(dev, buf, total_size, carry_size);
+		pos = processed_size - carry_size;
+		if (pos < 0) {
+			/* still incomplete, the whole urb has been copied */
+			remain_size = total_size - processed_size;
+			memmove(buf, &buf[processed_size], remain_size);
+			dev->rx_transfer.data_size = remain_size;
+		}
+	}
+
+	if (pos >= 0) {
+		processed_size = apt_usbtrx_parse_rx_data(dev, &urb_buf[pos], recv_size - pos, recv_size - pos);
+		remain_size = recv_size - pos - processed_size;
+		if (remain_size > 0) {
+			memcpy(buf, &urb_buf[pos + processed_size], remain_size);
+		}
+		dev->rx_transfer.data_size = remain_size;
+	}
+
+	usb_fill_bulk_urb(urb, dev->udev, usb_rcvbulkpipe(dev->udev, dev->bulk_in->bEndpointAddress),
+			  urb->transfer_buffer, RX_BUFFER_SIZE, apt_usbtrx_read_bulk_callback, dev);
+	result = usb_submit_urb(urb, GFP_ATOMIC);
+	if (result != 0) {
+		EMSG("usb_submit_rub().. Error, <errno:%d>", result);
+		return;
+	}
+}
+
+/*!
+ * @brief set timestamp (usec)
+ */
+static void apt_usbtrx_set_timestamp_us(apt_usbtrx_timestamp_t *timestamp, u64 time_us)
+{
+	u32 usec;
+
+	timestamp->ts_sec = (u32)div_u64_rem(time_us, USEC_PER_SEC, &usec);
+	timestamp->ts_usec = usec;
+}
+
+/*!
+ * @brief add clock sample of a received frame
+ * NOTE: call for every received data frame, both file and netdev paths.
+ *       The estimator only feeds HOST_CORRECTED timestamps and the ptp clock, it is skipped otherwise.
+ */
+void apt_usbtrx_add_clock_sample(apt_usbtrx_dev_t *dev, const apt_usbtrx_timestamp_t *timestamp)
+{
+	s64 host_us;
+	s64 dev_us;
+
+	if (READ_ONCE(dev->timestamp_mode) != APT_USBTRX_TIMESTAMP_MODE_HOST_CORRECTED && dev->ptp_clock == NULL) {
+		return;
+	}
+
+	host_us = div_u64(dev->rx_urb_time_ns, NSEC_PER_USEC);
+	dev_us = (s64)timestamp->ts_sec * USEC_PER_SEC + timestamp->ts_usec;
+	apt_usbtrx_clock_add_sample(&dev->clock, dev_us, host_us);
+}
+
+/*!
+ * @brief account a frame dropped from rx_data for the next overflow marker (producer side)
+ */
+static void apt_usbtrx_rx_overflow_add(apt_usbtrx_dev_t *dev, const apt_usbtrx_timestamp_t *timestamp,
+				       int payload_size)
+{
+	apt_usbtrx_rx_overflow_t *rx_overflow = &dev->rx_overflow;
+
+	if (timestamp != NULL) {
+		if (rx_overflow->frames == 0) {
+			rx_overflow->first = *timestamp;
+		}
+		rx_overflow->last = *timestamp;
+	}
+	rx_overflow->frames++;
+	rx_overflow->bytes += payload_size;
+}
+
+/*!
+ * @brief write the overflow marker and the payload to rx_data (producer side)
+ * NOTE: The marker is written only together with the next frame, so that it sits at the point of loss.
+ */
+static int apt_usbtrx_write_rx_overflow_marker(apt_usbtrx_dev_t *dev, const apt_usbtrx_timestamp_t *timestamp,
+					       u8 *payload, int payload_size)
+{
+	apt_usbtrx_rx_overflow_t *rx_overflow = &dev->rx_overflow;
+	apt_usbtrx_rx_overflow_marker_t marker;
+	ssize_t wsize;
+
+	if (rx_overflow->frames > 0) {
+		if (apt_usbtrx_ringbuffer_get_free_size(&dev->rx_data) < sizeof(marker) + payload_size) {
+			dev->rx_data.skip_count += payload_size;
+			apt_usbtrx_rx_overflow_add(dev, timestamp, payload_size);
+			return -1;
+		}
+
+		marker.ts_sec = 0;
+		marker.ts_usec = APT_USBTRX_RX_OVERFLOW_MARKER;
+		marker.frames = rx_overflow->frames;
+		marker.bytes = rx_overflow->bytes;
+		marker.first_ts_sec = rx_overflow->first.ts_sec;
+		marker.first_ts_usec = rx_overflow->first.ts_usec;
+		marker.last_ts_sec = rx_overflow->last.ts_sec;
+		marker.last_ts_usec = rx_overflow->last.ts_usec;
+		apt_usbtrx_ringbuffer_write(&dev->rx_data, (u8 *)&marker, sizeof(marker));
+
+		rx_overflow->frames = 0;
+		rx_overflow->bytes = 0;
+	}
+
+	wsize = apt_usbtrx_ringbuffer_write(&dev->rx_data, payload, payload_size);
+	if (wsize < 0) {
+		apt_usbtrx_rx_overflow_add(dev, timestamp, payload_size);
+	}
+
+	return wsize;
+}
+
+/*!
+ * @brief write the payload to rx_data in flight recorder mode (producer side)
+ */
+static int apt_usbtrx_write_rx_capture(apt_usbtrx_dev_t *dev, u8 *payload, int payload_size)
+{
+	apt_usbtrx_rx_capture_t *rx_capture = &dev->rx_capture;
+	unsigned long flags;
+	bool frozen = false;
+	ssize_t wsize;
+
+	spin_lock_irqsave(&rx_capture->lock, flags);
+	switch (rx_capture->state) {
+	case APT_USBTRX_RX_CAPTURE_STATE_ARMED:
+		wsize = apt_usbtrx_ringbuffer_write_overwrite(&dev->rx_data, payload, payload_size,
+							      apt_usbtrx_get_rx_record_size, dev);
+		break;
+	case APT_USBTRX_RX_CAPTURE_STATE_TRIGGERED:
+		wsize = apt_usbtrx_ringbuffer_write_overwrite(&dev->rx_data, payload, payload_size,
+							      apt_usbtrx_get_rx_record_size, dev);
+		if (wsize >= 0 && --rx_capture->remaining == 0) {
+			/* pairs with smp_load_acquire() in apt_usbtrx_rx_data_is_ready() */
+			smp_store_release(&rx_capture->state, APT_USBTRX_RX_CAPTURE_STATE_FROZEN);
+			frozen = true;
+		}
+		break;
+	case APT_USBTRX_RX_CAPTURE_STATE_FROZEN:
+		dev->rx_data.skip_count += payload_size;
+		wsize = -1;
+		break;
+	default:
+		wsize = apt_usbtrx_ringbuffer_write(&dev->rx_data, payload, payload_size);
+		break;
+	}
+	spin_unlock_irqrestore(&rx_capture->lock, flags);
+
+	if (frozen) {
+		wake_up_interruptible(&dev->rx_data.wq);
+	}
+
+	return wsize;
+}
+
+/*!
+ * @brief write received payload to rx_data
+ * NOTE: The device timestamp and the completion time of its rx urb feed the clock estimator,
+ *       then the payload is stamped according to the timestamp mode.
+ *       The timestamp is located by the caller, which knows the fixed frame format of its device.
+ */
+int apt_usbtrx_write_rx_data(apt_usbtrx_dev_t *dev, apt_usbtrx_timestamp_t *timestamp, u8 *payload, int payload_size)
+{
+	if (timestamp != NULL) {
+		s64 host_us = div_u64(dev->rx_urb_time_ns, NSEC_PER_USEC);
+		s64 dev_us = (s64)timestamp->ts_sec * USEC_PER_SEC + timestamp->ts_usec;
+		s64 corrected_us;
+
+		apt_usbtrx_add_clock_sample(dev, timestamp);
+
+		switch (dev->timestamp_mode) {
+		case APT_USBTRX_TIMESTAMP_MODE_HOST:
+			apt_usbtrx_set_timestamp_us(timestamp, host_us);
+			break;
+		case APT_USBTRX_TIMESTAMP_MODE_HOST_CORRECTED:
+			/* fall back to the urb completion time until the estimator converges */
+			if (apt_usbtrx_clock_translate(&dev->clock, dev_us, &corrected_us) != true ||
+			    corrected_us < 0) {
+				corrected_us = host_us;
+			}
+			apt_usbtrx_set_timestamp_us(timestamp, corrected_us);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (READ_ONCE(dev->rx_capture.mode) == APT_USBTRX_RX_CAPTURE_MODE_FLIGHT_RECORDER) {
+		return apt_usbtrx_write_rx_capture(dev, payload, payload_size);
+	}
+
+	if (READ_ONCE(dev->rx_overflow.enable) == true) {
+		return apt_usbtrx_write_rx_overflow_marker(dev, timestamp, payload, payload_size);
+	}
+	dev->rx_overflow.frames = 0;
+	dev->rx_overflow.bytes = 0;
+
+	return apt_usbtrx_ringbuffer_write(&dev->rx_data, payload, payload_size);
+}
+
+/*!
+ * @brief get size of a record in rx_data
+ * NOTE: context is the device, see apt_usbtrx_ringbuffer_get_record_size().
+ */
+int apt_usbtrx_get_rx_record_size(void *context, const void *record)
+{
+	apt_usbtrx_dev_t *dev = context;
+	const apt_usbtrx_rx_overflow_marker_t *marker = record;
+
+	if (marker->ts_usec == APT_USBTRX_RX_OVERFLOW_MARKER) {
+		return sizeof(apt_usbtrx_rx_overflow_marker_t);
+	}
+
+	if (dev->unique_func.get_read_payload_size == NULL) {
+		return -1;
+	}
+
+	return dev->unique_func.get_read_payload_size(record);
+}
+
+/*!
+ * @brief rx reader wakeup timer
+ */
+static enum hrtimer_restart apt_usbtrx_rx_wakeup_timer_func(struct hrtimer *timer)
+{
+	apt_usbtrx_dev_t *dev = container_of(timer, apt_usbtrx_dev_t, rx_wakeup.timer);
+
+	atomic_set(&dev->rx_wakeup.expired, true);
+	wake_up_interruptible(&dev->rx_data.wq);
+
+	return HRTIMER_NORESTART;
+}
+
+/*!
+ * @brief initialize rx reader wakeup
+ */
+void apt_usbtrx_rx_wakeup_init(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_rx_wakeup_t *rx_wakeup = &dev->rx_wakeup;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+	hrtimer_setup(&rx_wakeup->timer, apt_usbtrx_rx_wakeup_timer_func, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+#else
+	hrtimer_init(&rx_wakeup->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	rx_wakeup->timer.function = apt_usbtrx_rx_wakeup_timer_func;
+#endif
+	apt_usbtrx_rx_wakeup_set_default(dev);
+}
+
+/*!
+ * @brief reset rx reader wakeup watermarks to the defaults (wake for every frame)
+ */
+void apt_usbtrx_rx_wakeup_set_default(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_rx_wakeup_t *rx_wakeup = &dev->rx_wakeup;
+
+	WRITE_ONCE(rx_wakeup->min_bytes, 0);
+	WRITE_ONCE(rx_wakeup->min_frames, 0);
+	WRITE_ONCE(rx_wakeup->timeout_us, 0);
+	hrtimer_cancel(&rx_wakeup->timer);
+	atomic_set(&rx_wakeup->frames, 0);
+	atomic_set(&rx_wakeup->expired, false);
+}
+
+/*!
+ * @brief check if a watermark is reached
+ */
+static bool apt_usbtrx_rx_wakeup_is_reached(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_rx_wakeup_t *rx_wakeup = &dev->rx_wakeup;
+	unsigned int min_bytes = READ_ONCE(rx_wakeup->min_bytes);
+	unsigned int min_frames = READ_ONCE(rx_wakeup->min_frames);
+
+	if (min_bytes == 0 && min_frames == 0) {
+		return true;
+	}
+	if (min_frames != 0 && atomic_read(&rx_wakeup->frames) >= min_frames) {
+		return true;
+	}
+	if (min_bytes != 0 && apt_usbtrx_ringbuffer_get_used_size(&dev->rx_data) >= min_bytes) {
+		return true;
+	}
+
+	return atomic_read(&rx_wakeup->expired);
+}
+
+/*!
+ * @brief arm the timeout for the first unread frame
+ */
+static void apt_usbtrx_rx_wakeup_arm(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_rx_wakeup_t *rx_wakeup = &dev->rx_wakeup;
+	unsigned int timeout_us = READ_ONCE(rx_wakeup->timeout_us);
+
+	if (timeout_us != 0 && !hrtimer_is_queued(&rx_wakeup->timer) && !atomic_read(&rx_wakeup->expired)) {
+		hrtimer_start(&rx_wakeup->timer, ns_to_ktime((u64)timeout_us * NSEC_PER_USEC), HRTIMER_MODE_REL);
+	}
+}
+
+/*!
+ * @brief notify the reader of frames written to rx_data
+ * NOTE: call from the message handlers after apt_usbtrx_write_rx_data() (producer side).
+ */
+void apt_usbtrx_notify_rx_data(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_rx_wakeup_t *rx_wakeup = &dev->rx_wakeup;
+
+	/* in flight recorder mode the reader is woken when rx_data is frozen */
+	if (READ_ONCE(dev->rx_capture.state) != APT_USBTRX_RX_CAPTURE_STATE_IDLE) {
+		return;
+	}
+
+	if (READ_ONCE(rx_wakeup->min_bytes) == 0 && READ_ONCE(rx_wakeup->min_frames) == 0) {
+		wake_up_interruptible(&dev->rx_data.wq);
+		return;
+	}
+
+	atomic_inc(&rx_wakeup->frames);
+	if (apt_usbtrx_rx_wakeup_is_reached(dev)) {
+		wake_up_interruptible(&dev->rx_data.wq);
+		return;
+	}
+	apt_usbtrx_rx_wakeup_arm(dev);
+}
+
+/*!
+ * @brief check if rx_data is ready to be read
+ * NOTE: call on the consumer side, the watermark state is restarted once rx_data is drained.
+ */
+bool apt_usbtrx_rx_data_is_ready(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_rx_wakeup_t *rx_wakeup = &dev->rx_wakeup;
+
+	/* pairs with smp_store_release() of the capture state */
+	switch (smp_load_acquire(&dev->rx_capture.state)) {
+	case APT_USBTRX_RX_CAPTURE_STATE_ARMED:
+	case APT_USBTRX_RX_CAPTURE_STATE_TRIGGERED:
+		return false;
+	case APT_USBTRX_RX_CAPTURE_STATE_FROZEN:
+		return apt_usbtrx_ringbuffer_is_empty(&dev->rx_data) != true;
+	default:
+		break;
+	}
+
+	if (apt_usbtrx_ringbuffer_is_empty(&dev->rx_data) != true) {
+		return apt_usbtrx_rx_wakeup_is_reached(dev);
+	}
+
+	if (atomic_read(&rx_wakeup->frames) != 0 || atomic_read(&rx_wakeup->expired)) {
+		hrtimer_try_to_cancel(&rx_wakeup->timer);
+		atomic_set(&rx_wakeup->frames, 0);
+		atomic_set(&rx_wakeup->expired, false);
+		smp_mb__after_atomic();
+		/* a frame may have been queued in the meantime, keep its timeout running */
+		if (apt_usbtrx_ringbuffer_is_empty(&dev->rx_data) != true) {
+			atomic_inc(&rx_wakeup->frames);
+			apt_usbtrx_rx_wakeup_arm(dev);
+		}
+	}
+
+	return false;
+}
+
+/*!
+ * @brief initialize rx capture
+ */
+void apt_usbtrx_rx_capture_init(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_rx_capture_t *rx_capture = &dev->rx_capture;
+
+	spin_lock_init(&rx_capture->lock);
+	mutex_init(&rx_capture->read_lock);
+	rx_capture->mode = APT_USBTRX_RX_CAPTURE_MODE_STREAM;
+	rx_capture->state = APT_USBTRX_RX_CAPTURE_STATE_IDLE;
+	rx_capture->post_frames = 0;
+	rx_capture->remaining = 0;
+	rx_capture->can_id_enable = false;
+	rx_capture->can_id = 0;
+	rx_capture->can_mask = 0;
+}
+
+/*!
+ * @brief set rx capture
+ * NOTE: call on the consumer side, arming the flight recorder discards rx_data.
+ * @return RESULT_Failure if the flight recorder is requested while rx_data is mapped
+ */
+int apt_usbtrx_rx_capture_set(apt_usbtrx_dev_t *dev, const apt_usbtrx_ioctl_rx_capture_t *param)
+{
+	apt_usbtrx_rx_capture_t *rx_capture = &dev->rx_capture;
+	unsigned long flags;
+
+	/* no reader is inside rx_data while the producer starts moving tail */
+	mutex_lock(&rx_capture->read_lock);
+	spin_lock_irqsave(&rx_capture->lock, flags);
+	/* an mmap consumer updates tail on its own */
+	if (param->mode == APT_USBTRX_RX_CAPTURE_MODE_FLIGHT_RECORDER && atomic_read(&dev->rx_data_mapped) != 0) {
+		spin_unlock_irqrestore(&rx_capture->lock, flags);
+		mutex_unlock(&rx_capture->read_lock);
+		return RESULT_Failure;
+	}
+	rx_capture->post_frames = param->post_frames;
+	rx_capture->remaining = 0;
+	rx_capture->can_id_enable = (param->can_id_enable == 1);
+	rx_capture->can_id = param->can_id;
+	rx_capture->can_mask = param->can_mask;
+	if (param->mode == APT_USBTRX_RX_CAPTURE_MODE_FLIGHT_RECORDER) {
+		apt_usbtrx_ringbuffer_clear(&dev->rx_data);
+		smp_store_release(&rx_capture->state, APT_USBTRX_RX_CAPTURE_STATE_ARMED);
+	} else {
+		smp_store_release(&rx_capture->state, APT_USBTRX_RX_CAPTURE_STATE_IDLE);
+	}
+	WRITE_ONCE(rx_capture->mode, param->mode);
+	spin_unlock_irqrestore(&rx_capture->lock, flags);
+	mutex_unlock(&rx_capture->read_lock);
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief reset rx capture to the default (stream mode)
+ */
+void apt_usbtrx_rx_capture_set_default(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_ioctl_rx_capture_t param = {
+		.mode = APT_USBTRX_RX_CAPTURE_MODE_STREAM,
+	};
+
+	apt_usbtrx_rx_capture_set(dev, &param);
+}
+
+/*!
+ * @brief lock rx_data for a reader (read(), GET_RX_QUEUED)
+ * NOTE: the flight recorder producer moves tail while armed or triggered, readers are refused then.
+ * @return 0 with rx_capture.read_lock held, or negative errno
+ */
+int apt_usbtrx_rx_capture_read_lock(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_rx_capture_t *rx_capture = &dev->rx_capture;
+	unsigned long flags;
+	int state;
+	int result;
+
+	result = mutex_lock_interruptible(&rx_capture->read_lock);
+	if (result != 0) {
+		return result;
+	}
+
+	spin_lock_irqsave(&rx_capture->lock, flags);
+	state = rx_capture->state;
+	spin_unlock_irqrestore(&rx_capture->lock, flags);
+
+	/* the state leaves IDLE/FROZEN only through apt_usbtrx_rx_capture_set(), which waits for read_lock */
+	if (state != APT_USBTRX_RX_CAPTURE_STATE_IDLE && state != APT_USBTRX_RX_CAPTURE_STATE_FROZEN) {
+		mutex_unlock(&rx_capture->read_lock);
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
+/*!
+ * @brief unlock rx_data for a reader
+ */
+void apt_usbtrx_rx_capture_read_unlock(apt_usbtrx_dev_t *dev)
+{
+	mutex_unlock(&dev->rx_capture.read_lock);
+}
+
+/*!
+ * @brief get rx mmap permission
+ * NOTE: rx_data is not mapped in flight recorder mode, the producer moves tail then.
+ * @return RESULT_Failure in flight recorder mode
+ */
+int apt_usbtrx_rx_capture_map_get(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_rx_capture_t *rx_capture = &dev->rx_capture;
+	unsigned long flags;
+	int result = RESULT_Success;
+
+	spin_lock_irqsave(&rx_capture->lock, flags);
+	if (rx_capture->mode == APT_USBTRX_RX_CAPTURE_MODE_FLIGHT_RECORDER) {
+		result = RESULT_Failure;
+	} else {
+		atomic_inc(&dev->rx_data_mapped);
+	}
+	spin_unlock_irqrestore(&rx_capture->lock, flags);
+
+	return result;
+}
+
+/*!
+ * @brief get rx capture
+ */
+void apt_usbtrx_rx_capture_get(apt_usbtrx_dev_t *dev, apt_usbtrx_ioctl_rx_capture_t *param)
+{
+	apt_usbtrx_rx_capture_t *rx_capture = &dev->rx_capture;
+	unsigned long flags;
+
+	spin_lock_irqsave(&rx_capture->lock, flags);
+	param->mode = rx_capture->mode;
+	param->post_frames = rx_capture->post_frames;
+	param->can_id_enable = rx_capture->can_id_enable ? 1 : 0;
+	param->can_id = rx_capture->can_id;
+	param->can_mask = rx_capture->can_mask;
+	param->state = rx_capture->state;
+	spin_unlock_irqrestore(&rx_capture->lock, flags);
+}
+
+/*!
+ * @brief trigger rx capture
+ * @return RESULT_Failure if the flight recorder is not armed
+ */
+int apt_usbtrx_rx_capture_trigger(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_rx_capture_t *rx_capture = &dev->rx_capture;
+	unsigned long flags;
+	bool frozen = false;
+
+	spin_lock_irqsave(&rx_capture->lock, flags);
+	if (rx_capture->state != APT_USBTRX_RX_CAPTURE_STATE_ARMED) {
+		spin_unlock_irqrestore(&rx_capture->lock, flags);
+		return RESULT_Failure;
+	}
+	if (rx_capture->post_frames == 0) {
+		smp_store_release(&rx_capture->state, APT_USBTRX_RX_CAPTURE_STATE_FROZEN);
+		frozen = true;
+	} else {
+		rx_capture->remaining = rx_capture->post_frames;
+		smp_store_release(&rx_capture->state, APT_USBTRX_RX_CAPTURE_STATE_TRIGGERED);
+	}
+	spin_unlock_irqrestore(&rx_capture->lock, flags);
+
+	if (frozen) {
+		wake_up_interruptible(&dev->rx_data.wq);
+	}
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief trigger rx capture if the can id matches (producer side)
+ * NOTE: call from the message handlers before apt_usbtrx_write_rx_data(), the matched frame is stored too.
+ */
+void apt_usbtrx_rx_capture_match_can_id(apt_usbtrx_dev_t *dev, u32 can_id)
+{
+	apt_usbtrx_rx_capture_t *rx_capture = &dev->rx_capture;
+	unsigned long flags;
+
+	if (READ_ONCE(rx_capture->mode) != APT_USBTRX_RX_CAPTURE_MODE_FLIGHT_RECORDER) {
+		return;
+	}
+
+	spin_lock_irqsave(&rx_capture->lock, flags);
+	if (rx_capture->state == APT_USBTRX_RX_CAPTURE_STATE_ARMED && rx_capture->can_id_enable &&
+	    ((can_id ^ rx_capture->can_id) & rx_capture->can_mask) == 0) {
+		rx_capture->remaining = rx_capture->post_frames + 1;
+		smp_store_release(&rx_capture->state, APT_USBTRX_RX_CAPTURE_STATE_TRIGGERED);
+	}
+	spin_unlock_irqrestore(&rx_capture->lock, flags);
+}
+
+/*!
+ * @brief reset rx settings to the defaults
+ */
+static void apt_usbtrx_rx_settings_set_default(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_rx_wakeup_set_default(dev);
+	WRITE_ONCE(dev->rx_overflow.enable, false);
+	apt_usbtrx_rx_capture_set_default(dev);
+}
+
+/*!
+ * @brief get rx settings (call at open of the device file)
+ * NOTE: the settings are per device and shared by all open files, the first opener resets them.
+ */
+void apt_usbtrx_rx_settings_get(apt_usbtrx_dev_t *dev)
+{
+	mutex_lock(&dev->rx_settings_lock);
+	if (dev->rx_settings_users++ == 0) {
+		apt_usbtrx_rx_settings_set_default(dev);
+	}
+	mutex_unlock(&dev->rx_settings_lock);
+}
+
+/*!
+ * @brief put rx settings (call at release of the device file)
+ * NOTE: the last release resets the settings, so that a netdev open finds the defaults.
+ */
+void apt_usbtrx_rx_settings_put(apt_usbtrx_dev_t *dev)
+{
+	mutex_lock(&dev->rx_settings_lock);
+	if (--dev->rx_settings_users == 0) {
+		apt_usbtrx_rx_settings_set_default(dev);
+	}
+	mutex_unlock(&dev->rx_settings_lock);
+}
+
+/*!
+ * @brief hold rx_data/tx_data
+ * NOTE: call on file or netdev open, the rings are not resized while held.
+ */
+void apt_usbtrx_data_buffer_get(apt_usbtrx_dev_t *dev)
+{
+	mutex_lock(&dev->data_buffer_lock);
+	dev->data_buffer_users++;
+	mutex_unlock(&dev->data_buffer_lock);
+}
+
+/*!
+ * @brief release rx_data/tx_data
+ * NOTE: call on file or netdev close.
+ */
+void apt_usbtrx_data_buffer_put(apt_usbtrx_dev_t *dev)
+{
+	mutex_lock(&dev->data_buffer_lock);
+	dev->data_buffer_users--;
+	mutex_unlock(&dev->data_buffer_lock);
+}
+
+/*!
+ * @brief lock rx_data/tx_data for resizing
+ * @return 0 with data_buffer_lock held, or negative errno
+ */
+static int apt_usbtrx_data_buffer_lock_idle(apt_usbtrx_dev_t *dev)
+{
+	mutex_lock(&dev->data_buffer_lock);
+
+	if (atomic_read(&dev->onclosing) == true) {
+		mutex_unlock(&dev->data_buffer_lock);
+		return -ESHUTDOWN;
+	}
+
+	if (dev->data_buffer_users > 0) {
+		mutex_unlock(&dev->data_buffer_lock);
+		EMSG("Device is in use");
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
+/*!
+ * @brief resize rx_data
+ * NOTE: only while neither the device file nor the netdev is open and rx_data is not mapped,
+ *       received data is discarded.
+ * @return 0 or negative errno
+ */
+int apt_usbtrx_resize_rx_data(apt_usbtrx_dev_t *dev, size_t size)
+{
+	int result;
+
+	result = apt_usbtrx_data_buffer_lock_idle(dev);
+	if (result != 0) {
+		return result;
+	}
+
+	/*
+	 * A mapping outlives the close of its file. rx_data_mapped leaves 0 only in mmap(),
+	 * which needs an open file, so it cannot rise while data_buffer_users is 0.
+	 */
+	if (atomic_read(&dev->rx_data_mapped) != 0) {
+		mutex_unlock(&dev->data_buffer_lock);
+		EMSG("rx_data is mapped");
+		return -EBUSY;
+	}
+
+	/* wait for rx urb callbacks that still saw the file open, they run in atomic context */
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4, 20, 0)
+	synchronize_sched();
+#else
+	synchronize_rcu();
+#endif
+
+	result = apt_usbtrx_ringbuffer_resize(&dev->rx_data, size);
+	mutex_unlock(&dev->data_buffer_lock);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_ringbuffer_resize().. Error, <size:%zu>", size);
+		return -ENOMEM;
+	}
+
+	IMSG("rx_data resized, <size:%zu>", dev->rx_data.buffer_size);
+	return 0;
+}
+
+/*!
+ * @brief resize tx_data
+ * NOTE: only while neither the device file nor the netdev is open and tx_data has been drained.
+ * @return 0 or negative errno
+ */
+int apt_usbtrx_resize_tx_data(apt_usbtrx_dev_t *dev, size_t size)
+{
+	int result;
+
+	/* tx_data and the tx thread are set up by the device interrogation */
+	result = wait_for_completion_interruptible(&dev->init_done);
+	if (result != 0) {
+		return result;
+	}
+
+	result = apt_usbtrx_data_buffer_lock_idle(dev);
+	if (result != 0) {
+		return result;
+	}
+
+	/* not in DFU mode */
+	if (dev->tx_thread == NULL || dev->tx_data.buffer == NULL) {
+		mutex_unlock(&dev->data_buffer_lock);
+		return -ENODEV;
+	}
+
+	kthread_park(dev->tx_thread);
+	if (apt_usbtrx_ringbuffer_is_empty(&dev->tx_data) != true) {
+		kthread_unpark(dev->tx_thread);
+		mutex_unlock(&dev->data_buffer_lock);
+		EMSG("tx_data is not drained yet");
+		return -EBUSY;
+	}
+	result = apt_usbtrx_ringbuffer_resize(&dev->tx_data, size);
+	kthread_unpark(dev->tx_thread);
+	mutex_unlock(&dev->data_buffer_lock);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_ringbuffer_resize().. Error, <size:%zu>", size);
+		return -ENOMEM;
+	}
+
+	IMSG("tx_data resized, <size:%zu>", dev->tx_data.buffer_size);
+	return 0;
+}
+
+/*!
+ * @brief setup rx urbs
+ */
+int apt_usbtrx_setup_rx_urbs(apt_usbtrx_dev_t *dev)
+{
+	int result;
+	int idx;
+
+	CHKMSG("ENTER");
+
+	memset(dev->rx_transfer.buffer, 0, dev->rx_transfer.buffer_size);
+	dev->rx_transfer.data_size = 0;
+
+	for (idx = 0; idx < MAX_RX_URBS; idx++) {
+		struct urb *urb = NULL;
+		u8 *buf = NULL;
+		dma_addr_t buf_dma;
+
+		urb = usb_alloc_urb(0, GFP_KERNEL);
+		if (urb == NULL) {
+			EMSG("usb_alloc_urb().. Error");
+			break;
+		}
+
+		buf = usb_alloc_coherent(dev->udev, RX_BUFFER_SIZE, GFP_KERNEL, &buf_dma);
+		if (buf == NULL) {
+			EMSG("usb_alloc_coherent().. Error");
+			usb_free_urb(urb);
+			break;
+		}
+
+		usb_fill_bulk_urb(urb, dev->udev, usb_rcvbulkpipe(dev->udev, dev->bulk_in->bEndpointAddress), buf,
+				  RX_BUFFER_SIZE, apt_usbtrx_read_bulk_callback, dev);
+		urb->transfer_dma = buf_dma;
+		urb->transfer_flags |= URB_NO_TRANSFER_DMA_MAP;
+		usb_anchor_urb(urb, &dev->rx_submitted);
+
+		result = usb_submit_urb(urb, GFP_KERNEL);
+		if (result != 0) {
+			EMSG("usb_submit_urb().. Error, <errno:%d>", result);
+			usb_unanchor_urb(urb);
+			usb_free_coherent(dev->udev, RX_BUFFER_SIZE, buf, buf_dma);
+			usb_free_urb(urb);
+			break;
+		}
+
+		dev->rxbuf[idx] = buf;
+		dev->rxbuf_dma[idx] = buf_dma;
+		usb_free_urb(urb);
+	}
+
+	if (idx < MAX_RX_URBS) {
+		EMSG("%s: setup error, <idx:%d>", __func__, idx);
+		return RESULT_Failure;
+	}
+
+	atomic_set(&dev->rx_ongoing, true);
+
+	CHKMSG("LEAVE");
+	return RESULT_Success;
+}
+
+/*!
+ * @brief finish tx messages (echo skbs and statistics)
+ * NOTE: status is 0 if the messages reached the device, -ECANCELED if the driver dropped them.
+ */
+static void apt_usbtrx_finish_tx_msgs(apt_usbtrx_dev_t *dev, int msg_count, unsigned int gen, int status)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->tx_echo.lock, flags);
+	/* messages sent before the last reset or flush own no echo slot any more */
+	if (gen == dev->tx_echo.gen) {
+		dev->unique_func.write_bulk_callback(dev, msg_count, status);
+	}
+	spin_unlock_irqrestore(&dev->tx_echo.lock, flags);
+}
+
+/*!
+ * @brief tx bulk callback
+ */
+static void apt_usbtrx_write_bulk_callback(struct urb *urb)
+{
+	apt_usbtrx_dev_t *dev = urb->context;
+	int status = urb->status;
+	int msg_count = 0;
+	unsigned int gen = 0;
+	int idx;
+
+	switch (status) {
+	case 0:
+		break;
+	case -ENOENT:
+	case -ECONNRESET:
+	case -ESHUTDOWN:
+		break;
+	default:
+		EMSG("write bulk error, <status:%d>", status);
+		break;
+	}
+
+	/* give the urb back to the pool */
+	for (idx = 0; idx < MAX_TX_URBS; idx++) {
+		if (dev->tx_urbs[idx] == urb) {
+			msg_count = dev->txbuf_msgs[idx];
+			gen = dev->txbuf_gen[idx];
+			set_bit(idx, &dev->tx_urbs_free);
+			break;
+		}
+	}
+	up(&dev->tx_usb_transfer_sem);
+
+	apt_usbtrx_finish_tx_msgs(dev, msg_count, gen, status);
+}
+
+/*!
+ * @brief allocate tx urb pool
+ */
+int apt_usbtrx_alloc_tx_urbs(apt_usbtrx_dev_t *dev)
+{
+	int idx;
+
+	CHKMSG("ENTER");
+
+	dev->tx_urbs_free = 0;
+
+	for (idx = 0; idx < MAX_TX_URBS; idx++) {
+		struct urb *urb = NULL;
+		u8 *buf = NULL;
+
+		urb = usb_alloc_urb(0, GFP_KERNEL);
+		if (urb == NULL) {
+			EMSG("usb_alloc_urb().. Error");
+			break;
+		}
+
+		buf = usb_alloc_coherent(dev->udev, dev->tx_aggregate_buffer_size, GFP_KERNEL, &dev->txbuf_dma[idx]);
+		if (buf == NULL) {
+			EMSG("usb_alloc_coherent().. Error, <size:%zu>", dev->tx_aggregate_buffer_size);
+			usb_free_urb(urb);
+			break;
+		}
+
+		dev->tx_urbs[idx] = urb;
+		dev->txbuf[idx] = buf;
+		set_bit(idx, &dev->tx_urbs_free);
+	}
+
+	if (idx < MAX_TX_URBS) {
+		EMSG("%s: setup error, <idx:%d>", __func__, idx);
+		apt_usbtrx_free_tx_urbs(dev);
+		return RESULT_Failure;
+	}
+
+	CHKMSG("LEAVE");
+	return RESULT_Success;
+}
+
+/*!
+ * @brief free tx urb pool
+ * NOTE: tx_submitted must have been killed beforehand.
+ */
+void apt_usbtrx_free_tx_urbs(apt_usbtrx_dev_t *dev)
+{
+	int idx;
+
+	for (idx = 0; idx < MAX_TX_URBS; idx++) {
+		if (dev->txbuf[idx] != NULL) {
+			usb_free_coherent(dev->udev, dev->tx_aggregate_buffer_size, dev->txbuf[idx],
+					  dev->txbuf_dma[idx]);
+			dev->txbuf[idx] = NULL;
+		}
+		if (dev->tx_urbs[idx] != NULL) {
+			usb_free_urb(dev->tx_urbs[idx]);
+			dev->tx_urbs[idx] = NULL;
+		}
+	}
+	dev->tx_urbs_free = 0;
+}
+
+/*!
+ * @brief setup tx urb
+ * NOTE: The caller must hold tx_usb_transfer_sem, which guarantees an idle urb in the pool.
+ */
+int apt_usbtrx_setup_tx_urb(apt_usbtrx_dev_t *dev, u8 *data, int data_size, int msg_count)
+{
+	struct urb *urb = NULL;
+	int idx;
+	int result;
+
+	if (data_size > dev->tx_aggregate_buffer_size) {
+		EMSG("invalid data_size, <size:%d>", data_size);
+		return RESULT_Failure;
+	}
+
+	do {
+		idx = find_first_bit(&dev->tx_urbs_free, MAX_TX_URBS);
+		if (idx >= MAX_TX_URBS) {
+			EMSG("no idle tx urb");
+			return RESULT_Failure;
+		}
+	} while (test_and_clear_bit(idx, &dev->tx_urbs_free) == 0);
+
+	urb = dev->tx_urbs[idx];
+	dev->txbuf_msgs[idx] = msg_count;
+	dev->txbuf_gen[idx] = READ_ONCE(dev->tx_echo.gen);
+
+	memcpy(dev->txbuf[idx], data, data_size);
+	usb_fill_bulk_urb(urb, dev->udev, usb_sndbulkpipe(dev->udev, dev->bulk_out->bEndpointAddress),
+			  dev->txbuf[idx], data_size, apt_usbtrx_write_bulk_callback, dev);
+	urb->transfer_dma = dev->txbuf_dma[idx];
+	urb->transfer_flags = URB_NO_TRANSFER_DMA_MAP;
+	if (atomic_read(&dev->tx_aggregate) == true) {
+		/* terminate a transfer of exactly wMaxPacketSize multiples */
+		urb->transfer_flags |= URB_ZERO_PACKET;
+	}
+	usb_anchor_urb(urb, &dev->tx_submitted);
+
+	result = usb_submit_urb(urb, GFP_KERNEL);
+	if (result != 0) {
+		EMSG("usb_submit_urb().. Error, <errno:%d>", result);
+		usb_unanchor_urb(urb);
+		set_bit(idx, &dev->tx_urbs_free);
+		return RESULT_Failure;
+	}
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief reset echo skb tracking
+ * NOTE: frames left in tx_data by the previous session are discarded, their echo skbs are gone.
+ */
+void apt_usbtrx_reset_echo_skb(apt_usbtrx_dev_t *dev)
+{
+	unsigned long flags;
+
+	if (dev->tx_thread != NULL) {
+		kthread_park(dev->tx_thread);
+		apt_usbtrx_ringbuffer_clear(&dev->tx_data);
+	}
+
+	spin_lock_irqsave(&dev->tx_echo.lock, flags);
+	/* urbs still in flight complete against the previous generation */
+	dev->tx_echo.gen++;
+	/* a power of two, so that the slot index stays continuous when head/tail wrap */
+	dev->tx_echo.max = rounddown_pow_of_two(clamp_t(unsigned int, dev->echo_skb_max, 1, APT_USBTRX_ECHO_SKB_MAX));
+	dev->tx_echo.head = 0;
+	dev->tx_echo.tail = 0;
+	spin_unlock_irqrestore(&dev->tx_echo.lock, flags);
+
+	if (dev->tx_thread != NULL) {
+		kthread_unpark(dev->tx_thread);
+	}
+}
+
+#ifdef SUPPORT_NETDEV
+/*!
+ * @brief put echo skb to the next slot
+ * NOTE: called in start_xmit, the queue is stopped when all slots are in flight.
+ */
+int apt_usbtrx_put_echo_skb(apt_usbtrx_dev_t *dev, struct net_device *netdev, struct sk_buff *skb, u8 len)
+{
+	apt_usbtrx_tx_echo_t *echo = &dev->tx_echo;
+	unsigned int head = echo->head;
+	unsigned int idx;
+
+	if (head - READ_ONCE(echo->tail) >= echo->max) {
+		netif_stop_queue(netdev);
+		return RESULT_Failure;
+	}
+
+	idx = head & (echo->max - 1);
+	echo->len[idx] = len;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 12, 0)
+	can_put_echo_skb(skb, netdev, idx, 0);
+#else
+	can_put_echo_skb(skb, netdev, idx);
+#endif
+	/* pairs with smp_load_acquire() in apt_usbtrx_complete_echo_skb() */
+	smp_store_release(&echo->head, head + 1);
+
+	if (head + 1 - READ_ONCE(echo->tail) >= echo->max) {
+		netif_stop_queue(netdev);
+		/* a completion may have freed a slot before the queue was stopped */
+		smp_mb();
+		if (head + 1 - READ_ONCE(echo->tail) < echo->max) {
+			netif_wake_queue(netdev);
+		}
+	}
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief cancel the last put echo skb
+ * NOTE: the frame must not have reached tx_data.
+ */
+void apt_usbtrx_cancel_echo_skb(apt_usbtrx_dev_t *dev, struct net_device *netdev)
+{
+	apt_usbtrx_tx_echo_t *echo = &dev->tx_echo;
+	unsigned int head = echo->head - 1;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+	can_free_echo_skb(netdev, head & (echo->max - 1), NULL);
+#else
+	can_free_echo_skb(netdev, head & (echo->max - 1));
+#endif
+	smp_store_release(&echo->head, head);
+	smp_mb();
+
+	if (head - READ_ONCE(echo->tail) < echo->max) {
+		netif_wake_queue(netdev);
+	}
+}
+
+/*!
+ * @brief complete echo skbs in order
+ * NOTE: called in write bulk callback with the number of messages in the urb.
+ * @return number of completed frames
+ */
+unsigned int apt_usbtrx_complete_echo_skb(apt_usbtrx_dev_t *dev, struct net_device *netdev, int msg_count,
+					  u64 *bytes)
+{
+	apt_usbtrx_tx_echo_t *echo = &dev->tx_echo;
+	unsigned int tail = echo->tail;
+	unsigned int head;
+	unsigned int packets = 0;
+
+	/* pairs with smp_store_release() in apt_usbtrx_put_echo_skb() */
+	head = smp_load_acquire(&echo->head);
+
+	*bytes = 0;
+	while (msg_count > 0 && tail != head) {
+		unsigned int idx = tail & (echo->max - 1);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 12, 0)
+		can_get_echo_skb(netdev, idx, NULL);
+#else
+		can_get_echo_skb(netdev, idx);
+#endif
+		*bytes += echo->len[idx];
+		packets++;
+		tail++;
+		msg_count--;
+	}
+
+	WRITE_ONCE(echo->tail, tail);
+	/* order the tail update against the queue state check */
+	smp_mb();
+
+	if (head - tail < echo->max) {
+		netif_wake_queue(netdev);
+	}
+
+	return packets;
+}
+
+/*!
+ * @brief free echo skbs in order, without looping them back
+ * NOTE: called in write bulk callback for messages that did not reach the device.
+ * @return number of freed frames
+ */
+unsigned int apt_usbtrx_free_echo_skb(apt_usbtrx_dev_t *dev, struct net_device *netdev, int msg_count)
+{
+	apt_usbtrx_tx_echo_t *echo = &dev->tx_echo;
+	unsigned int tail = echo->tail;
+	unsigned int head;
+	unsigned int packets = 0;
+
+	/* pairs with smp_store_release() in apt_usbtrx_put_echo_skb() */
+	head = smp_load_acquire(&echo->head);
+
+	while (msg_count > 0 && tail != head) {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+		can_free_echo_skb(netdev, tail & (echo->max - 1), NULL);
+#else
+		can_free_echo_skb(netdev, tail & (echo->max - 1));
+#endif
+		packets++;
+		tail++;
+		msg_count--;
+	}
+
+	WRITE_ONCE(echo->tail, tail);
+	/* order the tail update against the queue state check */
+	smp_mb();
+
+	if (head - tail < echo->max) {
+		netif_wake_queue(netdev);
+	}
+
+	return packets;
+}
+#endif
+
+/*!
+ * @brief send message internal
+ */
+static int apt_usbtrx_send_msg_internal(apt_usbtrx_dev_t *dev, u8 *data, int data_size)
+{
+	int send_size;
+	int result;
+
+	DMSG("%s(): data size=%d, data=%02x, %02x, %02x, ...", __func__, data_size, data[0], data[1], data[2]);
+
+	result = usb_bulk_msg(dev->udev, usb_sndbulkpipe(dev->udev, dev->bulk_out->bEndpointAddress), data, data_size,
+			      &send_size, APT_USBTRX_SEND_TIMEOUT);
+	if (result != 0) {
+		EMSG("usb_bulk_msg().. Error, <errno:%d> data size=%d>", result, data_size);
+		return RESULT_Failure;
+	}
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief initialize command request
+ * @param data packed request message, must stay valid until the request is completed
+ * @param timeout_msec response timeout (0: no timeout for requests with a callback)
+ * @param callback completion callback (NULL: wait with apt_usbtrx_cmd_wait())
+ */
+void apt_usbtrx_cmd_req_init(apt_usbtrx_cmd_req_t *req, u8 *data, int data_size, unsigned int timeout_msec,
+			     apt_usbtrx_cmd_callback_t callback, void *context)
+{
+	req->id = data[2];
+	req->data = data;
+	req->data_size = data_size;
+	req->timeout_msec = timeout_msec;
+	req->expires = jiffies;
+	req->status = RESULT_Failure;
+	req->resp_size = 0;
+	req->callback = callback;
+	req->context = context;
+	init_completion(&req->done);
+}
+
+/*!
+ * @brief finish command request (lock released)
+ */
+static void apt_usbtrx_cmd_finish(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_req_t *req, int status)
+{
+	req->status = status;
+	if (req->callback != NULL) {
+		req->callback(dev, req);
+	} else {
+		complete(&req->done);
+	}
+}
+
+/*!
+ * @brief try to register command request to the in-flight table
+ * @return false if the same command is in flight or there is no free slot
+ */
+static bool apt_usbtrx_cmd_try_register(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_req_t *req)
+{
+	unsigned long flags;
+	int free_slot = -1;
+	int idx;
+
+	spin_lock_irqsave(&dev->cmd_lock, flags);
+	for (idx = 0; idx < APT_USBTRX_CMD_INFLIGHT_MAX; idx++) {
+		if (dev->cmd_inflight[idx] == NULL) {
+			if (free_slot < 0) {
+				free_slot = idx;
+			}
+		} else if (dev->cmd_inflight[idx]->id == req->id) {
+			/* responses carry only the command id, same commands can not be told apart */
+			spin_unlock_irqrestore(&dev->cmd_lock, flags);
+			return false;
+		}
+	}
+	if (free_slot < 0) {
+		spin_unlock_irqrestore(&dev->cmd_lock, flags);
+		return false;
+	}
+	req->expires = jiffies + msecs_to_jiffies(req->timeout_msec);
+	dev->cmd_inflight[free_slot] = req;
+	spin_unlock_irqrestore(&dev->cmd_lock, flags);
+
+	if (req->callback != NULL && req->timeout_msec != 0) {
+		schedule_delayed_work(&dev->cmd_timeout_work, msecs_to_jiffies(APT_USBTRX_CMD_TIMEOUT_POLL_INTERVAL));
+	}
+
+	return true;
+}
+
+/*!
+ * @brief register command request to the in-flight table (may sleep)
+ */
+static int apt_usbtrx_cmd_register(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_req_t *req)
+{
+	long result;
+
+	result = wait_event_interruptible_timeout(dev->cmd_wq, apt_usbtrx_cmd_try_register(dev, req),
+						  msecs_to_jiffies(APT_USBTRX_SEND_TIMEOUT));
+	if (result <= 0) {
+		EMSG("wait_event_interruptible_timeout().. Error, <id:0x%02x> <errno:%ld>", req->id, result);
+		return RESULT_Failure;
+	}
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief unregister command request from the in-flight table
+ * @return false if the request has already been completed
+ */
+static bool apt_usbtrx_cmd_unregister(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_req_t *req)
+{
+	unsigned long flags;
+	bool found = false;
+	int idx;
+
+	spin_lock_irqsave(&dev->cmd_lock, flags);
+	for (idx = 0; idx < APT_USBTRX_CMD_INFLIGHT_MAX; idx++) {
+		if (dev->cmd_inflight[idx] == req) {
+			dev->cmd_inflight[idx] = NULL;
+			found = true;
+			break;
+		}
 	}
+	spin_unlock_irqrestore(&dev->cmd_lock, flags);
 
-	recv_size = urb->actual_length;
-	memcpy(&buf[dev->rx_transfer.data_size], urb->transfer_buffer, recv_size);
-	total_size = dev->rx_transfer.data_size + recv_size;
-
-	processed_size = 0;
-	remain_size = total_size;
+	if (found == true) {
+		wake_up(&dev->cmd_wq);
+	}
 
-	while (remain_size >= APT_USBTRX_CMD_MIN_LENGTH) {
-		apt_usbtrx_msg_t msg;
+	return found;
+}
 
-		result = apt_usbtrx_msg_parse(&buf[processed_size], remain_size, &msg);
-		if (result != RESULT_Success) {
-			if (result == RESULT_NotEnough) {
-				break;
-			}
-			processed_size++;
-			remain_size--;
-			continue;
-		}
+/*!
+ * @brief complete in-flight command request by the response
+ * NOTE: called from the dispatchers in urb completion context.
+ * @return false if no request is waiting for the response
+ */
+bool apt_usbtrx_complete_cmd(apt_usbtrx_dev_t *dev, u8 request_id, u8 *data, int data_size)
+{
+	apt_usbtrx_cmd_req_t *req = NULL;
+	unsigned long flags;
+	int idx;
 
-		result = apt_usbtrx_dispatch_msg(dev, &buf[processed_size], &msg);
-		if (result != RESULT_Success) {
+	spin_lock_irqsave(&dev->cmd_lock, flags);
+	for (idx = 0; idx < APT_USBTRX_CMD_INFLIGHT_MAX; idx++) {
+		if (dev->cmd_inflight[idx] != NULL && dev->cmd_inflight[idx]->id == request_id) {
+			req = dev->cmd_inflight[idx];
+			dev->cmd_inflight[idx] = NULL;
+			break;
 		}
+	}
+	spin_unlock_irqrestore(&dev->cmd_lock, flags);
 
-#if 0
-		DMSG("msg is coming!, <id:0x%02x> length=%d", msg.id, APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg.payload_size));
-#endif
-		processed_size += APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg.payload_size);
-		remain_size -= APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg.payload_size);
+	if (req == NULL) {
+		return false;
 	}
+	wake_up(&dev->cmd_wq);
 
-	if (remain_size > 0) {
-		if (processed_size > 0) {
-			memmove(buf, &buf[processed_size], remain_size);
+	DMSG("complete!, <id:0x%02x> length=%d", request_id, data_size);
+	req->resp_size = min_t(int, data_size, sizeof(req->resp));
+	memcpy(req->resp, data, req->resp_size);
+	apt_usbtrx_cmd_finish(dev, req, RESULT_Success);
+
+	return true;
+}
+
+/*!
+ * @brief expire in-flight command requests with a callback
+ */
+static void apt_usbtrx_cmd_timeout_work(struct work_struct *work)
+{
+	apt_usbtrx_dev_t *dev = container_of(to_delayed_work(work), apt_usbtrx_dev_t, cmd_timeout_work);
+	apt_usbtrx_cmd_req_t *expired[APT_USBTRX_CMD_INFLIGHT_MAX];
+	unsigned long flags;
+	bool pending = false;
+	int count = 0;
+	int idx;
+
+	spin_lock_irqsave(&dev->cmd_lock, flags);
+	for (idx = 0; idx < APT_USBTRX_CMD_INFLIGHT_MAX; idx++) {
+		apt_usbtrx_cmd_req_t *req = dev->cmd_inflight[idx];
+
+		if (req == NULL || req->callback == NULL || req->timeout_msec == 0) {
+			continue;
+		}
+		if (time_after_eq(jiffies, req->expires)) {
+			expired[count++] = req;
+			dev->cmd_inflight[idx] = NULL;
+		} else {
+			pending = true;
 		}
-		dev->rx_transfer.data_size = remain_size;
-	} else {
-		dev->rx_transfer.data_size = 0;
 	}
+	spin_unlock_irqrestore(&dev->cmd_lock, flags);
 
-	usb_fill_bulk_urb(urb, dev->udev, usb_rcvbulkpipe(dev->udev, dev->bulk_in->bEndpointAddress),
-			  urb->transfer_buffer, RX_BUFFER_SIZE, apt_usbtrx_read_bulk_callback, dev);
-	result = usb_submit_urb(urb, GFP_ATOMIC);
-	if (result != 0) {
-		EMSG("usb_submit_rub().. Error, <errno:%d>", result);
-		return;
+	if (count > 0) {
+		wake_up(&dev->cmd_wq);
+	}
+	for (idx = 0; idx < count; idx++) {
+		WMSG("command timeout, <id:0x%02x>", expired[idx]->id);
+		apt_usbtrx_cmd_finish(dev, expired[idx], RESULT_Timeout);
+	}
+
+	if (pending == true) {
+		schedule_delayed_work(&dev->cmd_timeout_work, msecs_to_jiffies(APT_USBTRX_CMD_TIMEOUT_POLL_INTERVAL));
 	}
 }
 
 /*!
- * @brief setup rx urbs
+ * @brief initialize command engine
  */
-int apt_usbtrx_setup_rx_urbs(apt_usbtrx_dev_t *dev)
+void apt_usbtrx_cmd_engine_init(apt_usbtrx_dev_t *dev)
 {
-	int result;
-	int idx;
+	memset(dev->cmd_inflight, 0, sizeof(dev->cmd_inflight));
+	spin_lock_init(&dev->cmd_lock);
+	init_waitqueue_head(&dev->cmd_wq);
+	INIT_DELAYED_WORK(&dev->cmd_timeout_work, apt_usbtrx_cmd_timeout_work);
+	dev->cmd_bufs_free = BIT(APT_USBTRX_CMD_BUFS) - 1;
+	sema_init(&dev->cmd_bufs_sem, APT_USBTRX_CMD_BUFS);
+}
 
-	CHKMSG("ENTER");
+/*!
+ * @brief get command buffer
+ * NOTE: Sleeps until a buffer is idle, never fails. The buffers are zero cleared.
+ */
+apt_usbtrx_cmd_buf_t *apt_usbtrx_cmd_buf_get(apt_usbtrx_dev_t *dev)
+{
+	int idx;
 
-	memset(dev->rx_transfer.buffer, 0, dev->rx_transfer.buffer_size);
-	dev->rx_transfer.data_size = 0;
+	/* the semaphore guarantees an idle buffer in the pool */
+	down(&dev->cmd_bufs_sem);
+	do {
+		idx = find_first_bit(&dev->cmd_bufs_free, APT_USBTRX_CMD_BUFS);
+	} while (test_and_clear_bit(idx, &dev->cmd_bufs_free) == 0);
 
-	for (idx = 0; idx < MAX_RX_URBS; idx++) {
-		struct urb *urb = NULL;
-		u8 *buf = NULL;
-		dma_addr_t buf_dma;
+	memset(&dev->cmd_bufs[idx], 0, sizeof(apt_usbtrx_cmd_buf_t));
+	return &dev->cmd_bufs[idx];
+}
 
-		urb = usb_alloc_urb(0, GFP_KERNEL);
-		if (urb == NULL) {
-			EMSG("usb_alloc_urb().. Error");
-			break;
-		}
+/*!
+ * @brief put command buffer
+ */
+void apt_usbtrx_cmd_buf_put(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_buf_t *buf)
+{
+	set_bit(buf - dev->cmd_bufs, &dev->cmd_bufs_free);
+	up(&dev->cmd_bufs_sem);
+}
 
-		buf = usb_alloc_coherent(dev->udev, RX_BUFFER_SIZE, GFP_KERNEL, &buf_dma);
-		if (buf == NULL) {
-			EMSG("usb_alloc_coherent().. Error");
-			usb_free_urb(urb);
-			break;
-		}
+/*!
+ * @brief abort all in-flight command requests
+ * NOTE: call after rx_ongoing is cleared.
+ */
+void apt_usbtrx_cmd_abort_all(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_cmd_req_t *aborted[APT_USBTRX_CMD_INFLIGHT_MAX];
+	unsigned long flags;
+	int count = 0;
+	int idx;
 
-		usb_fill_bulk_urb(urb, dev->udev, usb_rcvbulkpipe(dev->udev, dev->bulk_in->bEndpointAddress), buf,
-				  RX_BUFFER_SIZE, apt_usbtrx_read_bulk_callback, dev);
-		urb->transfer_dma = buf_dma;
-		urb->transfer_flags |= URB_NO_TRANSFER_DMA_MAP;
-		usb_anchor_urb(urb, &dev->rx_submitted);
+	cancel_delayed_work_sync(&dev->cmd_timeout_work);
 
-		result = usb_submit_urb(urb, GFP_KERNEL);
-		if (result != 0) {
-			EMSG("usb_submit_urb().. Error, <errno:%d>", result);
-			usb_unanchor_urb(urb);
-			usb_free_coherent(dev->udev, RX_BUFFER_SIZE, buf, buf_dma);
-			usb_free_urb(urb);
-			break;
+	spin_lock_irqsave(&dev->cmd_lock, flags);
+	for (idx = 0; idx < APT_USBTRX_CMD_INFLIGHT_MAX; idx++) {
+		if (dev->cmd_inflight[idx] != NULL) {
+			aborted[count++] = dev->cmd_inflight[idx];
+			dev->cmd_inflight[idx] = NULL;
 		}
+	}
+	spin_unlock_irqrestore(&dev->cmd_lock, flags);
 
-		dev->rxbuf[idx] = buf;
-		dev->rxbuf_dma[idx] = buf_dma;
-		usb_free_urb(urb);
+	wake_up(&dev->cmd_wq);
+	for (idx = 0; idx < count; idx++) {
+		apt_usbtrx_cmd_finish(dev, aborted[idx], RESULT_Failure);
 	}
+}
 
-	if (idx < MAX_RX_URBS) {
-		EMSG("%s: setup error, <idx:%d>", __func__, idx);
+/*!
+ * @brief submit command request
+ * NOTE: Does not wait for the response, other commands can be submitted while this one is in flight.
+ *       Only available while rx urbs are running (the response is received by the rx callback).
+ */
+int apt_usbtrx_cmd_submit(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_req_t *req)
+{
+	int result;
+
+	if (atomic_read(&dev->rx_ongoing) != true) {
+		EMSG("rx is not ongoing, <id:0x%02x>", req->id);
 		return RESULT_Failure;
 	}
 
-	atomic_set(&dev->rx_ongoing, true);
+	/* register before sending, the response may arrive before usb_bulk_msg() returns */
+	result = apt_usbtrx_cmd_register(dev, req);
+	if (result != RESULT_Success) {
+		return result;
+	}
+
+	result = apt_usbtrx_send_msg_internal(dev, req->data, req->data_size);
+	if (result != RESULT_Success) {
+		apt_usbtrx_cmd_unregister(dev, req);
+		return result;
+	}
 
-	CHKMSG("LEAVE");
 	return RESULT_Success;
 }
 
 /*!
- * @brief tx bulk callback
+ * @brief wait for command request submitted without a callback
  */
-static void apt_usbtrx_write_bulk_callback(struct urb *urb)
+int apt_usbtrx_cmd_wait(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_req_t *req)
 {
-	apt_usbtrx_dev_t *dev = urb->context;
-	int status = urb->status;
-
-	switch (status) {
-	case 0:
-		break;
-	case -ENOENT:
-	case -ECONNRESET:
-	case -ESHUTDOWN:
-		break;
-	default:
-		EMSG("write bulk error, <status:%d>", status);
-		break;
+	unsigned long result;
+
+	result = wait_for_completion_timeout(&req->done, msecs_to_jiffies(req->timeout_msec));
+	if (result == 0) {
+		if (apt_usbtrx_cmd_unregister(dev, req) == true) {
+			WMSG("command timeout, <id:0x%02x>", req->id);
+			req->status = RESULT_Timeout;
+			return RESULT_Timeout;
+		}
+		/* completed while timing out */
+		wait_for_completion(&req->done);
 	}
 
-	usb_free_coherent(urb->dev, urb->transfer_buffer_length, urb->transfer_buffer, urb->transfer_dma);
-	up(&dev->tx_usb_transfer_sem);
-
-	dev->unique_func.write_bulk_callback(urb);
+	return req->status;
 }
 
 /*!
- * @brief setup tx urb
+ * @brief execute command requests pipelined
+ * NOTE: Requests which fit into the in-flight table and a command buffer are sent in a single bulk transfer
+ *       and their responses are awaited together. The requests must not have a callback.
+ * @return RESULT_Success if all requests are responded (check ACK/NACK of each req->resp)
  */
-int apt_usbtrx_setup_tx_urb(apt_usbtrx_dev_t *dev, u8 *data, int data_size)
+int apt_usbtrx_cmd_exec(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_req_t **reqs, int count)
 {
-	struct urb *urb = NULL;
-	u8 *buf = NULL;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
+	u8 *buffer;
+	int sent = 0;
+	int ret = RESULT_Success;
 	int result;
+	int idx;
 
-	urb = usb_alloc_urb(0, GFP_KERNEL);
-	if (urb == NULL) {
-		EMSG("usb_alloc_urb().. Error");
+	if (atomic_read(&dev->rx_ongoing) != true) {
+		EMSG("rx is not ongoing");
 		return RESULT_Failure;
 	}
 
-	buf = usb_alloc_coherent(dev->udev, data_size, GFP_KERNEL, &urb->transfer_dma);
-	if (buf == NULL) {
-		EMSG("usb_alloc_coherent().. Error, <size:%d>", data_size);
-		usb_free_urb(urb);
-		return RESULT_Failure;
+	for (idx = 0; idx < count; idx++) {
+		if (reqs[idx]->data_size > APT_USBTRX_CMD_MAX_LENGTH) {
+			EMSG("invalid data size, <id:0x%02x> <size:%d>", reqs[idx]->id, reqs[idx]->data_size);
+			return RESULT_Failure;
+		}
 	}
 
-	memcpy(buf, data, data_size);
-	usb_fill_bulk_urb(urb, dev->udev, usb_sndbulkpipe(dev->udev, dev->bulk_out->bEndpointAddress), buf, data_size,
-			  apt_usbtrx_write_bulk_callback, dev);
-	urb->transfer_flags |= URB_NO_TRANSFER_DMA_MAP;
-	usb_anchor_urb(urb, &dev->tx_submitted);
+	/* the request messages are copied, the transfer buffer is only needed while sending */
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	buffer = cmd_buf->req;
 
-	result = usb_submit_urb(urb, GFP_KERNEL);
-	if (result != 0) {
-		EMSG("usb_submit_urb().. Error, <errno:%d>", result);
-		usb_unanchor_urb(urb);
-		usb_free_coherent(dev->udev, data_size, buf, urb->transfer_dma);
-		usb_free_urb(urb);
-		return RESULT_Failure;
+	while (sent < count) {
+		int size = 0;
+		int n = 0;
+
+		/* wait for a slot for the first one, pack the following ones as long as slots are free */
+		result = apt_usbtrx_cmd_register(dev, reqs[sent]);
+		if (result != RESULT_Success) {
+			ret = result;
+			break;
+		}
+		do {
+			memcpy(&buffer[size], reqs[sent + n]->data, reqs[sent + n]->data_size);
+			size += reqs[sent + n]->data_size;
+			n++;
+		} while (sent + n < count && size + reqs[sent + n]->data_size <= APT_USBTRX_CMD_MAX_LENGTH &&
+			 apt_usbtrx_cmd_try_register(dev, reqs[sent + n]) == true);
+
+		result = apt_usbtrx_send_msg_internal(dev, buffer, size);
+		if (result != RESULT_Success) {
+			for (idx = sent; idx < sent + n; idx++) {
+				apt_usbtrx_cmd_unregister(dev, reqs[idx]);
+			}
+			ret = result;
+			break;
+		}
+		sent += n;
 	}
 
-	usb_free_urb(urb);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
-	return RESULT_Success;
+	for (idx = 0; idx < sent; idx++) {
+		result = apt_usbtrx_cmd_wait(dev, reqs[idx]);
+		if (result != RESULT_Success) {
+			ret = result;
+		}
+	}
+	for (idx = sent; idx < count; idx++) {
+		reqs[idx]->status = RESULT_Failure;
+	}
+
+	return ret;
 }
 
 /*!
- * @brief send message internal
+ * @brief completion callback of apt_usbtrx_send_msg_sync() requests
  */
-static int apt_usbtrx_send_msg_internal(apt_usbtrx_dev_t *dev, u8 *data, int data_size)
+static void apt_usbtrx_cmd_legacy_callback(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_req_t *req)
 {
-	int send_size;
-	int result;
-
-	DMSG("%s(): data size=%d, data=%02x, %02x, %02x, ...", __func__, data_size, data[0], data[1], data[2]);
-
-	result = usb_bulk_msg(dev->udev, usb_sndbulkpipe(dev->udev, dev->bulk_out->bEndpointAddress), data, data_size,
-			      &send_size, APT_USBTRX_SEND_TIMEOUT);
-	if (result != 0) {
-		EMSG("usb_bulk_msg().. Error, <errno:%d> data size=%d>", result, data_size);
-		return RESULT_Failure;
+	if (req->status == RESULT_Success) {
+		dev->rx_complete.data_size = min(req->resp_size, dev->rx_complete.buffer_size);
+		memcpy(dev->rx_complete.buffer, req->resp, dev->rx_complete.data_size);
 	}
-
-	return RESULT_Success;
+	complete(&dev->rx_complete.complete);
 }
 
 /*!
@@ -428,10 +1822,15 @@ int apt_usbtrx_send_msg_sync(apt_usbtrx_dev_t *dev, u8 *data, int data_size)
 		return RESULT_Failure;
 	}
 
-	dev->rx_complete.id = data[2];
 	init_completion(&dev->rx_complete.complete);
 
-	result = apt_usbtrx_send_msg_internal(dev, data, data_size);
+	if (atomic_read(&dev->rx_ongoing) == true) {
+		/* the request is kept in flight until apt_usbtrx_wait_msg() */
+		apt_usbtrx_cmd_req_init(&dev->cmd_legacy, data, data_size, 0, apt_usbtrx_cmd_legacy_callback, NULL);
+		result = apt_usbtrx_cmd_submit(dev, &dev->cmd_legacy);
+	} else {
+		result = apt_usbtrx_send_msg_internal(dev, data, data_size);
+	}
 	if (result != RESULT_Success) {
 		up(&dev->send_msg_sem);
 		return result;
@@ -459,6 +1858,15 @@ int apt_usbtrx_send_msg_async(apt_usbtrx_dev_t *dev, u8 *data, int data_size)
 	return RESULT_Success;
 }
 
+/*!
+ * @brief release resources of apt_usbtrx_send_msg_sync()
+ */
+static void apt_usbtrx_wait_msg_leave(apt_usbtrx_dev_t *dev)
+{
+	apt_usbtrx_cmd_unregister(dev, &dev->cmd_legacy);
+	up(&dev->send_msg_sem);
+}
+
 /*!
  * @brief wait for message with timeout
  * NOTE: If you use this function, you must call apt_usbtrx_send_msg_sync() to send the request.
@@ -475,13 +1883,8 @@ int apt_usbtrx_wait_msg_timeout(apt_usbtrx_dev_t *dev, u8 ack_id, u8 nack_id, u8
 	CHKMSG("ENTER");
 	DMSG("%s(): ack=0x%02x, nack=0x%02x, data size=%d", __func__, ack_id, nack_id, data_size);
 
-	buf = kzalloc(RX_BUFFER_SIZE, GFP_KERNEL);
-	if (buf == NULL) {
-		EMSG("kzalloc().. Error, <size:%d>", RX_BUFFER_SIZE);
-		up(&dev->send_msg_sem);
-		CHKMSG("LEAVE");
-		return RESULT_Failure;
-	}
+	/* send_msg_sem is held until apt_usbtrx_wait_msg_leave(), rx_complete.buffer is ours */
+	buf = dev->rx_complete.buffer;
 
 	do {
 		bool rx_ongoing;
@@ -493,13 +1896,18 @@ int apt_usbtrx_wait_msg_timeout(apt_usbtrx_dev_t *dev, u8 ack_id, u8 nack_id, u8
 				wait_for_completion_timeout(&dev->rx_complete.complete, msecs_to_jiffies(timeout_msec));
 			if (result == 0) {
 				WMSG("wait_for_completion_timeout().. Error, <errno:%d>", result);
-				kfree(buf);
-				up(&dev->send_msg_sem);
+				apt_usbtrx_wait_msg_leave(dev);
 				CHKMSG("LEAVE");
 				return RESULT_Timeout;
 			}
-			recv_size = dev->rx_complete.buffer_size;
-			memcpy(buf, dev->rx_complete.buffer, recv_size);
+			if (dev->cmd_legacy.status != RESULT_Success) {
+				EMSG("command aborted, <id:0x%02x>", dev->cmd_legacy.id);
+				apt_usbtrx_wait_msg_leave(dev);
+				CHKMSG("LEAVE");
+				return RESULT_Failure;
+			}
+			/* only the response copied by apt_usbtrx_cmd_legacy_callback() is valid */
+			recv_size = dev->rx_complete.data_size;
 			DMSG("wait_for_completion_timeout().. Success");
 		} else {
 			DMSG("usb_bulk_msg()..");
@@ -507,8 +1915,7 @@ int apt_usbtrx_wait_msg_timeout(apt_usbtrx_dev_t *dev, u8 ack_id, u8 nack_id, u8
 					      buf, data_size, &recv_size, timeout_msec);
 			if (result != 0) {
 				EMSG("usb_bulk_msg().. Error, <errno:%d> data size=%d>", result, data_size);
-				kfree(buf);
-				up(&dev->send_msg_sem);
+				apt_usbtrx_wait_msg_leave(dev);
 				CHKMSG("LEAVE");
 				return RESULT_Failure;
 			}
@@ -521,16 +1928,19 @@ int apt_usbtrx_wait_msg_timeout(apt_usbtrx_dev_t *dev, u8 ack_id, u8 nack_id, u8
 
 			result = apt_usbtrx_msg_parse(&buf[pos], recv_size - pos, &msg);
 			if (result != RESULT_Success) {
-				DMSG("apt_usbtrx_msg_parse().. Error, <pos:%d>", pos);
-				pos = pos + 1;
+				int skip_size = apt_usbtrx_msg_resync(&buf[pos], recv_size - pos);
+
+				DMSG("apt_usbtrx_msg_parse().. Error, <pos:%d> skip=%d", pos, skip_size);
+				atomic64_inc(&dev->rx_resync_count);
+				atomic64_add(skip_size, &dev->rx_resync_bytes);
+				pos = pos + skip_size;
 				continue;
 			}
 
 			if (msg.id == ack_id) {
 				DMSG("%s(): coming ack, <id:0x%02x> data size=%d", __func__, msg.id, msg.payload_size);
 				memcpy(data, buf, APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg.payload_size));
-				kfree(buf);
-				up(&dev->send_msg_sem);
+				apt_usbtrx_wait_msg_leave(dev);
 				CHKMSG("LEAVE");
 				return RESULT_Success;
 			}
@@ -538,8 +1948,7 @@ int apt_usbtrx_wait_msg_timeout(apt_usbtrx_dev_t *dev, u8 ack_id, u8 nack_id, u8
 			if (msg.id == nack_id) {
 				DMSG("%s(): coming nack, <id:0x%02x> data size=%d", __func__, msg.id, msg.payload_size);
 				memcpy(data, buf, APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg.payload_size));
-				kfree(buf);
-				up(&dev->send_msg_sem);
+				apt_usbtrx_wait_msg_leave(dev);
 				CHKMSG("LEAVE");
 				return RESULT_Success;
 			}
@@ -551,8 +1960,7 @@ int apt_usbtrx_wait_msg_timeout(apt_usbtrx_dev_t *dev, u8 ack_id, u8 nack_id, u8
 	} while (time_before(jiffies, timeout));
 
 	EMSG("%s(): msg is not coming, <id:0x%02x, 0x%02x>", __func__, ack_id, nack_id);
-	kfree(buf);
-	up(&dev->send_msg_sem);
+	apt_usbtrx_wait_msg_leave(dev);
 
 	CHKMSG("LEAVE");
 	return RESULT_Failure;
@@ -589,6 +1997,91 @@ static bool apt_usbtrx_is_write_enable(apt_usbtrx_dev_t *dev)
 	return false;
 }
 
+/*!
+ * @brief pull one message from tx ringbuffer
+ *
+ * @return message length, 0 if tx ringbuffer is empty or the next message
+ *         does not fit into space, RESULT_Failure on error
+ * NOTE: dropped is incremented for a message discarded from tx ringbuffer.
+ */
+static int apt_usbtrx_tx_pull_msg(apt_usbtrx_dev_t *dev, u8 *buffer, size_t space, int *dropped)
+{
+	u8 msg_length;
+	ssize_t rsize;
+	int result;
+
+	if (space < APT_USBTRX_CMD_MIN_LENGTH) {
+		return 0;
+	}
+
+	/* get minimum length to get message length */
+	rsize = apt_usbtrx_ringbuffer_peek(&dev->tx_data, buffer, APT_USBTRX_CMD_MIN_LENGTH);
+	if (rsize == 0) {
+		return 0;
+	} else if (rsize < 0 || rsize != APT_USBTRX_CMD_MIN_LENGTH) {
+		EMSG("apt_usbtrx_ringbuffer_peek().. Error, <size:%zd>", rsize);
+		return RESULT_Failure;
+	}
+
+	result = apt_usbtrx_msg_get_length(buffer, APT_USBTRX_CMD_MIN_LENGTH, &msg_length);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_msg_get_length().. Error");
+		return RESULT_Failure;
+	}
+	if (msg_length < APT_USBTRX_CMD_MIN_LENGTH || msg_length > APT_USBTRX_CMD_MAX_LENGTH) {
+		EMSG("invalid msg_length = %d", msg_length);
+		/* drop the broken header */
+		apt_usbtrx_ringbuffer_rawread(&dev->tx_data, buffer, APT_USBTRX_CMD_MIN_LENGTH);
+		(*dropped)++;
+		return RESULT_Failure;
+	}
+
+	if (msg_length > space) {
+		/* keep it for the next transfer */
+		return 0;
+	}
+
+	/* get full message, a message is always published as a whole */
+	rsize = apt_usbtrx_ringbuffer_rawread(&dev->tx_data, buffer, msg_length);
+	if (rsize != msg_length) {
+		EMSG("apt_usbtrx_ringbuffer_rawread().. Error, <size:%zd>", rsize);
+		return RESULT_Failure;
+	}
+
+	return msg_length;
+}
+
+/*!
+ * @brief drop tx messages pulled from tx ringbuffer but not sent
+ * NOTE: urbs already submitted are waited for, echo skbs are finished in order.
+ */
+static void apt_usbtrx_drop_tx_msgs(apt_usbtrx_dev_t *dev, int msg_count)
+{
+	if (msg_count <= 0) {
+		return;
+	}
+
+	if (usb_wait_anchor_empty_timeout(&dev->tx_submitted, APT_USBTRX_SEND_TIMEOUT) == 0) {
+		WMSG("usb_wait_anchor_empty_timeout().. Timeout");
+	}
+
+	apt_usbtrx_finish_tx_msgs(dev, msg_count, READ_ONCE(dev->tx_echo.gen), -ECANCELED);
+}
+
+/*!
+ * @brief flush all tx messages after tx ringbuffer is cleared
+ */
+static void apt_usbtrx_flush_tx_msgs(apt_usbtrx_dev_t *dev)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->tx_echo.lock, flags);
+	dev->unique_func.write_bulk_callback(dev, INT_MAX, -ECANCELED);
+	/* urbs still in flight own no echo slot any more */
+	dev->tx_echo.gen++;
+	spin_unlock_irqrestore(&dev->tx_echo.lock, flags);
+}
+
 /*!
  * @brief tx thread func
  */
@@ -597,22 +2090,33 @@ int apt_usbtrx_tx_thread_func(void *arg)
 	apt_usbtrx_dev_t *dev = (apt_usbtrx_dev_t *)arg;
 
 	while (!kthread_should_stop()) {
-		u8 msg_length;
-		u8 buffer[APT_USBTRX_CMD_MAX_LENGTH];
-		int remain;
-		u8 *p_buffer;
-		ssize_t rsize;
+		u8 *buffer = dev->tx_aggregate_buffer;
+		size_t buffer_size;
+		size_t tx_size;
+		int msg_count;
+		int dropped;
+		bool aggregate;
 		int result;
 		int tx_buffer_rate;
 
+		/* echo skb tracking is being reset or tx_data is being resized */
+		if (kthread_should_park()) {
+			kthread_parkme();
+			continue;
+		}
+
 		if (atomic_read(&dev->tx_data_clear_requested)) {
 			apt_usbtrx_ringbuffer_clear(&dev->tx_data);
+			apt_usbtrx_flush_tx_msgs(dev);
 			atomic_set(&dev->tx_data_clear_requested, false);
+			/* notify writers waiting in poll() for free space */
+			wake_up_interruptible(&dev->tx_data.wq);
 			continue;
 		}
 
-		result = wait_event_interruptible_timeout(dev->tx_data.wq, (apt_usbtrx_is_write_enable(dev) == true),
-							  msecs_to_jiffies(1000));
+		result = wait_event_interruptible_timeout(
+			dev->tx_data.wq, (apt_usbtrx_is_write_enable(dev) == true) || kthread_should_park(),
+			msecs_to_jiffies(1000));
 		if (result < 0) {
 			if (result != -ERESTARTSYS) {
 				EMSG("wait_event_interruptible().. Error, <errno:%d>", result);
@@ -620,7 +2124,7 @@ int apt_usbtrx_tx_thread_func(void *arg)
 			continue;
 		}
 
-		if (result == 0) {
+		if (result == 0 || kthread_should_park()) {
 			continue;
 		}
 
@@ -648,54 +2152,48 @@ int apt_usbtrx_tx_thread_func(void *arg)
 			continue;
 		}
 
-		/* get minimum length to get message length */
-		rsize = apt_usbtrx_ringbuffer_rawread(&dev->tx_data, buffer, APT_USBTRX_CMD_MIN_LENGTH);
-		if (rsize == 0) {
-			up(&dev->tx_usb_transfer_sem);
-			continue;
-		} else if (rsize < 0 || rsize != APT_USBTRX_CMD_MIN_LENGTH) {
-			EMSG("apt_usbtrx_ringbuffer_rawread().. Error, <size:%zd>", rsize);
-			up(&dev->tx_usb_transfer_sem);
-			continue;
-		}
-
-		result = apt_usbtrx_msg_get_length(buffer, APT_USBTRX_CMD_MIN_LENGTH, &msg_length);
-		if (result != RESULT_Success) {
-			EMSG("apt_usbtrx_msg_get_length().. Error");
-			up(&dev->tx_usb_transfer_sem);
-			continue;
-		}
-		if (msg_length < APT_USBTRX_CMD_MIN_LENGTH || msg_length > APT_USBTRX_CMD_MAX_LENGTH) {
-			EMSG("invalid msg_length = %d", msg_length);
-			up(&dev->tx_usb_transfer_sem);
-			continue;
-		}
+		/*
+		 * In aggregation mode, pack as many whole messages as the tokens and
+		 * the transfer buffer (a multiple of wMaxPacketSize) allow.
+		 */
+		aggregate = atomic_read(&dev->tx_aggregate);
+		buffer_size = aggregate ? dev->tx_aggregate_buffer_size : APT_USBTRX_CMD_MAX_LENGTH;
+		tx_size = 0;
+		msg_count = 0;
+		dropped = 0;
+		while (dev->tx_transfer_token > 0) {
+			result = apt_usbtrx_tx_pull_msg(dev, buffer + tx_size, buffer_size - tx_size, &dropped);
+			if (result <= 0) {
+				break;
+			}
+			tx_size += result;
+			msg_count++;
+			dev->tx_transfer_token--;
 
-		/* get full message (APT_USBTRX_CMD_MIN_LENGTH has already been read)*/
-		p_buffer = &buffer[0] + APT_USBTRX_CMD_MIN_LENGTH;
-		remain = msg_length - APT_USBTRX_CMD_MIN_LENGTH;
-		while (remain > 0) {
-			rsize = apt_usbtrx_ringbuffer_rawread(&dev->tx_data, p_buffer, remain);
-			if (rsize < 0) {
-				EMSG("apt_usbtrx_ringbuffer_rawread().. Error, <size:%zd>", rsize);
+			if (aggregate != true) {
 				break;
 			}
-			p_buffer += rsize;
-			remain -= rsize;
 		}
-		if (remain != 0) {
-			EMSG("remain is not zero.. Error, <remain:%d>", remain);
+
+		if (tx_size == 0) {
 			up(&dev->tx_usb_transfer_sem);
+			apt_usbtrx_drop_tx_msgs(dev, dropped);
 			continue;
 		}
 
-		result = apt_usbtrx_setup_tx_urb(dev, buffer, msg_length);
+		/* notify writers waiting in poll() for free space */
+		wake_up_interruptible(&dev->tx_data.wq);
+
+		result = apt_usbtrx_setup_tx_urb(dev, buffer, tx_size, msg_count);
 		if (result != RESULT_Success) {
 			EMSG("apt_usbtrx_setup_tx_urb().. Error");
 			up(&dev->tx_usb_transfer_sem);
+			apt_usbtrx_drop_tx_msgs(dev, msg_count + dropped);
 			continue;
 		}
-		dev->tx_transfer_token--;
+
+		/* the broken message was queued after the messages just submitted */
+		apt_usbtrx_drop_tx_msgs(dev, dropped);
 	}
 
 	return 0;
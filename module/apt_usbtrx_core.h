@@ -9,15 +9,246 @@
 
 #include "apt_usbtrx_def.h"
 
+/*!
+ * @brief message dispatch table entries
+ */
+#define APT_USBTRX_MSG_HANDLER(msg_id, func) [msg_id] = { .handler = (func) }
+#define APT_USBTRX_MSG_RESPONSE(msg_id, req_id) \
+	[msg_id] = { .handler = apt_usbtrx_dispatch_response, .request_id = (req_id) }
+
+/*!
+ * @brief message dispatch table entries common to all devices
+ */
+#define APT_USBTRX_MSG_COMMON_ENTRIES                                                                    \
+	APT_USBTRX_MSG_HANDLER(APT_USBTRX_CMD_NotifyBufferStatus, apt_usbtrx_dispatch_notify_buffer_status), \
+	APT_USBTRX_MSG_HANDLER(APT_USBTRX_CMD_ACK, apt_usbtrx_dispatch_ack),                                 \
+	APT_USBTRX_MSG_HANDLER(APT_USBTRX_CMD_NACK, apt_usbtrx_dispatch_ack),                                \
+	APT_USBTRX_MSG_RESPONSE(APT_USBTRX_CMD_ResponseGetDeviceId, APT_USBTRX_CMD_GetDeviceId),             \
+	APT_USBTRX_MSG_RESPONSE(APT_USBTRX_CMD_ResponseGetSerialNo, APT_USBTRX_CMD_GetSerialNo),             \
+	APT_USBTRX_MSG_RESPONSE(APT_USBTRX_CMD_ResponseGetFWVersion, APT_USBTRX_CMD_GetFWVersion),           \
+	APT_USBTRX_MSG_RESPONSE(APT_USBTRX_CMD_ResponseGetFWVersionRevision, APT_USBTRX_CMD_GetFWVersionRevision)
+
 /*!
  * @brief setup rx urbs
  */
 int apt_usbtrx_setup_rx_urbs(apt_usbtrx_dev_t *dev);
 
+/*!
+ * @brief allocate tx urb pool
+ */
+int apt_usbtrx_alloc_tx_urbs(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief free tx urb pool
+ */
+void apt_usbtrx_free_tx_urbs(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief add clock sample of a received frame
+ */
+void apt_usbtrx_add_clock_sample(apt_usbtrx_dev_t *dev, const apt_usbtrx_timestamp_t *timestamp);
+
+/*!
+ * @brief write received payload to rx_data
+ */
+int apt_usbtrx_write_rx_data(apt_usbtrx_dev_t *dev, apt_usbtrx_timestamp_t *timestamp, u8 *payload, int payload_size);
+
+/*!
+ * @brief get size of a record in rx_data
+ */
+int apt_usbtrx_get_rx_record_size(void *context, const void *record);
+
+/*!
+ * @brief initialize rx reader wakeup
+ */
+void apt_usbtrx_rx_wakeup_init(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief reset rx reader wakeup watermarks to the defaults (wake for every frame)
+ */
+void apt_usbtrx_rx_wakeup_set_default(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief notify the reader of frames written to rx_data
+ */
+void apt_usbtrx_notify_rx_data(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief check if rx_data is ready to be read
+ */
+bool apt_usbtrx_rx_data_is_ready(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief initialize rx capture
+ */
+void apt_usbtrx_rx_capture_init(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief set rx capture
+ */
+int apt_usbtrx_rx_capture_set(apt_usbtrx_dev_t *dev, const apt_usbtrx_ioctl_rx_capture_t *param);
+
+/*!
+ * @brief reset rx capture to the default (stream mode)
+ */
+void apt_usbtrx_rx_capture_set_default(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief lock rx_data for a reader (read(), GET_RX_QUEUED)
+ */
+int apt_usbtrx_rx_capture_read_lock(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief unlock rx_data for a reader
+ */
+void apt_usbtrx_rx_capture_read_unlock(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief get rx mmap permission
+ */
+int apt_usbtrx_rx_capture_map_get(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief get rx capture
+ */
+void apt_usbtrx_rx_capture_get(apt_usbtrx_dev_t *dev, apt_usbtrx_ioctl_rx_capture_t *param);
+
+/*!
+ * @brief trigger rx capture
+ */
+int apt_usbtrx_rx_capture_trigger(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief trigger rx capture if the can id matches
+ */
+void apt_usbtrx_rx_capture_match_can_id(apt_usbtrx_dev_t *dev, u32 can_id);
+
+/*!
+ * @brief get rx settings (call at open of the device file)
+ */
+void apt_usbtrx_rx_settings_get(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief put rx settings (call at release of the device file)
+ */
+void apt_usbtrx_rx_settings_put(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief hold rx_data/tx_data
+ */
+void apt_usbtrx_data_buffer_get(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief release rx_data/tx_data
+ */
+void apt_usbtrx_data_buffer_put(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief resize rx_data
+ */
+int apt_usbtrx_resize_rx_data(apt_usbtrx_dev_t *dev, size_t size);
+
+/*!
+ * @brief resize tx_data
+ */
+int apt_usbtrx_resize_tx_data(apt_usbtrx_dev_t *dev, size_t size);
+
 /*!
  * @brief setup tx urb
  */
-int apt_usbtrx_setup_tx_urb(apt_usbtrx_dev_t *dev, u8 *data, int data_size);
+int apt_usbtrx_setup_tx_urb(apt_usbtrx_dev_t *dev, u8 *data, int data_size, int msg_count);
+
+/*!
+ * @brief reset echo skb tracking (call at netdev open)
+ */
+void apt_usbtrx_reset_echo_skb(apt_usbtrx_dev_t *dev);
+
+#ifdef SUPPORT_NETDEV
+struct net_device;
+struct sk_buff;
+
+/*!
+ * @brief put echo skb to the next slot
+ */
+int apt_usbtrx_put_echo_skb(apt_usbtrx_dev_t *dev, struct net_device *netdev, struct sk_buff *skb, u8 len);
+
+/*!
+ * @brief cancel the last put echo skb
+ */
+void apt_usbtrx_cancel_echo_skb(apt_usbtrx_dev_t *dev, struct net_device *netdev);
+
+/*!
+ * @brief complete echo skbs in order
+ */
+unsigned int apt_usbtrx_complete_echo_skb(apt_usbtrx_dev_t *dev, struct net_device *netdev, int msg_count,
+					  u64 *bytes);
+
+/*!
+ * @brief free echo skbs in order, without looping them back
+ */
+unsigned int apt_usbtrx_free_echo_skb(apt_usbtrx_dev_t *dev, struct net_device *netdev, int msg_count);
+#endif
+
+/*!
+ * @brief initialize command engine
+ */
+void apt_usbtrx_cmd_engine_init(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief abort all in-flight command requests
+ */
+void apt_usbtrx_cmd_abort_all(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief get command buffer
+ */
+apt_usbtrx_cmd_buf_t *apt_usbtrx_cmd_buf_get(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief put command buffer
+ */
+void apt_usbtrx_cmd_buf_put(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_buf_t *buf);
+
+/*!
+ * @brief initialize command request
+ */
+void apt_usbtrx_cmd_req_init(apt_usbtrx_cmd_req_t *req, u8 *data, int data_size, unsigned int timeout_msec,
+			     apt_usbtrx_cmd_callback_t callback, void *context);
+
+/*!
+ * @brief submit command request
+ */
+int apt_usbtrx_cmd_submit(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_req_t *req);
+
+/*!
+ * @brief wait for command request submitted without a callback
+ */
+int apt_usbtrx_cmd_wait(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_req_t *req);
+
+/*!
+ * @brief execute command requests pipelined
+ */
+int apt_usbtrx_cmd_exec(apt_usbtrx_dev_t *dev, apt_usbtrx_cmd_req_t **reqs, int count);
+
+/*!
+ * @brief complete in-flight command request by the response
+ */
+bool apt_usbtrx_complete_cmd(apt_usbtrx_dev_t *dev, u8 request_id, u8 *data, int data_size);
+
+/*!
+ * @brief dispatch NotifyBufferStatus (message handler)
+ */
+int apt_usbtrx_dispatch_notify_buffer_status(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg);
+
+/*!
+ * @brief dispatch ACK/NACK (message handler)
+ */
+int apt_usbtrx_dispatch_ack(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg);
+
+/*!
+ * @brief dispatch response to the in-flight request (message handler)
+ */
+int apt_usbtrx_dispatch_response(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg);
 
 /*!
  * @brief send message sync
@@ -46,7 +277,8 @@ int apt_usbtrx_wait_msg(apt_usbtrx_dev_t *dev, u8 ack_id, u8 nack_id, u8 *data,
 int apt_usbtrx_tx_thread_func(void *arg);
 
 #ifdef UNIT_TEST
-int apt_usbtrx_dispatch_msg(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_t *msg);
+int apt_usbtrx_dispatch_msg(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg);
+int apt_usbtrx_parse_rx_data(apt_usbtrx_dev_t *dev, u8 *data, int data_size, int limit);
 #endif
 
 #endif /* __APT_USBTRX_CORE_H__ */
@@ -12,8 +12,13 @@
 #include <linux/kref.h>
 #include <linux/version.h>
 #include <linux/time.h>
+#include <linux/workqueue.h>
+#include <linux/hrtimer.h>
+#include <linux/mutex.h>
+#include <linux/ptp_clock_kernel.h>
 
 #include "apt_usbtrx_ringbuffer.h"
+#include "apt_usbtrx_clock.h"
 #include "apt_usbtrx_ioctl.h"
 #include "apt_usbtrx_msg.h"
 
@@ -56,13 +61,23 @@ enum RESULT { RESULT_Failure = -1, RESULT_Success = 0, RESULT_NotEnough = 1, RES
 #define RX_BUFFER_SIZE (1024)
 #define APT_USBTRX_RECV_TIMEOUT (1000)
 #define APT_USBTRX_SEND_TIMEOUT (1000)
+#define APT_USBTRX_CMD_INFLIGHT_MAX (8)
+#define APT_USBTRX_CMD_TIMEOUT_POLL_INTERVAL (100) /* msec */
+#define APT_USBTRX_CMD_BUFS (4)
 #define APT_USBTRX_TXDATA_BUFFER_SIZE (256 * 1024)
+#define APT_USBTRX_DATA_BUFFER_MIN_SIZE (4 * 1024) /* rx_data/tx_data resizable range */
+#define APT_USBTRX_DATA_BUFFER_MAX_SIZE (16 * 1024 * 1024)
 #define APT_USBTRX_TX_TOKEN_EXPIRED_TIME (1)
 #define APT_USBTRX_TX_TOKEN_CAN_SIZE (16)
 #define APT_USBTRX_DEVICE_ID_LENGTH (4)
 #define APT_USBTRX_SERIAL_NO_LENGTH (14)
 #define APT_USBTRX_MODEL_NAME_LENGTH (32)
 #define APT_USBTRX_TX_TRANSFER_LIMIT_RATE (80)
+#define APT_USBTRX_TX_AGGREGATE_PACKETS (4)
+#define APT_USBTRX_ECHO_SKB_MAX (16)
+#define APT_USBTRX_RX_RECORD_MAX_SIZE                                          \
+	max_t(size_t, APT_USBTRX_MSG_LENGTH_TO_PAYLOAD(APT_USBTRX_CMD_MAX_LENGTH), \
+	      sizeof(apt_usbtrx_rx_overflow_marker_t)) /* received payload or overflow marker in rx_data */
 
 /*!
  * @brief vendor id
@@ -84,6 +99,19 @@ enum RESULT { RESULT_Failure = -1, RESULT_Success = 0, RESULT_NotEnough = 1, RES
 #define get_raw_monotonic_ts64(ts) getrawmonotonic64(ts)
 #endif
 
+/*!
+ * @brief  __poll_t aliases
+ */
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4, 16, 0)
+typedef unsigned int __poll_t;
+#define EPOLLIN POLLIN
+#define EPOLLOUT POLLOUT
+#define EPOLLERR POLLERR
+#define EPOLLHUP POLLHUP
+#define EPOLLRDNORM POLLRDNORM
+#define EPOLLWRNORM POLLWRNORM
+#endif
+
 /*!
  * @brief rx bulk transfer structure
  */
@@ -99,13 +127,69 @@ typedef struct apt_usbtrx_rx_transfer_s apt_usbtrx_rx_transfer_t;
  */
 struct apt_usbtrx_rx_complete_s {
 	struct completion complete;
-	u8 id;
 	u8 *buffer;
 	int buffer_size;
 	int data_size;
 };
 typedef struct apt_usbtrx_rx_complete_s apt_usbtrx_rx_complete_t;
 
+/*!
+ * @brief rx reader wakeup watermarks (like termios VMIN/VTIME)
+ *
+ * The reader is woken when min_bytes are queued, or min_frames have been queued since
+ * rx_data was last drained, or timeout_us has passed since the first of them.
+ * If both min_bytes and min_frames are 0, the reader is woken for every frame.
+ */
+struct apt_usbtrx_rx_wakeup_s {
+	unsigned int min_bytes; /*!< 0: not used */
+	unsigned int min_frames; /*!< 0: not used */
+	unsigned int timeout_us; /*!< 0: not used */
+	atomic_t frames; /*!< frames queued since rx_data was last drained */
+	atomic_t expired; /*!< timeout_us has passed since the first unread frame */
+	struct hrtimer timer; /*!< */
+};
+typedef struct apt_usbtrx_rx_wakeup_s apt_usbtrx_rx_wakeup_t;
+
+struct apt_usbtrx_dev_s;
+struct apt_usbtrx_cmd_req_s;
+
+/*!
+ * @brief command completion callback
+ * NOTE: called in urb completion (atomic) context, or in the timeout work with RESULT_Timeout.
+ */
+typedef void (*apt_usbtrx_cmd_callback_t)(struct apt_usbtrx_dev_s *dev, struct apt_usbtrx_cmd_req_s *req);
+
+/*!
+ * @brief command request structure
+ *
+ * The device does not tag responses, so in-flight requests are matched by
+ * the request command id (ACK/NACK carry it, Response* map to it).
+ * Requests with the same id are serialized, others are pipelined.
+ */
+struct apt_usbtrx_cmd_req_s {
+	u8 id; /*!< request command id */
+	u8 *data; /*!< packed request message, owned by the caller */
+	int data_size; /*!< */
+	unsigned int timeout_msec; /*!< */
+	unsigned long expires; /*!< jiffies */
+	int status; /*!< RESULT_Success, RESULT_Timeout or RESULT_Failure */
+	u8 resp[APT_USBTRX_CMD_MAX_LENGTH]; /*!< response message (ACK, NACK or Response*) */
+	int resp_size; /*!< */
+	apt_usbtrx_cmd_callback_t callback; /*!< NULL to wait with apt_usbtrx_cmd_wait() */
+	void *context; /*!< */
+	struct completion done; /*!< */
+};
+typedef struct apt_usbtrx_cmd_req_s apt_usbtrx_cmd_req_t;
+
+/*!
+ * @brief command buffer (request and response message of one command)
+ */
+struct apt_usbtrx_cmd_buf_s {
+	u8 req[APT_USBTRX_CMD_MAX_LENGTH]; /*!< */
+	u8 resp[APT_USBTRX_CMD_MAX_LENGTH]; /*!< */
+} ____cacheline_aligned;
+typedef struct apt_usbtrx_cmd_buf_s apt_usbtrx_cmd_buf_t;
+
 /*!
  * @brief timestamp structure
  */
@@ -116,19 +200,85 @@ struct apt_usbtrx_timestamp_s {
 typedef struct apt_usbtrx_timestamp_s apt_usbtrx_timestamp_t;
 
 /*!
- * @brief device unique function
+ * @brief rx overflow marker state (producer side)
+ *
+ * Frames dropped because rx_data is full are accumulated here, then an
+ * overflow marker record is written in front of the next stored frame.
  */
+struct apt_usbtrx_rx_overflow_s {
+	bool enable; /*!< insert overflow markers into rx_data */
+	u32 frames; /*!< frames dropped since the last marker */
+	u32 bytes; /*!< */
+	apt_usbtrx_timestamp_t first; /*!< timestamp of the first dropped frame */
+	apt_usbtrx_timestamp_t last; /*!< timestamp of the last dropped frame */
+};
+typedef struct apt_usbtrx_rx_overflow_s apt_usbtrx_rx_overflow_t;
+
+/*!
+ * @brief rx capture (flight recorder) state
+ *
+ * While armed or triggered the producer also owns the tail of rx_data and
+ * overwrites the oldest frames, readers are refused until the ring is frozen.
+ */
+struct apt_usbtrx_rx_capture_s {
+	spinlock_t lock; /*!< serializes the producer with trigger and mode changes */
+	struct mutex read_lock; /*!< serializes rx_data readers with each other and with mode changes */
+	int mode; /*!< APT_USBTRX_RX_CAPTURE_MODE */
+	int state; /*!< APT_USBTRX_RX_CAPTURE_STATE */
+	unsigned int post_frames; /*!< */
+	unsigned int remaining; /*!< frames left to store until frozen */
+	bool can_id_enable; /*!< */
+	u32 can_id; /*!< */
+	u32 can_mask; /*!< */
+};
+typedef struct apt_usbtrx_rx_capture_s apt_usbtrx_rx_capture_t;
+
+/*!
+ * @brief socketcan echo skb tracking structure
+ *
+ * Frames go through tx_data and the bulk-out urbs in order, so echo slots
+ * are handed out and completed as a FIFO of sequence numbers.
+ */
+struct apt_usbtrx_tx_echo_s {
+	unsigned int max; /*!< active in-flight limit (power of 2), latched at netdev open */
+	unsigned int head; /*!< next sequence to put, updated in start_xmit */
+	unsigned int tail; /*!< next sequence to complete, updated in write bulk callback */
+	u8 len[APT_USBTRX_ECHO_SKB_MAX]; /*!< data length per slot */
+	unsigned int gen; /*!< bumped on reset and flush, completions of older urbs are ignored */
+	spinlock_t lock; /*!< serializes the completing side (tail) with reset and flush */
+};
+typedef struct apt_usbtrx_tx_echo_s apt_usbtrx_tx_echo_t;
+
 struct apt_usbtrx_dev_s;
+
+#define APT_USBTRX_MSG_ID_MAX (256)
+
+/*!
+ * @brief message handler
+ */
+typedef int (*apt_usbtrx_msg_handler_t)(struct apt_usbtrx_dev_s *dev, u8 *data, apt_usbtrx_msg_view_t *msg);
+
+/*!
+ * @brief message dispatch table entry (indexed by message id)
+ */
+struct apt_usbtrx_msg_entry_s {
+	apt_usbtrx_msg_handler_t handler; /*!< NULL if the message is not supported */
+	u8 request_id; /*!< request command id, for responses */
+};
+typedef struct apt_usbtrx_msg_entry_s apt_usbtrx_msg_entry_t;
+
+/*!
+ * @brief device unique function
+ */
 struct apt_usbtrx_device_unique_function_s {
 	int (*init_data)(struct apt_usbtrx_dev_s *dev);
 	int (*free_data)(struct apt_usbtrx_dev_s *dev);
 	int (*init)(struct usb_interface *intf, const struct usb_device_id *id);
 	int (*terminate)(struct apt_usbtrx_dev_s *dev);
 	bool (*is_need_init_reset_ts)(struct apt_usbtrx_dev_s *dev);
-	int (*dispatch_msg)(struct apt_usbtrx_dev_s *dev, u8 *data, apt_usbtrx_msg_t *msg);
+	const apt_usbtrx_msg_entry_t *msg_table; /*!< APT_USBTRX_MSG_ID_MAX entries */
 	int (*get_read_payload_size)(const void *payload);
 	int (*get_write_payload_size)(const void *payload);
-	apt_usbtrx_timestamp_t *(*get_read_payload_timestamp)(const void *payload);
 	int (*get_write_cmd_id)(void);
 	int (*get_fw_size)(void);
 	long (*ioctl)(struct file *file, unsigned int cmd, unsigned long arg);
@@ -137,7 +287,7 @@ struct apt_usbtrx_device_unique_function_s {
 	int (*sysfs_term)(struct device *dev);
 	int (*open)(struct apt_usbtrx_dev_s *dev);
 	int (*close)(struct apt_usbtrx_dev_s *dev);
-	void (*write_bulk_callback)(struct urb *urb);
+	void (*write_bulk_callback)(struct apt_usbtrx_dev_s *dev, int msg_count, int status);
 };
 typedef struct apt_usbtrx_device_unique_function_s apt_usbtrx_device_unique_function_t;
 
@@ -175,6 +325,11 @@ struct apt_usbtrx_dev_s {
 	void *rxbuf[MAX_RX_URBS]; /*!< */
 	dma_addr_t rxbuf_dma[MAX_RX_URBS]; /*!< */
 	apt_usbtrx_ringbuffer_t rx_data; /*!< */
+	apt_usbtrx_rx_wakeup_t rx_wakeup; /*!< reader wakeup watermarks of rx_data */
+	apt_usbtrx_rx_overflow_t rx_overflow; /*!< overflow markers of rx_data */
+	apt_usbtrx_rx_capture_t rx_capture; /*!< flight recorder mode of rx_data */
+	struct mutex rx_settings_lock; /*!< serializes the first open and the last release of the device file */
+	unsigned int rx_settings_users; /*!< open files sharing the rx settings (watermarks, markers, capture) */
 	apt_usbtrx_rx_transfer_t rx_transfer; /*!< */
 	apt_usbtrx_rx_complete_t rx_complete; /*!< */
 	atomic_t rx_ongoing; /*!< */
@@ -182,16 +337,40 @@ struct apt_usbtrx_dev_s {
 	struct timespec64 basetime; /*!< */
 	atomic_t onopening; /*!< */
 	atomic_t onclosing; /*!< */
+	struct work_struct init_work; /*!< deferred device interrogation */
+	const struct usb_device_id *init_id; /*!< */
+	struct completion init_done; /*!< completed when the device interrogation has finished */
+	int init_result; /*!< result of the device interrogation */
 	struct timespec64 *resettime; /*!< */
 	int fw_count; /*!< */
-	struct semaphore send_msg_sem; /*!< */
+	struct semaphore send_msg_sem; /*!< serializes apt_usbtrx_send_msg_sync()/apt_usbtrx_wait_msg() pairs */
+	apt_usbtrx_cmd_req_t cmd_legacy; /*!< request used by apt_usbtrx_send_msg_sync() */
+	apt_usbtrx_cmd_req_t *cmd_inflight[APT_USBTRX_CMD_INFLIGHT_MAX]; /*!< in-flight requests */
+	spinlock_t cmd_lock; /*!< protects cmd_inflight */
+	wait_queue_head_t cmd_wq; /*!< woken when an in-flight slot is released */
+	struct delayed_work cmd_timeout_work; /*!< expires requests with a callback */
+	apt_usbtrx_cmd_buf_t cmd_bufs[APT_USBTRX_CMD_BUFS]; /*!< preallocated command buffers */
+	unsigned long cmd_bufs_free; /*!< bitmap of idle command buffers */
+	struct semaphore cmd_bufs_sem; /*!< counts idle command buffers */
 	struct semaphore tx_usb_transfer_sem; /*!< */
 	apt_usbtrx_ringbuffer_t tx_data; /*!< */
+	struct mutex tx_data_lock; /*!< serializes write() producers of tx_data */
 	atomic_t tx_data_clear_requested; /*!< */
 	unsigned long tx_transfer_expired; /*!< */
 	int tx_transfer_max_token; /*!< */
 	int tx_transfer_token; /*!< */
 	struct task_struct *tx_thread; /*!< */
+	atomic_t tx_aggregate; /*!< pack multiple messages into one bulk-out transfer */
+	u8 *tx_aggregate_buffer; /*!< */
+	size_t tx_aggregate_buffer_size; /*!< */
+	struct urb *tx_urbs[MAX_TX_URBS]; /*!< preallocated tx urb pool */
+	void *txbuf[MAX_TX_URBS]; /*!< */
+	dma_addr_t txbuf_dma[MAX_TX_URBS]; /*!< */
+	unsigned long tx_urbs_free; /*!< bitmap of idle tx urbs */
+	int txbuf_msgs[MAX_TX_URBS]; /*!< number of messages in each tx urb */
+	unsigned int txbuf_gen[MAX_TX_URBS]; /*!< tx_echo.gen when each tx urb was submitted */
+	unsigned int echo_skb_max; /*!< configured in-flight limit of socketcan echo skbs */
+	apt_usbtrx_tx_echo_t tx_echo; /*!< socketcan echo skb slots in flight */
 	int ch; /*!< */
 	char serial_no[APT_USBTRX_SERIAL_NO_LENGTH + 1]; /*!< */
 	char model_name[APT_USBTRX_MODEL_NAME_LENGTH + 1]; /*!< */
@@ -203,7 +382,17 @@ struct apt_usbtrx_dev_s {
 	enum APT_USBTRX_TIMESTAMP_MODE timestamp_mode; /*!< */
 	enum APT_USBTRX_DEVICE_TYPE device_type; /*!< */
 	size_t rx_data_size; /*!< */
-	u8 *rx_rbmsg; /*!< */
+	size_t tx_data_size; /*!< */
+	struct mutex data_buffer_lock; /*!< serializes resizing of rx_data/tx_data with their users */
+	unsigned int data_buffer_users; /*!< open files and netdevs using rx_data/tx_data */
+	atomic_t rx_data_mapped; /*!< live mmap areas of rx_data */
+	u64 rx_urb_time_ns; /*!< host time of the rx urb being parsed, relative to basetime */
+	atomic64_t rx_resync_count; /*!< number of stream resynchronizations after a parse error */
+	atomic64_t rx_resync_bytes; /*!< bytes discarded by stream resynchronization */
+	apt_usbtrx_clock_t clock; /*!< device to host clock estimator */
+	struct ptp_clock *ptp_clock; /*!< NULL if not registered */
+	struct ptp_clock_info ptp_info; /*!< */
+	s64 ptp_offset_us; /*!< subtracted from the device time to match the netdev hardware timestamps */
 	void *unique_data; /*!< */
 
 	/* device unique function */
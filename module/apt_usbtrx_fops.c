@@ -8,6 +8,8 @@
 
 #include <linux/usb.h>
 #include <linux/uaccess.h>
+#include <linux/mm.h>
+#include <linux/uio.h>
 
 #include "apt_usbtrx_fops.h"
 #include "apt_usbtrx_core.h"
@@ -30,73 +32,7 @@ static bool apt_usbtrx_is_read_enable(apt_usbtrx_dev_t *dev)
 		return true;
 	}
 
-	if (apt_usbtrx_ringbuffer_is_empty(&dev->rx_data) != true) {
-		return true;
-	}
-
-	return false;
-}
-
-/*!
- * @brief parse rbmsg
- */
-int apt_usbtrx_parse_rbmsg(apt_usbtrx_dev_t *dev, u8 *payload, size_t size, u64 relative_time_ns)
-{
-	apt_usbtrx_timestamp_t *timestamp = NULL;
-	ssize_t remain = size;
-	u64 dev_time_us = 0;
-	u64 hst_time_us = 0;
-	int ts_mode = dev->timestamp_mode;
-
-	if (payload == NULL) {
-		EMSG("payload is NULL");
-		return RESULT_Failure;
-	}
-
-	do_div(relative_time_ns, NSEC_PER_USEC);
-	hst_time_us = relative_time_ns;
-
-	if (ts_mode == APT_USBTRX_TIMESTAMP_MODE_HOST) {
-		dev_time_us = hst_time_us;
-	}
-
-	/* parse rbmsg */
-	while (remain > 0) {
-		int payload_size = 0;
-
-		timestamp = dev->unique_func.get_read_payload_timestamp(payload);
-		if (timestamp == NULL) {
-			EMSG("failed to get timestamp");
-			return RESULT_Failure;
-		}
-
-		/* overrite time stamp */
-		if (ts_mode != APT_USBTRX_TIMESTAMP_MODE_DEVICE) {
-			u64 v64 = dev_time_us;
-			do_div(v64, USEC_PER_SEC);
-			timestamp->ts_sec = (u32)(v64);
-			timestamp->ts_usec = (u32)(dev_time_us - (timestamp->ts_sec * USEC_PER_SEC));
-		}
-
-		payload_size = dev->unique_func.get_read_payload_size(payload);
-		if (payload_size < 0) {
-			EMSG("failed to get payload_size");
-			return RESULT_Failure;
-		}
-		if (payload_size > APT_USBTRX_MSG_LENGTH_TO_PAYLOAD(APT_USBTRX_CMD_MAX_LENGTH)) {
-			EMSG("length is over max payload size, <payload_size:%d>", payload_size);
-			return RESULT_Failure;
-		}
-
-		remain -= payload_size;
-		if (remain < 0) {
-			EMSG("invalid payload_size");
-		} else {
-			payload += payload_size;
-		}
-	}
-
-	return RESULT_Success;
+	return apt_usbtrx_rx_data_is_ready(dev);
 }
 
 /*!
@@ -128,17 +64,27 @@ int apt_usbtrx_open(struct inode *inode, struct file *file)
 		return -ENODEV;
 	}
 
-	onopening = atomic_read(&dev->onopening);
-	if (onopening == true) {
-		IMSG("connect..., open cansel");
-		return -ENODEV;
+	/* the device is interrogated in the background after probe */
+	kref_get(&dev->kref);
+	result = wait_for_completion_interruptible(&dev->init_done);
+	if (result != 0) {
+		kref_put(&dev->kref, apt_usbtrx_delete);
+		return result;
 	}
 
 	onclosing = atomic_read(&dev->onclosing);
 	if (onclosing == true) {
 		IMSG("disconnect..., open cansel");
+		kref_put(&dev->kref, apt_usbtrx_delete);
 		return -ESHUTDOWN;
 	}
+
+	onopening = atomic_read(&dev->onopening);
+	if (onopening == true) {
+		IMSG("connect failed..., open cansel");
+		kref_put(&dev->kref, apt_usbtrx_delete);
+		return -ENODEV;
+	}
 #if 0
 	/*
 	 * !! FIXME !! permission denied (no:13) if exec
@@ -150,14 +96,19 @@ int apt_usbtrx_open(struct inode *inode, struct file *file)
 	}
 #endif
 
+	/* rx_data/tx_data are not resized while the file is open */
+	apt_usbtrx_data_buffer_get(dev);
+
 	result = dev->unique_func.open(dev);
 	if (result < 0) {
 		EMSG("open failed");
+		apt_usbtrx_data_buffer_put(dev);
+		kref_put(&dev->kref, apt_usbtrx_delete);
 		return result;
 	}
 
-	/* increment our usage count for the device */
-	kref_get(&dev->kref);
+	/* watermarks, overflow markers and capture mode are shared by the open files */
+	apt_usbtrx_rx_settings_get(dev);
 
 	file->private_data = dev;
 
@@ -201,6 +152,8 @@ int apt_usbtrx_release(struct inode *inode, struct file *file)
 	}
 
 	retval = dev->unique_func.close(dev);
+	apt_usbtrx_rx_settings_put(dev);
+	apt_usbtrx_data_buffer_put(dev);
 
 #if 0
 	if (dev->interface != NULL) {
@@ -229,7 +182,6 @@ ssize_t apt_usbtrx_read(struct file *file, char __user *buffer, size_t count, lo
 	int result;
 	bool onopening;
 	bool onclosing;
-	u64 relative_time_ns;
 
 	dev = file->private_data;
 	if (dev == NULL) {
@@ -265,38 +217,35 @@ ssize_t apt_usbtrx_read(struct file *file, char __user *buffer, size_t count, lo
 		return -ESHUTDOWN;
 	}
 
-	if (dev->timestamp_mode == APT_USBTRX_TIMESTAMP_MODE_DEVICE) {
-		/* copy to user memory space */
-		rsize = apt_usbtrx_ringbuffer_read(&dev->rx_data, buffer, count);
-		if (rsize < 0) {
-			EMSG("apt_usbtrx_ringbuffer_read().. Error");
-			return -EIO;
-		}
-	} else {
-		/* copy to kernel memory space and then to user memory space */
-		size_t rbmsg_rsize = apt_usbtrx_ringbuffer_get_used_size(&dev->rx_data);
-		if (rbmsg_rsize > count) {
-			rbmsg_rsize = count;
-		}
+	/* the flight recorder has been armed again in the meantime */
+	result = apt_usbtrx_rx_capture_read_lock(dev);
+	if (result != 0) {
+		return result;
+	}
 
-		rsize = apt_usbtrx_ringbuffer_rawread(&dev->rx_data, dev->rx_rbmsg, rbmsg_rsize);
-		if (rsize < 0) {
-			EMSG("apt_usbtrx_ringbuffer_rawread().. Error");
-			return -EIO;
-		} else if (rsize != 0) {
-			relative_time_ns = apt_usbtrx_get_relative_time_ns(dev, &dev->basetime);
-			result = apt_usbtrx_parse_rbmsg(dev, dev->rx_rbmsg, rsize, relative_time_ns);
-			if (result != RESULT_Success) {
-				EMSG("apt_usbtrx_parse_rbmsg().. Error");
-				return -EIO;
-			}
-			if (copy_to_user(buffer, dev->rx_rbmsg, rsize) != 0) {
-				EMSG("copy_to_user().. Error");
-				return -EIO;
-			}
-		}
+	/* return whole frames only, a frame is never split across reads */
+	rsize = apt_usbtrx_ringbuffer_get_record_size(&dev->rx_data, count, apt_usbtrx_get_rx_record_size, dev, NULL);
+	if (rsize < 0) {
+		/* frame boundaries are lost, never hand out a partial frame */
+		apt_usbtrx_rx_capture_read_unlock(dev);
+		EMSG_RL("apt_usbtrx_ringbuffer_get_record_size().. Error, frame boundary is lost");
+		return -EIO;
+	} else if (rsize == 0) {
+		apt_usbtrx_rx_capture_read_unlock(dev);
+		EMSG_RL("read size is smaller than a frame, <count:%zu>", count);
+		return -EINVAL;
 	}
 
+	/* host timestamps are already stamped when the frames enter rx_data */
+	rsize = apt_usbtrx_ringbuffer_read(&dev->rx_data, buffer, rsize);
+	apt_usbtrx_rx_capture_read_unlock(dev);
+	if (rsize < 0) {
+		EMSG("apt_usbtrx_ringbuffer_read().. Error");
+		return -EIO;
+	}
+	/* restart the watermarks if drained */
+	apt_usbtrx_rx_data_is_ready(dev);
+
 	if (onclosing == true) {
 		complete(&dev->rx_done);
 	}
@@ -304,23 +253,130 @@ ssize_t apt_usbtrx_read(struct file *file, char __user *buffer, size_t count, lo
 }
 
 /*!
- * @brief write tx ringbuffer
+ * @brief poll
  */
-ssize_t apt_usbtrx_write_tx_rb(apt_usbtrx_dev_t *dev, const void *payload, const u8 payload_size)
+__poll_t apt_usbtrx_poll(struct file *file, poll_table *wait)
 {
-	u8 data[APT_USBTRX_CMD_MAX_LENGTH];
-	u8 msg_size;
-	apt_usbtrx_msg_t msg;
+	apt_usbtrx_dev_t *dev;
+	__poll_t mask = 0;
+	bool tx_enable;
+
+	dev = file->private_data;
+	if (dev == NULL) {
+		EMSG("dev is NULL");
+		return EPOLLERR;
+	}
+
+	if (atomic_read(&dev->onopening) == true) {
+		return EPOLLERR;
+	}
+
+	/* tx_data is not initialized in DFU mode */
+	tx_enable = (dev->tx_data.buffer != NULL);
+
+	poll_wait(file, &dev->rx_data.wq, wait);
+	if (tx_enable) {
+		poll_wait(file, &dev->tx_data.wq, wait);
+	}
+
+	if (atomic_read(&dev->onclosing) == true) {
+		return EPOLLHUP | EPOLLERR;
+	}
+
+	if (apt_usbtrx_rx_data_is_ready(dev)) {
+		mask |= EPOLLIN | EPOLLRDNORM;
+	}
+
+	if (tx_enable && apt_usbtrx_ringbuffer_get_free_size(&dev->tx_data) >= APT_USBTRX_CMD_MAX_LENGTH) {
+		mask |= EPOLLOUT | EPOLLWRNORM;
+	}
+
+	return mask;
+}
+
+/*!
+ * @brief vm open (mmap area duplicated by fork or split)
+ */
+static void apt_usbtrx_vm_open(struct vm_area_struct *vma)
+{
+	apt_usbtrx_dev_t *dev = vma->vm_private_data;
+
+	atomic_inc(&dev->rx_data_mapped);
+}
+
+/*!
+ * @brief vm close
+ */
+static void apt_usbtrx_vm_close(struct vm_area_struct *vma)
+{
+	apt_usbtrx_dev_t *dev = vma->vm_private_data;
+
+	atomic_dec(&dev->rx_data_mapped);
+}
+
+static const struct vm_operations_struct apt_usbtrx_vm_ops = {
+	.open = apt_usbtrx_vm_open,
+	.close = apt_usbtrx_vm_close,
+};
+
+/*!
+ * @brief mmap
+ *
+ * Maps the control page and the ring data of rx_data. Timestamps are stamped
+ * when the frames enter the ring, so readers see them in the active timestamp mode.
+ */
+int apt_usbtrx_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	apt_usbtrx_dev_t *dev;
 	int result;
-	bool onopening;
-	bool onclosing;
-	ssize_t wsize;
-	size_t free_size;
 
-	if (payload_size == 0) {
-		return 0;
+	dev = file->private_data;
+	if (dev == NULL) {
+		EMSG("dev is NULL");
+		return -ENODEV;
+	}
+
+	if (atomic_read(&dev->onopening) == true) {
+		IMSG("connect..., mmap cansel");
+		return -ENODEV;
 	}
 
+	if (atomic_read(&dev->onclosing) == true) {
+		IMSG("disconnect..., mmap cansel");
+		return -ESHUTDOWN;
+	}
+
+	if (vma->vm_flags & VM_EXEC) {
+		return -EPERM;
+	}
+
+	/* the mmap consumer owns tail, which the flight recorder moves */
+	result = apt_usbtrx_rx_capture_map_get(dev);
+	if (result != RESULT_Success) {
+		EMSG("rx_data cannot be mapped in flight recorder mode");
+		return -EBUSY;
+	}
+
+	result = apt_usbtrx_ringbuffer_mmap(&dev->rx_data, vma);
+	if (result != RESULT_Success) {
+		atomic_dec(&dev->rx_data_mapped);
+		EMSG("apt_usbtrx_ringbuffer_mmap().. Error");
+		return -EINVAL;
+	}
+	vma->vm_private_data = dev;
+	vma->vm_ops = &apt_usbtrx_vm_ops;
+
+	return 0;
+}
+
+/*!
+ * @brief check if tx is acceptable
+ */
+static ssize_t apt_usbtrx_check_write_enable(apt_usbtrx_dev_t *dev, const int payload_size)
+{
+	bool onopening;
+	bool onclosing;
+
 	onopening = atomic_read(&dev->onopening);
 	if (onopening == true) {
 		IMSG("connect..., write cansel");
@@ -333,35 +389,74 @@ ssize_t apt_usbtrx_write_tx_rb(apt_usbtrx_dev_t *dev, const void *payload, const
 		return -ESHUTDOWN;
 	}
 
-	if (payload_size > APT_USBTRX_MSG_LENGTH_TO_PAYLOAD(APT_USBTRX_CMD_MAX_LENGTH)) {
+	if (payload_size <= 0 || payload_size > APT_USBTRX_MSG_LENGTH_TO_PAYLOAD(APT_USBTRX_CMD_MAX_LENGTH)) {
 		EMSG("invalid payload_size <size:%d> ..., write cansel", payload_size);
 		return -EIO;
 	}
 
-	/*
-	* FIXME: Currently, only one message can be written per write() call.
-	* TODO: Allow multiple messages to be written at once in a single write() call.
-	*/
-	msg_size = APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(payload_size);
+	return 0;
+}
 
-	memcpy(msg.payload, payload, payload_size);
-	msg.id = dev->unique_func.get_write_cmd_id();
-	msg.payload_size = payload_size;
-	result = apt_usbtrx_msg_pack(&msg, data, msg_size);
+/*!
+ * @brief pack payload and push it to tx ringbuffer
+ *
+ * The caller must have checked the free size of tx ringbuffer.
+ */
+static int apt_usbtrx_push_tx_msg(apt_usbtrx_dev_t *dev, apt_usbtrx_msg_t *msg)
+{
+	u8 data[APT_USBTRX_CMD_MAX_LENGTH];
+	u8 msg_size;
+	ssize_t wsize;
+	int result;
+
+	msg_size = APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size);
+
+	msg->id = dev->unique_func.get_write_cmd_id();
+	result = apt_usbtrx_msg_pack(msg, data, msg_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		return -EIO;
+		return RESULT_Failure;
+	}
+
+	wsize = apt_usbtrx_ringbuffer_write(&dev->tx_data, data, msg_size);
+	if (wsize < 0) {
+		EMSG("apt_usbtrx_ringbuffer_write().. Error");
+		return RESULT_Failure;
+	}
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief write tx ringbuffer
+ */
+ssize_t apt_usbtrx_write_tx_rb(apt_usbtrx_dev_t *dev, const void *payload, const u8 payload_size)
+{
+	apt_usbtrx_msg_t msg;
+	int result;
+	ssize_t ret;
+	size_t free_size;
+
+	if (payload_size == 0) {
+		return 0;
+	}
+
+	ret = apt_usbtrx_check_write_enable(dev, payload_size);
+	if (ret < 0) {
+		return ret;
 	}
 
 	free_size = apt_usbtrx_ringbuffer_get_free_size(&dev->tx_data);
-	if (free_size < msg_size) {
+	if (free_size < APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(payload_size)) {
 		EMSG("write buffer is full");
 		return -EIO;
 	}
 
-	wsize = apt_usbtrx_ringbuffer_write(&dev->tx_data, data, msg_size);
-	if (wsize < 0) {
-		EMSG("apt_usbtrx_ringbuffer_write().. Error");
+	memcpy(msg.payload, payload, payload_size);
+	msg.payload_size = payload_size;
+	result = apt_usbtrx_push_tx_msg(dev, &msg);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_push_tx_msg().. Error");
 		return -EIO;
 	}
 
@@ -369,51 +464,91 @@ ssize_t apt_usbtrx_write_tx_rb(apt_usbtrx_dev_t *dev, const void *payload, const
 
 	return payload_size;
 }
+
 /*!
  * @brief write
+ *
+ * Accepts N back-to-back payloads of get_write_payload_size() bytes each, and
+ * also serves write() through the VFS. As many whole payloads as fit into
+ * tx ringbuffer are accepted and the accepted size is returned.
  */
-ssize_t apt_usbtrx_write(struct file *file, const char __user *buffer, size_t count, loff_t *ppos)
+ssize_t apt_usbtrx_write_iter(struct kiocb *iocb, struct iov_iter *from)
 {
 	apt_usbtrx_dev_t *dev;
-	u8 payload_size;
 	apt_usbtrx_msg_t msg;
+	size_t count;
+	size_t frames;
+	size_t free_frames;
+	size_t i;
+	int payload_size;
 	int result;
+	ssize_t ret;
 
-	dev = file->private_data;
+	dev = iocb->ki_filp->private_data;
 	if (dev == NULL) {
 		EMSG("dev is NULL");
 		return -ENODEV;
 	}
 
+	count = iov_iter_count(from);
 	if (count == 0) {
 		return 0;
 	}
 
-	/* copy from user */
-	payload_size = dev->unique_func.get_write_payload_size(buffer); /* buffer not used */
-	if (payload_size > APT_USBTRX_MSG_LENGTH_TO_PAYLOAD(APT_USBTRX_CMD_MAX_LENGTH)) {
-		EMSG("invalid payload_size <size:%d> ..., write cansel", payload_size);
-		return -EIO;
+	payload_size = dev->unique_func.get_write_payload_size(msg.payload); /* payload not used */
+	ret = apt_usbtrx_check_write_enable(dev, payload_size);
+	if (ret < 0) {
+		return ret;
 	}
 
-	if (payload_size != count) {
-		EMSG("write size is not payload size..., write cansel");
+	if ((count % payload_size) != 0) {
+		EMSG("write size is not a multiple of payload size..., write cansel");
 		return -EIO;
 	}
 
-	result = copy_from_user(msg.payload, buffer, payload_size);
+	/* several files and threads may write, tx_data takes a single producer at a time */
+	result = mutex_lock_interruptible(&dev->tx_data_lock);
 	if (result != 0) {
-		EMSG("copy_from_user().. Error");
+		return result;
+	}
+
+	/* the tx thread only consumes, so free space only grows from here */
+	frames = count / payload_size;
+	free_frames =
+		apt_usbtrx_ringbuffer_get_free_size(&dev->tx_data) / APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(payload_size);
+	if (free_frames == 0) {
+		mutex_unlock(&dev->tx_data_lock);
+		EMSG("write buffer is full");
 		return -EIO;
 	}
+	if (frames > free_frames) {
+		frames = free_frames;
+	}
 
-	result = apt_usbtrx_write_tx_rb(dev, msg.payload, payload_size);
-	if (result < 0) {
-		EMSG("apt_usbtrx_write_rb().. Error");
-		return result;
+	for (i = 0; i < frames; ++i) {
+		if (copy_from_iter(msg.payload, payload_size, from) != payload_size) {
+			EMSG("copy_from_iter().. Error");
+			ret = -EFAULT;
+			break;
+		}
+		msg.payload_size = payload_size;
+
+		result = apt_usbtrx_push_tx_msg(dev, &msg);
+		if (result != RESULT_Success) {
+			EMSG("apt_usbtrx_push_tx_msg().. Error");
+			ret = -EIO;
+			break;
+		}
 	}
+	mutex_unlock(&dev->tx_data_lock);
 
-	return count;
+	if (i == 0) {
+		return ret;
+	}
+
+	wake_up_interruptible(&dev->tx_data.wq);
+
+	return i * payload_size;
 }
 
 /*!
@@ -609,6 +744,7 @@ long apt_usbtrx_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			return -EFAULT;
 		}
 		dev->basetime = timespec_to_timespec64(param.basetime);
+		apt_usbtrx_clock_reset(&dev->clock);
 		break;
 	}
 	case APT_USBTRX_IOCTL_MOVE_DFU: {
@@ -662,7 +798,11 @@ long apt_usbtrx_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			return -EBUSY;
 		}
 
-		dev->timestamp_mode = param.timestamp_mode;
+		/* without a ptp clock the estimator pauses outside HOST_CORRECTED, its samples are stale */
+		if (param.timestamp_mode != dev->timestamp_mode && dev->ptp_clock == NULL) {
+			apt_usbtrx_clock_reset(&dev->clock);
+		}
+		WRITE_ONCE(dev->timestamp_mode, param.timestamp_mode);
 		DMSG("%s(): timestamp_mode=%d", __func__, param.timestamp_mode);
 		break;
 	}
@@ -677,6 +817,160 @@ long apt_usbtrx_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		}
 		break;
 	}
+	case APT_USBTRX_IOCTL_SET_RX_WAKEUP: {
+		apt_usbtrx_ioctl_rx_wakeup_t param;
+
+		result = copy_from_user(&param, (void __user *)arg, sizeof(apt_usbtrx_ioctl_rx_wakeup_t));
+		if (result != 0) {
+			EMSG("copy_from_user().. Error");
+			return -EFAULT;
+		}
+
+		// check params
+		/* the ring may be full before min_bytes is reached if the last frame does not fit */
+		if (param.min_bytes > dev->rx_data.buffer_size - APT_USBTRX_RX_RECORD_MAX_SIZE) {
+			EMSG("invalid min_bytes, <min_bytes:%u> buffer size=%zu", param.min_bytes,
+			     dev->rx_data.buffer_size);
+			return -EINVAL;
+		}
+		if (param.timeout_us > APT_USBTRX_RX_WAKEUP_MAX_TIMEOUT_US) {
+			EMSG("invalid timeout_us, <timeout_us:%u>", param.timeout_us);
+			return -EINVAL;
+		}
+
+		WRITE_ONCE(dev->rx_wakeup.timeout_us, param.timeout_us);
+		WRITE_ONCE(dev->rx_wakeup.min_frames, param.min_frames);
+		WRITE_ONCE(dev->rx_wakeup.min_bytes, param.min_bytes);
+		/* wake a reader that may already be satisfied by the new watermarks */
+		wake_up_interruptible(&dev->rx_data.wq);
+		break;
+	}
+	case APT_USBTRX_IOCTL_GET_RX_WAKEUP: {
+		apt_usbtrx_ioctl_rx_wakeup_t param;
+
+		param.min_bytes = READ_ONCE(dev->rx_wakeup.min_bytes);
+		param.min_frames = READ_ONCE(dev->rx_wakeup.min_frames);
+		param.timeout_us = READ_ONCE(dev->rx_wakeup.timeout_us);
+
+		result = copy_to_user((void __user *)arg, &param, sizeof(apt_usbtrx_ioctl_rx_wakeup_t));
+		if (result != 0) {
+			EMSG("copy_to_user().. Error");
+			return -EFAULT;
+		}
+		break;
+	}
+	case APT_USBTRX_IOCTL_GET_RX_QUEUED: {
+		apt_usbtrx_ioctl_get_rx_queued_t param;
+		size_t frames;
+		ssize_t size;
+
+		result = apt_usbtrx_rx_capture_read_lock(dev);
+		if (result != 0) {
+			return result;
+		}
+		size = apt_usbtrx_ringbuffer_get_record_size(&dev->rx_data, dev->rx_data.buffer_size,
+							     apt_usbtrx_get_rx_record_size, dev, &frames);
+		apt_usbtrx_rx_capture_read_unlock(dev);
+		if (size < 0) {
+			EMSG("apt_usbtrx_ringbuffer_get_record_size().. Error");
+			return -EIO;
+		}
+
+		param.frames = frames;
+		param.bytes = size;
+
+		result = copy_to_user((void __user *)arg, &param, sizeof(apt_usbtrx_ioctl_get_rx_queued_t));
+		if (result != 0) {
+			EMSG("copy_to_user().. Error");
+			return -EFAULT;
+		}
+		break;
+	}
+	case APT_USBTRX_IOCTL_SET_RX_OVERFLOW_MARKER: {
+		apt_usbtrx_ioctl_rx_overflow_marker_t param;
+
+		result = copy_from_user(&param, (void __user *)arg, sizeof(apt_usbtrx_ioctl_rx_overflow_marker_t));
+		if (result != 0) {
+			EMSG("copy_from_user().. Error");
+			return -EFAULT;
+		}
+
+		// check params
+		if (param.enable != 0 && param.enable != 1) {
+			EMSG("invalid enable, <enable:%d>", param.enable);
+			return -EINVAL;
+		}
+
+		WRITE_ONCE(dev->rx_overflow.enable, param.enable == 1);
+		break;
+	}
+	case APT_USBTRX_IOCTL_GET_RX_OVERFLOW_MARKER: {
+		apt_usbtrx_ioctl_rx_overflow_marker_t param;
+		param.enable = READ_ONCE(dev->rx_overflow.enable) ? 1 : 0;
+
+		result = copy_to_user((void __user *)arg, &param, sizeof(apt_usbtrx_ioctl_rx_overflow_marker_t));
+		if (result != 0) {
+			EMSG("copy_to_user().. Error");
+			return -EFAULT;
+		}
+		break;
+	}
+	case APT_USBTRX_IOCTL_SET_RX_CAPTURE: {
+		apt_usbtrx_ioctl_rx_capture_t param;
+
+		result = copy_from_user(&param, (void __user *)arg, sizeof(apt_usbtrx_ioctl_rx_capture_t));
+		if (result != 0) {
+			EMSG("copy_from_user().. Error");
+			return -EFAULT;
+		}
+
+		// check params
+		if (param.mode < 0 || APT_USBTRX_RX_CAPTURE_MODE_MAX <= param.mode) {
+			EMSG("invalid rx capture mode, <mode:%d>", param.mode);
+			return -EINVAL;
+		}
+		if (param.can_id_enable != 0 && param.can_id_enable != 1) {
+			EMSG("invalid can_id_enable, <can_id_enable:%d>", param.can_id_enable);
+			return -EINVAL;
+		}
+		if (param.can_id_enable == 1 && dev->device_type == APT_USBTRX_DEVICE_TYPE_ANALOG) {
+			EMSG("can id trigger is not supported");
+			return -EINVAL;
+		}
+		/* post-trigger frames must not overwrite the trigger frame */
+		if (param.mode == APT_USBTRX_RX_CAPTURE_MODE_FLIGHT_RECORDER &&
+		    ((u64)param.post_frames + 1) * APT_USBTRX_RX_RECORD_MAX_SIZE > dev->rx_data.buffer_size) {
+			EMSG("invalid post_frames, <post_frames:%u>", param.post_frames);
+			return -EINVAL;
+		}
+
+		result = apt_usbtrx_rx_capture_set(dev, &param);
+		if (result != RESULT_Success) {
+			EMSG("rx_data is mapped");
+			return -EBUSY;
+		}
+		break;
+	}
+	case APT_USBTRX_IOCTL_GET_RX_CAPTURE: {
+		apt_usbtrx_ioctl_rx_capture_t param;
+
+		apt_usbtrx_rx_capture_get(dev, &param);
+
+		result = copy_to_user((void __user *)arg, &param, sizeof(apt_usbtrx_ioctl_rx_capture_t));
+		if (result != 0) {
+			EMSG("copy_to_user().. Error");
+			return -EFAULT;
+		}
+		break;
+	}
+	case APT_USBTRX_IOCTL_TRIGGER_RX_CAPTURE: {
+		result = apt_usbtrx_rx_capture_trigger(dev);
+		if (result != RESULT_Success) {
+			EMSG("rx capture is not armed");
+			return -EINVAL;
+		}
+		break;
+	}
 	case APT_USBTRX_IOCTL_GET_FIRMWARE_SIZE: {
 		apt_usbtrx_ioctl_get_firmware_size_t param;
 		param.firmware_size = dev->unique_func.get_fw_size();
@@ -767,7 +1061,8 @@ ssize_t apt_usbtrx_write_fw_data(struct file *file, const char __user *buffer, s
 		return -EIO;
 	}
 
-	result = apt_usbtrx_setup_tx_urb(dev, data, data_size);
+	/* firmware data has no echo skbs */
+	result = apt_usbtrx_setup_tx_urb(dev, data, data_size, 0);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_setup_tx_urb().. Error");
 		up(&dev->tx_usb_transfer_sem);
@@ -8,6 +8,7 @@
 #define __APT_USBTRX_FOPS_H__
 
 #include <linux/fs.h>
+#include <linux/poll.h>
 #include "apt_usbtrx_def.h"
 
 /*!
@@ -26,9 +27,19 @@ int apt_usbtrx_release(struct inode *inode, struct file *file);
 ssize_t apt_usbtrx_read(struct file *file, char __user *buffer, size_t count, loff_t *ppos);
 
 /*!
- * @brief write
+ * @brief write (write/writev)
  */
-ssize_t apt_usbtrx_write(struct file *file, const char __user *buffer, size_t count, loff_t *ppos);
+ssize_t apt_usbtrx_write_iter(struct kiocb *iocb, struct iov_iter *from);
+
+/*!
+ * @brief poll
+ */
+__poll_t apt_usbtrx_poll(struct file *file, poll_table *wait);
+
+/*!
+ * @brief mmap
+ */
+int apt_usbtrx_mmap(struct file *file, struct vm_area_struct *vma);
 
 /*!
  * @brief write tx ringbuffer
@@ -45,9 +56,4 @@ long apt_usbtrx_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
  */
 ssize_t apt_usbtrx_write_fw_data(struct file *file, const char __user *buffer, size_t count, loff_t *ppos);
 
-/*!
- * @brief parse rbmsg
- */
-int apt_usbtrx_parse_rbmsg(apt_usbtrx_dev_t *dev, u8 *payload, size_t size, u64 relative_time_ns);
-
 #endif /* __APT_USBTRX_FOPS_H__ */
@@ -175,6 +175,124 @@ struct apt_usbtrx_ioctl_set_timestamp_mode_s {
  */
 typedef struct apt_usbtrx_ioctl_set_timestamp_mode_s apt_usbtrx_ioctl_set_timestamp_mode_t;
 
+/**
+ * struct apt_usbtrx_ioctl_rx_wakeup_s - Reader wakeup watermarks
+ * @min_bytes: Wake up the reader when this many bytes are queued. 0: not used.
+ *             At most the RX ring size minus the maximum frame size.
+ * @min_frames: Wake up the reader when this many frames are queued. 0: not used.
+ * @timeout_us: Wake up the reader when this time has passed since the first unread frame,
+ *              even if no watermark is reached. 0: wait for a watermark.
+ *              At most APT_USBTRX_RX_WAKEUP_MAX_TIMEOUT_US.
+ *
+ * If both @min_bytes and @min_frames are 0 (default), the reader is woken up for every frame.
+ * read() and poll() wait for the watermarks. The settings are shared by all open files of the device
+ * and reset on the first open and the last close.
+ */
+struct apt_usbtrx_ioctl_rx_wakeup_s {
+	unsigned int min_bytes;
+	unsigned int min_frames;
+	unsigned int timeout_us;
+};
+
+/**
+ * typedef apt_usbtrx_ioctl_rx_wakeup_t - Alias struct apt_usbtrx_ioctl_rx_wakeup_s.
+ */
+typedef struct apt_usbtrx_ioctl_rx_wakeup_s apt_usbtrx_ioctl_rx_wakeup_t;
+
+#define APT_USBTRX_RX_WAKEUP_MAX_TIMEOUT_US (10000000)
+
+/**
+ * struct apt_usbtrx_ioctl_get_rx_queued_s - Received data queued for read()
+ * @frames: Number of whole frames that can be read.
+ * @bytes: Total size of these frames in bytes.
+ *
+ * Like FIONREAD, but also counts the frames. read() always returns whole frames.
+ */
+struct apt_usbtrx_ioctl_get_rx_queued_s {
+	unsigned int frames;
+	unsigned int bytes;
+};
+
+/**
+ * typedef apt_usbtrx_ioctl_get_rx_queued_t - Alias struct apt_usbtrx_ioctl_get_rx_queued_s.
+ */
+typedef struct apt_usbtrx_ioctl_get_rx_queued_s apt_usbtrx_ioctl_get_rx_queued_t;
+
+/**
+ * struct apt_usbtrx_ioctl_rx_overflow_marker_s - RX overflow marker definition
+ * @enable: 1: Insert overflow marker records into the RX stream, 0: Do not insert (default).
+ *
+ * The setting is shared by all open files of the device and reset on the first open and the last close.
+ */
+struct apt_usbtrx_ioctl_rx_overflow_marker_s {
+	int enable;
+};
+
+/**
+ * typedef apt_usbtrx_ioctl_rx_overflow_marker_t - Alias struct apt_usbtrx_ioctl_rx_overflow_marker_s.
+ */
+typedef struct apt_usbtrx_ioctl_rx_overflow_marker_s apt_usbtrx_ioctl_rx_overflow_marker_t;
+
+#define APT_USBTRX_RX_OVERFLOW_MARKER (0xFFFFFFFF)
+
+/**
+ * struct apt_usbtrx_rx_overflow_marker_s - Overflow marker record in the RX stream.
+ * @ts_sec: Always 0.
+ * @ts_usec: Always APT_USBTRX_RX_OVERFLOW_MARKER, never a valid usec of a received frame.
+ * @frames: Number of frames dropped at this point of the stream, because the RX ring was full.
+ * @bytes: Total size of the dropped frames in bytes.
+ * @first_ts_sec: Timestamp (sec) of the first dropped frame.
+ * @first_ts_usec: Timestamp (usec) of the first dropped frame.
+ * @last_ts_sec: Timestamp (sec) of the last dropped frame.
+ * @last_ts_usec: Timestamp (usec) of the last dropped frame.
+ *
+ * Every received frame starts with its timestamp, so a marker is told apart by @ts_usec.
+ * The timestamps follow the timestamp mode, like the timestamps of received frames.
+ */
+struct apt_usbtrx_rx_overflow_marker_s {
+	unsigned int ts_sec;
+	unsigned int ts_usec;
+	unsigned int frames;
+	unsigned int bytes;
+	unsigned int first_ts_sec;
+	unsigned int first_ts_usec;
+	unsigned int last_ts_sec;
+	unsigned int last_ts_usec;
+};
+
+/**
+ * typedef apt_usbtrx_rx_overflow_marker_t - Alias struct apt_usbtrx_rx_overflow_marker_s.
+ */
+typedef struct apt_usbtrx_rx_overflow_marker_s apt_usbtrx_rx_overflow_marker_t;
+
+/**
+ * struct apt_usbtrx_ioctl_rx_capture_s - RX capture (flight recorder) definition
+ * @mode: [IN/OUT] RX ring mode, see APT_USBTRX_RX_CAPTURE_MODE.
+ * @post_frames: [IN/OUT] Frames stored after the trigger before the RX ring is frozen.
+ *               (@post_frames + 1) frames of the maximum size must fit into the RX ring.
+ *               The frame that matched @can_id is not counted.
+ * @can_id_enable: [IN/OUT] 1: Also trigger on a received CAN frame matching @can_id and @can_mask, 0: Do not.
+ * @can_id: [IN/OUT] CAN ID, with CAN_EFF_FLAG, CAN_RTR_FLAG and CAN_ERR_FLAG like struct can_filter.
+ * @can_mask: [IN/OUT] A frame matches if (frame id & @can_mask) == (@can_id & @can_mask).
+ * @state: [OUT] Capture state, see APT_USBTRX_RX_CAPTURE_STATE. Ignored on input.
+ *
+ * Setting APT_USBTRX_RX_CAPTURE_MODE_FLIGHT_RECORDER discards the RX ring and arms the capture.
+ * The setting is shared by all open files of the device and reset on the first open and the last close.
+ */
+struct apt_usbtrx_ioctl_rx_capture_s {
+	int mode;
+	unsigned int post_frames;
+	int can_id_enable;
+	unsigned int can_id;
+	unsigned int can_mask;
+	int state;
+};
+
+/**
+ * typedef apt_usbtrx_ioctl_rx_capture_t - Alias struct apt_usbtrx_ioctl_rx_capture_s.
+ */
+typedef struct apt_usbtrx_ioctl_rx_capture_s apt_usbtrx_ioctl_rx_capture_t;
+
 /**
  * struct apt_usbtrx_ioctl_get_timestamp_mode_s - Timestamping definition
  * @timestamp_mode: How to timestamp receiving data, see APT_USBTRX_TIMESTAMP_MODE.
@@ -201,17 +319,74 @@ struct apt_usbtrx_ioctl_get_firmware_size_s {
  */
 typedef struct apt_usbtrx_ioctl_get_firmware_size_s apt_usbtrx_ioctl_get_firmware_size_t;
 
+#define APT_USBTRX_MMAP_CACHELINE_SIZE (64)
+
+/**
+ * struct apt_usbtrx_mmap_ctrl_s - Control page shared with the mmap'ed RX ring.
+ * @head: Producer index in bytes. Free-running, updated by the driver only.
+ * @tail: Consumer index in bytes. Free-running, updated by the reader only.
+ * @buffer_size: Ring data size in bytes, always a power of two.
+ * @data_offset: Offset of the ring data from the start of the mapping.
+ *
+ * The control page is the first page of the mapping and the ring data follows
+ * at @data_offset. The bytes between @tail and @head are readable at
+ * (@tail & (@buffer_size - 1)), wrapping to the start of the ring data.
+ * Readers must load @head with acquire semantics and store @tail with release
+ * semantics after consuming the data.
+ */
+struct apt_usbtrx_mmap_ctrl_s {
+	unsigned int head;
+	unsigned char reserved1[APT_USBTRX_MMAP_CACHELINE_SIZE - sizeof(unsigned int)];
+	unsigned int tail;
+	unsigned char reserved2[APT_USBTRX_MMAP_CACHELINE_SIZE - sizeof(unsigned int)];
+	unsigned int buffer_size;
+	unsigned int data_offset;
+};
+
+/**
+ * typedef apt_usbtrx_mmap_ctrl_t - Alias struct apt_usbtrx_mmap_ctrl_s.
+ */
+typedef struct apt_usbtrx_mmap_ctrl_s apt_usbtrx_mmap_ctrl_t;
+
 /**
  * enum APT_USBTRX_TIMESTAMP_MODE - Timestamp mode
  * @APT_USBTRX_TIMESTAMP_MODE_DEVICE: Use device to timestamping.
  * @APT_USBTRX_TIMESTAMP_MODE_HOST: Use host to timestamping.
+ * @APT_USBTRX_TIMESTAMP_MODE_HOST_CORRECTED: Use device timestamp translated to the host clock
+ *                                           with the estimated offset and drift.
  */
 enum APT_USBTRX_TIMESTAMP_MODE {
 	APT_USBTRX_TIMESTAMP_MODE_DEVICE = 0,
 	APT_USBTRX_TIMESTAMP_MODE_HOST,
+	APT_USBTRX_TIMESTAMP_MODE_HOST_CORRECTED,
 	APT_USBTRX_TIMESTAMP_MODE_MAX
 };
 
+/**
+ * enum APT_USBTRX_RX_CAPTURE_MODE - RX ring mode
+ * @APT_USBTRX_RX_CAPTURE_MODE_STREAM: Drop the newest frames when the RX ring is full.
+ * @APT_USBTRX_RX_CAPTURE_MODE_FLIGHT_RECORDER: Overwrite the oldest frames until triggered, then freeze the RX ring.
+ */
+enum APT_USBTRX_RX_CAPTURE_MODE {
+	APT_USBTRX_RX_CAPTURE_MODE_STREAM = 0,
+	APT_USBTRX_RX_CAPTURE_MODE_FLIGHT_RECORDER,
+	APT_USBTRX_RX_CAPTURE_MODE_MAX
+};
+
+/**
+ * enum APT_USBTRX_RX_CAPTURE_STATE - RX capture state
+ * @APT_USBTRX_RX_CAPTURE_STATE_IDLE: Stream mode.
+ * @APT_USBTRX_RX_CAPTURE_STATE_ARMED: Recording, waiting for the trigger. read() blocks.
+ * @APT_USBTRX_RX_CAPTURE_STATE_TRIGGERED: Recording the post-trigger frames. read() blocks.
+ * @APT_USBTRX_RX_CAPTURE_STATE_FROZEN: The RX ring is frozen and can be drained, newer frames are dropped.
+ */
+enum APT_USBTRX_RX_CAPTURE_STATE {
+	APT_USBTRX_RX_CAPTURE_STATE_IDLE = 0,
+	APT_USBTRX_RX_CAPTURE_STATE_ARMED,
+	APT_USBTRX_RX_CAPTURE_STATE_TRIGGERED,
+	APT_USBTRX_RX_CAPTURE_STATE_FROZEN,
+};
+
 /**
  * enum APT_USBTRX_SYNC_PULSE - Synchronization pulse status
  * @APT_USBTRX_SYNC_PULSE_SOURCE: Use own clock and provide synchronization pulse to other devices.
@@ -602,6 +777,49 @@ struct ep1_cf02a_ioctl_store_max_duration_s {
 typedef struct ep1_cf02a_ioctl_store_max_duration_s ep1_cf02a_ioctl_get_store_max_duration_t;
 typedef struct ep1_cf02a_ioctl_store_max_duration_s ep1_cf02a_ioctl_set_store_max_duration_t;
 
+#define EP1_CF02A_CONFIG_SILENT_MODE (1U << 0)
+#define EP1_CF02A_CONFIG_FD_MODE (1U << 1)
+#define EP1_CF02A_CONFIG_ISO_MODE (1U << 2)
+#define EP1_CF02A_CONFIG_BITRATE (1U << 3)
+#define EP1_CF02A_CONFIG_DATA_BITRATE (1U << 4)
+#define EP1_CF02A_CONFIG_BIT_TIMING (1U << 5)
+#define EP1_CF02A_CONFIG_DATA_BIT_TIMING (1U << 6)
+#define EP1_CF02A_CONFIG_STORE_ENABLE (1U << 7)
+#define EP1_CF02A_CONFIG_STORE_MAX_DURATION (1U << 8)
+#define EP1_CF02A_CONFIG_TX_RX_CONTROL (1U << 9)
+#define EP1_CF02A_CONFIG_ALL ((1U << 10) - 1)
+
+/**
+ * struct ep1_cf02a_ioctl_apply_config_s - Batch configuration definition.
+ * @mask: [IN] Fields to apply (EP1_CF02A_CONFIG_*), the other fields are ignored.
+ * @silent: [IN] Same as EP1_CF02A_IOCTL_SET_SILENT_MODE.
+ * @fd: [IN] Same as EP1_CF02A_IOCTL_SET_FD_MODE.
+ * @non_iso_mode: [IN] Same as EP1_CF02A_IOCTL_SET_ISO_MODE.
+ * @bitrate: [IN] Same as EP1_CF02A_IOCTL_SET_BITRATE. Exclusive with @bit_timing.
+ * @data_bitrate: [IN] Same as EP1_CF02A_IOCTL_SET_DATA_BITRATE. Exclusive with @data_bit_timing.
+ * @bit_timing: [IN] Same as EP1_CF02A_IOCTL_SET_BIT_TIMING.
+ * @data_bit_timing: [IN] Same as EP1_CF02A_IOCTL_SET_DATA_BIT_TIMING.
+ * @store_enable: [IN] Same as EP1_CF02A_IOCTL_SET_STORE_ENABLE.
+ * @store_max_duration: [IN] Same as EP1_CF02A_IOCTL_SET_STORE_MAX_DURATION.
+ * @start: [IN] Same as EP1_CF02A_IOCTL_SET_TX_RX_CONTROL, applied after all other fields.
+ * @failed: [OUT] Fields rejected by the device (EP1_CF02A_CONFIG_*), 0 on success.
+ */
+struct ep1_cf02a_ioctl_apply_config_s {
+	unsigned int mask;
+	bool silent;
+	bool fd;
+	bool non_iso_mode;
+	ep1_cf02a_ioctl_set_bitrate_t bitrate;
+	ep1_cf02a_ioctl_set_data_bitrate_t data_bitrate;
+	ep1_cf02a_ioctl_set_bit_timing_t bit_timing;
+	ep1_cf02a_ioctl_set_data_bit_timing_t data_bit_timing;
+	bool store_enable;
+	unsigned int store_max_duration;
+	bool start;
+	unsigned int failed;
+};
+typedef struct ep1_cf02a_ioctl_apply_config_s ep1_cf02a_ioctl_apply_config_t;
+
 /* ----------------------------------------------------------- */
 /* ------------------------ EP1-AG08A ------------------------ */
 /* ----------------------------------------------------------- */
@@ -833,5 +1051,15 @@ typedef ep1_ag08a_ioctl_analog_output_t pa_agu081_ioctl_analog_output_t;
 #define EP1_CF02A_IOCTL_SET_STORE_ENABLE _IOW(APT_USBTRX_IOC_TYPE, 0x4f, ep1_cf02a_ioctl_set_store_enable_t)
 #define EP1_CF02A_IOCTL_GET_STORE_MAX_DURATION _IOR(APT_USBTRX_IOC_TYPE, 0x50, ep1_cf02a_ioctl_get_store_max_duration_t)
 #define EP1_CF02A_IOCTL_SET_STORE_MAX_DURATION _IOW(APT_USBTRX_IOC_TYPE, 0x51, ep1_cf02a_ioctl_set_store_max_duration_t)
+#define EP1_CF02A_IOCTL_APPLY_CONFIG _IOWR(APT_USBTRX_IOC_TYPE, 0x52, ep1_cf02a_ioctl_apply_config_t)
+
+#define APT_USBTRX_IOCTL_SET_RX_WAKEUP _IOW(APT_USBTRX_IOC_TYPE, 0x53, apt_usbtrx_ioctl_rx_wakeup_t)
+#define APT_USBTRX_IOCTL_GET_RX_WAKEUP _IOR(APT_USBTRX_IOC_TYPE, 0x54, apt_usbtrx_ioctl_rx_wakeup_t)
+#define APT_USBTRX_IOCTL_GET_RX_QUEUED _IOR(APT_USBTRX_IOC_TYPE, 0x55, apt_usbtrx_ioctl_get_rx_queued_t)
+#define APT_USBTRX_IOCTL_SET_RX_OVERFLOW_MARKER _IOW(APT_USBTRX_IOC_TYPE, 0x56, apt_usbtrx_ioctl_rx_overflow_marker_t)
+#define APT_USBTRX_IOCTL_GET_RX_OVERFLOW_MARKER _IOR(APT_USBTRX_IOC_TYPE, 0x57, apt_usbtrx_ioctl_rx_overflow_marker_t)
+#define APT_USBTRX_IOCTL_SET_RX_CAPTURE _IOW(APT_USBTRX_IOC_TYPE, 0x58, apt_usbtrx_ioctl_rx_capture_t)
+#define APT_USBTRX_IOCTL_GET_RX_CAPTURE _IOR(APT_USBTRX_IOC_TYPE, 0x59, apt_usbtrx_ioctl_rx_capture_t)
+#define APT_USBTRX_IOCTL_TRIGGER_RX_CAPTURE _IO(APT_USBTRX_IOC_TYPE, 0x5a)
 
 #endif /* __APT_USBTRX_FOPS_DEF_H__ */
@@ -12,6 +12,7 @@
 #include <linux/usb.h>
 #include <linux/slab.h>
 #include <linux/kthread.h>
+#include <linux/delay.h>
 
 #include "version.h"
 #include "apt_usbtrx_def.h"
@@ -20,6 +21,7 @@
 #include "apt_usbtrx_core.h"
 #include "apt_usbtrx_sysfs.h"
 #include "apt_usbtrx_ioctl.h"
+#include "apt_usbtrx_ptp.h"
 
 #include "ap_ct2a/ap_ct2a.h"
 #include "ep1_ch02a/ep1_ch02a.h"
@@ -37,7 +39,9 @@ static struct timespec64 g_resettime;
 static const struct file_operations apt_usbtrx_fops = {
 	.owner = THIS_MODULE,
 	.read = apt_usbtrx_read,
-	.write = apt_usbtrx_write,
+	.write_iter = apt_usbtrx_write_iter,
+	.poll = apt_usbtrx_poll,
+	.mmap = apt_usbtrx_mmap,
 	.open = apt_usbtrx_open,
 	.release = apt_usbtrx_release,
 	.unlocked_ioctl = apt_usbtrx_ioctl,
@@ -102,7 +106,7 @@ bool apt_usbtrx_is_dfu(struct usb_interface *intf)
 	return iface_desc->desc.bInterfaceClass == 0xFF && iface_desc->desc.bInterfaceSubClass == 1;
 }
 
-STATIC void apt_usntrx_write_bulk_callback_null(struct urb *urb)
+STATIC void apt_usntrx_write_bulk_callback_null(apt_usbtrx_dev_t *dev, int msg_count, int status)
 {
 	return;
 }
@@ -123,16 +127,16 @@ STATIC int apt_usbtrx_init_function(struct usb_interface *intf, apt_usbtrx_dev_t
 		dev->model_name[sizeof(dev->model_name) - 1] = '\0';
 		dev->device_type = APT_USBTRX_DEVICE_TYPE_CAN;
 		dev->rx_data_size = AP_CT2A_RXDATA_BUFFER_SIZE;
+		dev->tx_data_size = APT_USBTRX_TXDATA_BUFFER_SIZE;
 		dev->unique_func = (apt_usbtrx_device_unique_function_t){
 			.init_data = apt_usbtrx_unique_can_init_data,
 			.free_data = apt_usbtrx_unique_can_free_data,
 			.init = apt_usbtrx_unique_can_init,
 			.terminate = apt_usbtrx_unique_can_terminate,
 			.is_need_init_reset_ts = apt_usbtrx_unique_can_is_need_init_reset_ts,
-			.dispatch_msg = apt_usbtrx_unique_can_dispatch_msg,
+			.msg_table = apt_usbtrx_unique_can_msg_table,
 			.get_read_payload_size = apt_usbtrx_unique_can_get_read_payload_size,
 			.get_write_payload_size = apt_usbtrx_unique_can_get_write_payload_size,
-			.get_read_payload_timestamp = apt_usbtrx_unique_can_get_read_payload_timestamp,
 			.get_write_cmd_id = apt_usbtrx_unique_can_get_write_cmd_id,
 			.get_fw_size = apt_usbtrx_unique_can_get_fw_size,
 			.is_device_input_start = apt_usbtrx_unique_can_is_device_input_start,
@@ -149,16 +153,16 @@ STATIC int apt_usbtrx_init_function(struct usb_interface *intf, apt_usbtrx_dev_t
 		dev->model_name[sizeof(dev->model_name) - 1] = '\0';
 		dev->device_type = APT_USBTRX_DEVICE_TYPE_CAN;
 		dev->rx_data_size = AP_CT2A_RXDATA_BUFFER_SIZE;
+		dev->tx_data_size = APT_USBTRX_TXDATA_BUFFER_SIZE;
 		dev->unique_func = (apt_usbtrx_device_unique_function_t){
 			.init_data = apt_usbtrx_unique_can_init_data,
 			.free_data = apt_usbtrx_unique_can_free_data,
 			.init = ep1_ch02a_init,
 			.terminate = ep1_ch02a_terminate,
 			.is_need_init_reset_ts = apt_usbtrx_unique_can_is_need_init_reset_ts,
-			.dispatch_msg = ep1_ch02a_dispatch_msg,
+			.msg_table = ep1_ch02a_msg_table,
 			.get_read_payload_size = apt_usbtrx_unique_can_get_read_payload_size,
 			.get_write_payload_size = apt_usbtrx_unique_can_get_write_payload_size,
-			.get_read_payload_timestamp = apt_usbtrx_unique_can_get_read_payload_timestamp,
 			.get_write_cmd_id = apt_usbtrx_unique_can_get_write_cmd_id,
 			.get_fw_size = apt_usbtrx_unique_can_get_fw_size,
 			.is_device_input_start = apt_usbtrx_unique_can_is_device_input_start,
@@ -175,16 +179,16 @@ STATIC int apt_usbtrx_init_function(struct usb_interface *intf, apt_usbtrx_dev_t
 		dev->model_name[sizeof(dev->model_name) - 1] = '\0';
 		dev->device_type = APT_USBTRX_DEVICE_TYPE_CAN_FD;
 		dev->rx_data_size = EP1_CF02A_RXDATA_BUFFER_SIZE;
+		dev->tx_data_size = APT_USBTRX_TXDATA_BUFFER_SIZE;
 		dev->unique_func = (apt_usbtrx_device_unique_function_t){
 			.init_data = ep1_cf02a_init_data,
 			.free_data = ep1_cf02a_free_data,
 			.init = ep1_cf02a_init,
 			.terminate = ep1_cf02a_terminate,
 			.is_need_init_reset_ts = ep1_cf02a_is_need_init_reset_ts,
-			.dispatch_msg = ep1_cf02a_dispatch_msg,
+			.msg_table = ep1_cf02a_msg_table,
 			.get_read_payload_size = ep1_cf02a_get_read_payload_size,
 			.get_write_payload_size = ep1_cf02a_get_write_payload_size,
-			.get_read_payload_timestamp = ep1_cf02a_get_read_payload_timestamp,
 			.get_write_cmd_id = ep1_cf02a_get_write_cmd_id,
 			.get_fw_size = ep1_cf02a_get_fw_size,
 			.is_device_input_start = ep1_cf02a_is_device_start,
@@ -201,16 +205,16 @@ STATIC int apt_usbtrx_init_function(struct usb_interface *intf, apt_usbtrx_dev_t
 		dev->model_name[sizeof(dev->model_name) - 1] = '\0';
 		dev->device_type = APT_USBTRX_DEVICE_TYPE_ANALOG;
 		dev->rx_data_size = EP1_AG08A_RXDATA_BUFFER_SIZE;
+		dev->tx_data_size = EP1_AG08A_TXDATA_BUFFER_SIZE;
 		dev->unique_func = (apt_usbtrx_device_unique_function_t){
 			.init_data = ep1_ag08a_init_data,
 			.free_data = ep1_ag08a_free_data,
 			.init = ep1_ag08a_init,
 			.terminate = ep1_ag08a_terminate,
 			.is_need_init_reset_ts = ep1_ag08a_is_need_init_reset_ts,
-			.dispatch_msg = ep1_ag08a_dispatch_msg,
+			.msg_table = ep1_ag08a_msg_table,
 			.get_read_payload_size = ep1_ag08a_get_read_payload_size,
 			.get_write_payload_size = ep1_ag08a_get_write_payload_size,
-			.get_read_payload_timestamp = ep1_ag08a_get_read_payload_timestamp,
 			.get_write_cmd_id = ep1_ag08a_get_write_cmd_id,
 			.get_fw_size = ep1_ag08a_get_fw_size,
 			.is_device_input_start = ep1_ag08a_is_device_input_start,
@@ -275,15 +279,30 @@ STATIC int apt_usbtrx_init_instance(apt_usbtrx_dev_t *dev)
 	dev->basetime.tv_nsec = 0;
 	atomic_set(&dev->onopening, true);
 	atomic_set(&dev->onclosing, false);
+	init_completion(&dev->init_done);
+	dev->init_result = RESULT_Failure;
 	dev->resettime = &g_resettime;
 	dev->fw_count = 0;
 	sema_init(&dev->send_msg_sem, 1);
+	apt_usbtrx_cmd_engine_init(dev);
 	sema_init(&dev->tx_usb_transfer_sem, MAX_TX_URBS);
+	mutex_init(&dev->tx_data_lock);
 	atomic_set(&dev->tx_data_clear_requested, false);
 	dev->tx_transfer_expired = jiffies;
 	dev->tx_transfer_max_token = 0;
 	dev->tx_transfer_token = 0;
 	dev->tx_thread = NULL;
+	atomic_set(&dev->tx_aggregate, false);
+	dev->tx_aggregate_buffer = NULL;
+	dev->tx_aggregate_buffer_size = 0;
+	memset(dev->tx_urbs, 0, sizeof(dev->tx_urbs));
+	memset(dev->txbuf, 0, sizeof(dev->txbuf));
+	dev->tx_urbs_free = 0;
+	memset(dev->txbuf_msgs, 0, sizeof(dev->txbuf_msgs));
+	dev->echo_skb_max = APT_USBTRX_ECHO_SKB_MAX;
+	memset(&dev->tx_echo, 0, sizeof(dev->tx_echo));
+	dev->tx_echo.max = 1;
+	spin_lock_init(&dev->tx_echo.lock);
 	dev->ch = 0;
 	memset(dev->serial_no, '\0', APT_USBTRX_SERIAL_NO_LENGTH + 1);
 	dev->sync_pulse = APT_USBTRX_SYNC_PULSE_SOURCE;
@@ -293,7 +312,22 @@ STATIC int apt_usbtrx_init_instance(apt_usbtrx_dev_t *dev)
 	atomic_set(&dev->tx_buffer_rate, 0);
 	init_completion(&dev->rx_done);
 	dev->timestamp_mode = APT_USBTRX_TIMESTAMP_MODE_DEVICE;
-	dev->rx_rbmsg = NULL;
+	dev->rx_urb_time_ns = 0;
+	atomic64_set(&dev->rx_resync_count, 0);
+	atomic64_set(&dev->rx_resync_bytes, 0);
+	dev->rx_overflow.enable = false;
+	dev->rx_overflow.frames = 0;
+	dev->rx_overflow.bytes = 0;
+	apt_usbtrx_clock_init(&dev->clock);
+	apt_usbtrx_rx_wakeup_init(dev);
+	apt_usbtrx_rx_capture_init(dev);
+	mutex_init(&dev->data_buffer_lock);
+	dev->data_buffer_users = 0;
+	atomic_set(&dev->rx_data_mapped, 0);
+	mutex_init(&dev->rx_settings_lock);
+	dev->rx_settings_users = 0;
+	dev->ptp_clock = NULL;
+	dev->ptp_offset_us = 0;
 	dev->unique_data = NULL;
 
 	result = dev->unique_func.init_data(dev);
@@ -364,12 +398,11 @@ static int is_support_revision_command(int device_type, int major, int minor)
 }
 
 /*!
- * @brief init
+ * @brief interrogate device
  */
-static int apt_usbtrx_init(struct usb_interface *intf, const struct usb_device_id *id)
+static int apt_usbtrx_init_device(apt_usbtrx_dev_t *dev)
 {
-	apt_usbtrx_dev_t *dev = usb_get_intfdata(intf);
-	const struct usb_host_interface *iface_desc;
+	struct usb_interface *intf = dev->interface;
 	int result;
 	int device_id_size = APT_USBTRX_DEVICE_ID_LENGTH;
 	char device_id[device_id_size];
@@ -379,71 +412,11 @@ static int apt_usbtrx_init(struct usb_interface *intf, const struct usb_device_i
 	int sync_pulse;
 	int retry = 3;
 	bool success;
-	struct timespec64 ts;
-	bool dfu = false;
 
 	CHKMSG("ENTER");
 
-	init_usb_anchor(&dev->rx_submitted);
-	init_usb_anchor(&dev->tx_submitted);
-
-	iface_desc = intf->cur_altsetting;
-	DMSG("%s(): InterfaceClass(0x%02X:0x%02X)", __func__, iface_desc->desc.bInterfaceClass,
-	     iface_desc->desc.bInterfaceSubClass);
-	if (iface_desc->desc.bInterfaceClass == 0xFF) {
-		switch (iface_desc->desc.bInterfaceSubClass) {
-		case 0:
-			result = usb_register_dev(intf, &apt_usbtrx_class);
-			if (result != 0) {
-				EMSG("usb_register_dev().. Error, apt_usbtrx_class");
-				return RESULT_Failure;
-			}
-			dfu = false;
-			break;
-		case 1:
-			result = usb_register_dev(intf, &apt_usbtrx_dfu_class);
-			if (result != 0) {
-				EMSG("usb_register_dev().. Error, apt_usbtrx_dfu_class");
-				return RESULT_Failure;
-			}
-			dfu = true;
-			break;
-		default:
-			EMSG("not support InterfaceClass, (0x%02X:0x%02X)", iface_desc->desc.bInterfaceClass,
-			     iface_desc->desc.bInterfaceSubClass);
-			return RESULT_Failure;
-		}
-	} else {
-		EMSG("not support InterfaceClass, (0x%02X:0x%02X)", iface_desc->desc.bInterfaceClass,
-		     iface_desc->desc.bInterfaceSubClass);
-		return RESULT_Failure;
-	}
-
-	result = apt_usbtrx_ringbuffer_init(&dev->rx_data, dev->rx_data_size);
-	if (result != RESULT_Success) {
-		EMSG("apt_usbtrx_ringbuffer_init().. Error");
-		return RESULT_Failure;
-	}
-
-	result = apt_usbtrx_setup_rx_urbs(dev);
-	if (result != RESULT_Success) {
-		EMSG("apt_usbtrx_setup_rx_urbs().. Error");
-		return RESULT_Failure;
-	}
-
-	/*** set basetime ***/
-	get_ts64(dev, &ts);
-	dev->basetime = ts;
-	IMSG("inittime: %lld.%09ld", (s64)ts.tv_sec, ts.tv_nsec);
-
-	if (dfu == true) {
-		IMSG("DFU mode...");
-		atomic_set(&dev->onopening, false);
-		return RESULT_Success;
-	}
-
 	/*** retry command !! only immediately after plug ***/
-	mdelay(10);
+	msleep(10);
 	do {
 		memset(device_id, 0, device_id_size);
 		result = apt_usbtrx_get_device_id(dev, device_id, device_id_size, &ch);
@@ -495,12 +468,29 @@ static int apt_usbtrx_init(struct usb_interface *intf, const struct usb_device_i
 		IMSG("FW ver.%d.%d", dev->fw_ver.major, dev->fw_ver.minor);
 	}
 
-	result = apt_usbtrx_ringbuffer_init(&dev->tx_data, APT_USBTRX_TXDATA_BUFFER_SIZE);
+	result = apt_usbtrx_ringbuffer_init(&dev->tx_data, dev->tx_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_ringbuffer_init().. Error");
 		return RESULT_Failure;
 	}
 
+	/* multiple of wMaxPacketSize, large enough for one maximum message */
+	dev->tx_aggregate_buffer_size = usb_endpoint_maxp(dev->bulk_out) * APT_USBTRX_TX_AGGREGATE_PACKETS;
+	if (dev->tx_aggregate_buffer_size < APT_USBTRX_CMD_MAX_LENGTH) {
+		dev->tx_aggregate_buffer_size = roundup(APT_USBTRX_CMD_MAX_LENGTH, usb_endpoint_maxp(dev->bulk_out));
+	}
+	dev->tx_aggregate_buffer = kzalloc(dev->tx_aggregate_buffer_size, GFP_KERNEL);
+	if (dev->tx_aggregate_buffer == NULL) {
+		EMSG("kzalloc().. Error, <size:%zu>", dev->tx_aggregate_buffer_size);
+		return RESULT_Failure;
+	}
+
+	result = apt_usbtrx_alloc_tx_urbs(dev);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_alloc_tx_urbs().. Error");
+		return RESULT_Failure;
+	}
+
 	dev->tx_thread = kthread_run(apt_usbtrx_tx_thread_func, dev, "apt_tx_thread");
 	if (dev->tx_thread == NULL) {
 		EMSG("kthread_run().. Error");
@@ -532,7 +522,13 @@ static int apt_usbtrx_init(struct usb_interface *intf, const struct usb_device_i
 		}
 	}
 
-	result = dev->unique_func.init(intf, id);
+	/* register before the unique init, netdevs report the clock index */
+	result = apt_usbtrx_ptp_register(dev);
+	if (result != RESULT_Success) {
+		WMSG("apt_usbtrx_ptp_register().. Error");
+	}
+
+	result = dev->unique_func.init(intf, dev->init_id);
 	if (result != RESULT_Success) {
 		EMSG("init().. Error");
 		return RESULT_Failure;
@@ -544,6 +540,118 @@ static int apt_usbtrx_init(struct usb_interface *intf, const struct usb_device_i
 	return RESULT_Success;
 }
 
+/*!
+ * @brief device interrogation work
+ * NOTE: Runs the command sequence of probe in the background, so that devices behind
+ *       one hub come up concurrently. open() waits for init_done.
+ */
+static void apt_usbtrx_init_work_func(struct work_struct *work)
+{
+	apt_usbtrx_dev_t *dev = container_of(work, apt_usbtrx_dev_t, init_work);
+	int result;
+
+	result = apt_usbtrx_init_device(dev);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_init_device().. Error, device is not available, <minor:%d>", dev->interface->minor);
+	} else {
+		/* let udev apply the rules again, the unique sysfs attributes exist now */
+		kobject_uevent(&dev->interface->usb_dev->kobj, KOBJ_CHANGE);
+	}
+
+	dev->init_result = result;
+	complete_all(&dev->init_done);
+}
+
+/*!
+ * @brief init
+ */
+static int apt_usbtrx_init(struct usb_interface *intf, const struct usb_device_id *id)
+{
+	apt_usbtrx_dev_t *dev = usb_get_intfdata(intf);
+	const struct usb_host_interface *iface_desc;
+	int result;
+	struct timespec64 ts;
+	bool dfu = false;
+
+	CHKMSG("ENTER");
+
+	init_usb_anchor(&dev->rx_submitted);
+	init_usb_anchor(&dev->tx_submitted);
+
+	iface_desc = intf->cur_altsetting;
+	DMSG("%s(): InterfaceClass(0x%02X:0x%02X)", __func__, iface_desc->desc.bInterfaceClass,
+	     iface_desc->desc.bInterfaceSubClass);
+	if (iface_desc->desc.bInterfaceClass == 0xFF) {
+		switch (iface_desc->desc.bInterfaceSubClass) {
+		case 0:
+			result = usb_register_dev(intf, &apt_usbtrx_class);
+			if (result != 0) {
+				EMSG("usb_register_dev().. Error, apt_usbtrx_class");
+				return RESULT_Failure;
+			}
+			dfu = false;
+			break;
+		case 1:
+			result = usb_register_dev(intf, &apt_usbtrx_dfu_class);
+			if (result != 0) {
+				EMSG("usb_register_dev().. Error, apt_usbtrx_dfu_class");
+				return RESULT_Failure;
+			}
+			dfu = true;
+			break;
+		default:
+			EMSG("not support InterfaceClass, (0x%02X:0x%02X)", iface_desc->desc.bInterfaceClass,
+			     iface_desc->desc.bInterfaceSubClass);
+			return RESULT_Failure;
+		}
+	} else {
+		EMSG("not support InterfaceClass, (0x%02X:0x%02X)", iface_desc->desc.bInterfaceClass,
+		     iface_desc->desc.bInterfaceSubClass);
+		return RESULT_Failure;
+	}
+
+	result = apt_usbtrx_ringbuffer_init(&dev->rx_data, dev->rx_data_size);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_ringbuffer_init().. Error");
+		return RESULT_Failure;
+	}
+
+	result = apt_usbtrx_setup_rx_urbs(dev);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_setup_rx_urbs().. Error");
+		return RESULT_Failure;
+	}
+
+	/*** set basetime ***/
+	get_ts64(dev, &ts);
+	dev->basetime = ts;
+	IMSG("inittime: %lld.%09ld", (s64)ts.tv_sec, ts.tv_nsec);
+
+	if (dfu == true) {
+		IMSG("DFU mode...");
+
+		/* firmware data is sent straight from the tx urb pool, one chunk per urb */
+		dev->tx_aggregate_buffer_size = APT_USBTRX_CMD_LENGTH_SEND_FW_DATA;
+		result = apt_usbtrx_alloc_tx_urbs(dev);
+		if (result != RESULT_Success) {
+			EMSG("apt_usbtrx_alloc_tx_urbs().. Error");
+			return RESULT_Failure;
+		}
+
+		atomic_set(&dev->onopening, false);
+		dev->init_result = RESULT_Success;
+		complete_all(&dev->init_done);
+		return RESULT_Success;
+	}
+
+	/* interrogate the device in the background, see apt_usbtrx_init_work_func() */
+	dev->init_id = id;
+	queue_work(system_unbound_wq, &dev->init_work);
+
+	CHKMSG("LEAVE");
+	return RESULT_Success;
+}
+
 /*!
  * @brief terminate
  */
@@ -573,12 +681,17 @@ static int apt_usbtrx_term(struct usb_interface *intf)
 	if (result != RESULT_Success) {
 		EMSG("terminate().. Error");
 	}
+	apt_usbtrx_ptp_unregister(dev);
 
 	atomic_set(&dev->onclosing, true);
 	atomic_set(&dev->rx_ongoing, false);
+	apt_usbtrx_cmd_abort_all(dev);
 
 	wake_up_interruptible(&dev->rx_data.wq);
 	wait_for_completion_interruptible_timeout(&dev->rx_done, msecs_to_jiffies(100));
+
+	/* wait for a resize in progress, later ones see onclosing */
+	mutex_lock(&dev->data_buffer_lock);
 	if (dfu == false) {
 		if (dev->tx_thread != NULL) {
 			wake_up_interruptible(&dev->tx_data.wq);
@@ -587,7 +700,10 @@ static int apt_usbtrx_term(struct usb_interface *intf)
 	}
 
 	usb_kill_anchored_urbs(&dev->rx_submitted);
+	/* the rx urb callbacks arm the wakeup timer, cancel it once they are gone */
+	hrtimer_cancel(&dev->rx_wakeup.timer);
 	usb_kill_anchored_urbs(&dev->tx_submitted);
+	apt_usbtrx_free_tx_urbs(dev);
 
 	for (idx = 0; idx < MAX_RX_URBS; idx++) {
 		if (dev->rxbuf[idx] != NULL) {
@@ -605,6 +721,10 @@ static int apt_usbtrx_term(struct usb_interface *intf)
 		if (result != RESULT_Success) {
 			WMSG("apt_usbtrx_ringbuffer_term().. Error");
 		}
+	}
+	mutex_unlock(&dev->data_buffer_lock);
+
+	if (dfu == false) {
 		usb_deregister_dev(intf, &apt_usbtrx_class);
 	} else {
 		usb_deregister_dev(intf, &apt_usbtrx_dfu_class);
@@ -616,8 +736,8 @@ static int apt_usbtrx_term(struct usb_interface *intf)
 	if (dev->rx_complete.buffer != NULL) {
 		kfree(dev->rx_complete.buffer);
 	}
-	if (dev->rx_rbmsg != NULL) {
-		kfree(dev->rx_rbmsg);
+	if (dev->tx_aggregate_buffer != NULL) {
+		kfree(dev->tx_aggregate_buffer);
 	}
 	result = dev->unique_func.free_data(dev);
 	if (result != RESULT_Success) {
@@ -674,12 +794,6 @@ static int apt_usbtrx_probe(struct usb_interface *intf, const struct usb_device_
 		goto error;
 	}
 
-	dev->rx_rbmsg = kzalloc(dev->rx_data_size, GFP_KERNEL);
-	if (dev->rx_rbmsg == NULL) {
-		EMSG("kzalloc().. Error, <size:%zu>", dev->rx_data_size);
-		goto error;
-	}
-
 	result = apt_usbtrx_get_endpoints(intf, &dev->bulk_in, &dev->bulk_out);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_get_endponts().. Error");
@@ -689,6 +803,7 @@ static int apt_usbtrx_probe(struct usb_interface *intf, const struct usb_device_
 	dev->udev = interface_to_usbdev(intf);
 	dev->interface = intf;
 	usb_set_intfdata(intf, dev);
+	INIT_WORK(&dev->init_work, apt_usbtrx_init_work_func);
 
 	result = apt_usbtrx_init(intf, id);
 	if (result != RESULT_Success) {
@@ -737,6 +852,10 @@ static void apt_usbtrx_disconnect(struct usb_interface *intf)
 		return;
 	}
 
+	/* wait for the device interrogation, open() waiting for it fails with onclosing */
+	cancel_work_sync(&dev->init_work);
+	complete_all(&dev->init_done);
+
 	result = apt_usbtrx_term(intf);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_term().. Error");
@@ -7,15 +7,17 @@
  */
 
 #include <linux/slab.h>
+#include <linux/string.h>
 
 #include "apt_usbtrx_def.h"
 #include "apt_usbtrx_msg.h"
 
 /*!
- * @brief parse
+ * @brief parse without copying the payload
+ * NOTE: msg->payload points into data, it is valid as long as data is.
  * @note Use *MSG_RL() in this function to avoid hangs.
  */
-int apt_usbtrx_msg_parse(u8 *data, int data_size, apt_usbtrx_msg_t *msg)
+int apt_usbtrx_msg_parse_view(u8 *data, int data_size, apt_usbtrx_msg_view_t *msg)
 {
 	u8 sob;
 	u8 length;
@@ -72,7 +74,7 @@ int apt_usbtrx_msg_parse(u8 *data, int data_size, apt_usbtrx_msg_t *msg)
 		EMSG_RL("length is over max payload size, <payload_size:%d>", payload_size);
 		return RESULT_Failure;
 	}
-	memcpy(msg->payload, &data[n], payload_size);
+	msg->payload = &data[n];
 	n = n + payload_size;
 
 	eob = data[n];
@@ -88,6 +90,68 @@ int apt_usbtrx_msg_parse(u8 *data, int data_size, apt_usbtrx_msg_t *msg)
 	return RESULT_Success;
 }
 
+/*!
+ * @brief parse
+ * @note Use *MSG_RL() in this function to avoid hangs.
+ */
+int apt_usbtrx_msg_parse(u8 *data, int data_size, apt_usbtrx_msg_t *msg)
+{
+	apt_usbtrx_msg_view_t view;
+	int result;
+
+	if (msg == NULL) {
+		EMSG_RL("msg is NULL");
+		return RESULT_Failure;
+	}
+
+	result = apt_usbtrx_msg_parse_view(data, data_size, &view);
+	if (result != RESULT_Success) {
+		return result;
+	}
+
+	memcpy(msg->payload, view.payload, view.payload_size);
+	msg->id = view.id;
+	msg->payload_size = view.payload_size;
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief find the next message start after a parse error
+ * NOTE: data[0] is the byte that failed to parse. SOB candidates are located with memchr(),
+ *       a candidate is skipped unless its length is valid and, if complete, it ends with EOB.
+ *       An incomplete candidate is kept, the rest of the message may be in the next transfer.
+ * @return number of bytes to discard (data_size if no candidate found)
+ */
+int apt_usbtrx_msg_resync(const u8 *data, int data_size)
+{
+	const u8 *p = data + 1;
+	const u8 *end = data + data_size;
+
+	while (p < end) {
+		int remain;
+		u8 length;
+
+		p = memchr(p, APT_USBTRX_MSG_SOB, end - p);
+		if (p == NULL) {
+			break;
+		}
+
+		remain = end - p;
+		if (remain < 2) {
+			return p - data;
+		}
+		length = p[1];
+		if (length >= APT_USBTRX_CMD_MIN_LENGTH && length <= APT_USBTRX_CMD_MAX_LENGTH &&
+		    (length > remain || p[length - 1] == APT_USBTRX_MSG_EOB)) {
+			return p - data;
+		}
+		p++;
+	}
+
+	return data_size;
+}
+
 /*!
  * @brief pack
  */
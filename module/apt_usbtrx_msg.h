@@ -34,11 +34,31 @@ struct apt_usbtrx_msg_s {
 };
 typedef struct apt_usbtrx_msg_s apt_usbtrx_msg_t;
 
+/*!
+ * @brief msg view structure (payload points into the parsed data, not copied)
+ */
+struct apt_usbtrx_msg_view_s {
+	u8 id;
+	u8 payload_size;
+	u8 *payload;
+};
+typedef struct apt_usbtrx_msg_view_s apt_usbtrx_msg_view_t;
+
 /*!
  * @brief parse
  */
 int apt_usbtrx_msg_parse(u8 *data, int data_size, apt_usbtrx_msg_t *msg);
 
+/*!
+ * @brief parse without copying the payload
+ */
+int apt_usbtrx_msg_parse_view(u8 *data, int data_size, apt_usbtrx_msg_view_t *msg);
+
+/*!
+ * @brief find the next message start after a parse error
+ */
+int apt_usbtrx_msg_resync(const u8 *data, int data_size);
+
 /*!
  * @brief pack
  */
@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Device driver for sending and receiving data to and from
+ * EDGEPLANT USB peripherals.
+ *
+ * Copyright (C) 2018 aptpod Inc.
+ */
+
+#include <linux/kernel.h>
+#include <linux/net_tstamp.h>
+#include <linux/ptp_clock_kernel.h>
+
+#include "apt_usbtrx_ptp.h"
+#include "apt_usbtrx_clock.h"
+
+#if IS_ENABLED(CONFIG_PTP_1588_CLOCK)
+/*!
+ * @brief get time (ptp clock operation)
+ * NOTE: The device counter can not be read directly, the current device time is
+ *       derived from the host clock with the clock estimator.
+ */
+static int apt_usbtrx_ptp_gettime64(struct ptp_clock_info *info, struct timespec64 *ts)
+{
+	apt_usbtrx_dev_t *dev = container_of(info, apt_usbtrx_dev_t, ptp_info);
+	s64 host_us = div_u64(apt_usbtrx_get_relative_time_ns(dev, &dev->basetime), NSEC_PER_USEC);
+	s64 dev_us;
+
+	if (apt_usbtrx_clock_translate_to_device(&dev->clock, host_us, &dev_us) != true) {
+		return -EAGAIN;
+	}
+
+	*ts = ns_to_timespec64((dev_us - READ_ONCE(dev->ptp_offset_us)) * NSEC_PER_USEC);
+
+	return 0;
+}
+
+/*!
+ * @brief set time (ptp clock operation)
+ * NOTE: The device clock can only be reset by APT_USBTRX_IOCTL_RESET_TS.
+ */
+static int apt_usbtrx_ptp_settime64(struct ptp_clock_info *info, const struct timespec64 *ts)
+{
+	return -EOPNOTSUPP;
+}
+
+/*!
+ * @brief adjust time (ptp clock operation)
+ */
+static int apt_usbtrx_ptp_adjtime(struct ptp_clock_info *info, s64 delta)
+{
+	return -EOPNOTSUPP;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 10, 0)
+/*!
+ * @brief adjust frequency (ptp clock operation)
+ */
+static int apt_usbtrx_ptp_adjfine(struct ptp_clock_info *info, long scaled_ppm)
+{
+	return -EOPNOTSUPP;
+}
+#else
+/*!
+ * @brief adjust frequency (ptp clock operation)
+ */
+static int apt_usbtrx_ptp_adjfreq(struct ptp_clock_info *info, s32 ppb)
+{
+	return -EOPNOTSUPP;
+}
+#endif
+
+/*!
+ * @brief enable ancillary feature (ptp clock operation)
+ */
+static int apt_usbtrx_ptp_enable(struct ptp_clock_info *info, struct ptp_clock_request *request, int on)
+{
+	return -EOPNOTSUPP;
+}
+
+/*!
+ * @brief ptp clock info template
+ */
+static const struct ptp_clock_info apt_usbtrx_ptp_info = {
+	.owner = THIS_MODULE,
+	.name = "apt_usbtrx",
+	.max_adj = 0,
+	.gettime64 = apt_usbtrx_ptp_gettime64,
+	.settime64 = apt_usbtrx_ptp_settime64,
+	.adjtime = apt_usbtrx_ptp_adjtime,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 10, 0)
+	.adjfine = apt_usbtrx_ptp_adjfine,
+#else
+	.adjfreq = apt_usbtrx_ptp_adjfreq,
+#endif
+	.enable = apt_usbtrx_ptp_enable,
+};
+#endif
+
+/*!
+ * @brief register ptp clock
+ * NOTE: A read-only clock running on the device timestamp counter,
+ *       i.e. the same time base as the hardware timestamps of received frames.
+ */
+int apt_usbtrx_ptp_register(apt_usbtrx_dev_t *dev)
+{
+#if IS_ENABLED(CONFIG_PTP_1588_CLOCK)
+	struct ptp_clock *ptp_clock;
+
+	dev->ptp_info = apt_usbtrx_ptp_info;
+	snprintf(dev->ptp_info.name, sizeof(dev->ptp_info.name), "aptUSB%d", dev->interface->minor);
+
+	ptp_clock = ptp_clock_register(&dev->ptp_info, &dev->interface->dev);
+	if (IS_ERR(ptp_clock)) {
+		EMSG("ptp_clock_register().. Error, <errno:%ld>", PTR_ERR(ptp_clock));
+		dev->ptp_clock = NULL;
+		return RESULT_Failure;
+	}
+	dev->ptp_clock = ptp_clock;
+	if (ptp_clock != NULL) {
+		IMSG("ptp clock registered, <index:%d>", ptp_clock_index(ptp_clock));
+	}
+#endif
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief unregister ptp clock
+ */
+void apt_usbtrx_ptp_unregister(apt_usbtrx_dev_t *dev)
+{
+#if IS_ENABLED(CONFIG_PTP_1588_CLOCK)
+	if (dev->ptp_clock != NULL) {
+		ptp_clock_unregister(dev->ptp_clock);
+		dev->ptp_clock = NULL;
+	}
+#endif
+}
+
+/*!
+ * @brief fill ethtool timestamping info (CAN netdevs)
+ */
+int apt_usbtrx_ptp_get_ts_info(apt_usbtrx_dev_t *dev, apt_usbtrx_ethtool_ts_info_t *info)
+{
+	info->so_timestamping = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE |
+				SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_HARDWARE |
+				SOF_TIMESTAMPING_RAW_HARDWARE;
+	info->phc_index = -1;
+#if IS_ENABLED(CONFIG_PTP_1588_CLOCK)
+	if (dev->ptp_clock != NULL) {
+		info->phc_index = ptp_clock_index(dev->ptp_clock);
+	}
+#endif
+	info->tx_types = BIT(HWTSTAMP_TX_OFF);
+	info->rx_filters = BIT(HWTSTAMP_FILTER_ALL);
+
+	return 0;
+}
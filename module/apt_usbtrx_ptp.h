@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * EDGEPLANT USB Peripherals Device Driver for Linux.
+ *
+ * Copyright (C) 2018 aptpod Inc.
+ */
+#ifndef __APT_USBTRX_PTP_H__
+#define __APT_USBTRX_PTP_H__
+
+#include <linux/version.h>
+#include <linux/ethtool.h>
+
+#include "apt_usbtrx_def.h"
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 11, 0)
+typedef struct kernel_ethtool_ts_info apt_usbtrx_ethtool_ts_info_t;
+#else
+typedef struct ethtool_ts_info apt_usbtrx_ethtool_ts_info_t;
+#endif
+
+/*!
+ * @brief register ptp clock
+ */
+int apt_usbtrx_ptp_register(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief unregister ptp clock
+ */
+void apt_usbtrx_ptp_unregister(apt_usbtrx_dev_t *dev);
+
+/*!
+ * @brief fill ethtool timestamping info (CAN netdevs)
+ */
+int apt_usbtrx_ptp_get_ts_info(apt_usbtrx_dev_t *dev, apt_usbtrx_ethtool_ts_info_t *info);
+
+#endif /* __APT_USBTRX_PTP_H__ */
@@ -10,9 +10,13 @@
 #include <linux/wait.h>
 #include <linux/vmalloc.h>
 #include <linux/uaccess.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <asm/barrier.h>
 
 #include "apt_usbtrx_ringbuffer.h"
 #include "apt_usbtrx_def.h"
+#include "apt_usbtrx_cmd_def.h"
 
 /*!
  * @brief initial instance
@@ -24,12 +28,10 @@ static int apt_usbtrx_ringbuffer_init_instance(apt_usbtrx_ringbuffer_t *ringbuff
 		return RESULT_Failure;
 	}
 
+	ringbuffer->ctrl = NULL;
 	ringbuffer->buffer = NULL;
 	ringbuffer->buffer_size = 0;
-	ringbuffer->begin = NULL;
-	ringbuffer->end = NULL;
-	ringbuffer->read = NULL;
-	ringbuffer->write = NULL;
+	ringbuffer->mask = 0;
 	ringbuffer->skip_count = 0;
 	init_waitqueue_head(&ringbuffer->wq);
 	ringbuffer->log_write_buffer_is_full = true;
@@ -42,34 +44,46 @@ static int apt_usbtrx_ringbuffer_init_instance(apt_usbtrx_ringbuffer_t *ringbuff
  */
 int apt_usbtrx_ringbuffer_init(apt_usbtrx_ringbuffer_t *ringbuffer, size_t size)
 {
-	u8 *buffer;
+	u8 *area;
 	int result;
 
+	BUILD_BUG_ON(sizeof(apt_usbtrx_mmap_ctrl_t) > PAGE_SIZE);
+
 	if (ringbuffer == NULL) {
 		EMSG("ringbuffer is NULL");
 		return RESULT_Failure;
 	}
 
+	if (size == 0) {
+		EMSG("size is Zero");
+		return RESULT_Failure;
+	}
+
 	result = apt_usbtrx_ringbuffer_init_instance(ringbuffer);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_ringbuffer_init_instance().. Error");
 		return RESULT_Failure;
 	}
 
-	buffer = vmalloc(size);
-	if (buffer == NULL) {
-		EMSG("vmalloc().. Error");
+	if (!is_power_of_2(size)) {
+		size_t aligned_size = roundup_pow_of_two(size);
+		WMSG("size is not power of 2, round up <size:%zu -> %zu>", size, aligned_size);
+		size = aligned_size;
+	}
+
+	/* control page + ring data, zeroed and mappable to user space */
+	area = vmalloc_user(PAGE_SIZE + size);
+	if (area == NULL) {
+		EMSG("vmalloc_user().. Error");
 		return RESULT_Failure;
 	}
-	memset(buffer, 0, size);
 
-	ringbuffer->buffer = buffer;
+	ringbuffer->ctrl = (apt_usbtrx_mmap_ctrl_t *)area;
+	ringbuffer->ctrl->buffer_size = size;
+	ringbuffer->ctrl->data_offset = PAGE_SIZE;
+	ringbuffer->buffer = area + PAGE_SIZE;
 	ringbuffer->buffer_size = size;
-
-	ringbuffer->begin = ringbuffer->buffer;
-	ringbuffer->end = ringbuffer->buffer + ringbuffer->buffer_size;
-	ringbuffer->read = ringbuffer->buffer;
-	ringbuffer->write = ringbuffer->buffer;
+	ringbuffer->mask = size - 1;
 
 	ringbuffer->log_write_buffer_is_full = true;
 
@@ -86,28 +100,92 @@ int apt_usbtrx_ringbuffer_term(apt_usbtrx_ringbuffer_t *ringbuffer)
 		return RESULT_Failure;
 	}
 
-	if (ringbuffer->buffer != NULL) {
-		vfree(ringbuffer->buffer);
+	if (ringbuffer->ctrl != NULL) {
+		vfree(ringbuffer->ctrl);
 
+		ringbuffer->ctrl = NULL;
 		ringbuffer->buffer = NULL;
 		ringbuffer->buffer_size = 0;
-		ringbuffer->begin = NULL;
-		ringbuffer->end = NULL;
-		ringbuffer->read = NULL;
-		ringbuffer->write = NULL;
+		ringbuffer->mask = 0;
+	}
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief resize
+ * NOTE: queued data is discarded, neither the producer nor the consumer may run.
+ *       On failure the ring is left as it was.
+ */
+int apt_usbtrx_ringbuffer_resize(apt_usbtrx_ringbuffer_t *ringbuffer, size_t size)
+{
+	apt_usbtrx_ringbuffer_t resized;
+	int result;
+
+	if (ringbuffer == NULL) {
+		EMSG("ringbuffer is NULL");
+		return RESULT_Failure;
+	}
+
+	result = apt_usbtrx_ringbuffer_init(&resized, size);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_ringbuffer_init().. Error");
+		return RESULT_Failure;
 	}
 
+	/* keep wq and skip_count, waiters and the sysfs counter outlive the ring data */
+	vfree(ringbuffer->ctrl);
+	ringbuffer->ctrl = resized.ctrl;
+	ringbuffer->buffer = resized.buffer;
+	ringbuffer->buffer_size = resized.buffer_size;
+	ringbuffer->mask = resized.mask;
+	ringbuffer->log_write_buffer_is_full = true;
+
 	return RESULT_Success;
 }
 
+/*!
+ * @brief get readable region (consumer)
+ *
+ * Splits the readable bytes starting at tail into the part up to the end of
+ * the buffer (first) and the wrapped part (second).
+ */
+static size_t apt_usbtrx_ringbuffer_get_read_region(apt_usbtrx_ringbuffer_t *ringbuffer, size_t size,
+						    unsigned int *tail, size_t *first, size_t *second)
+{
+	unsigned int head;
+	size_t offset;
+	size_t todo;
+
+	*tail = READ_ONCE(ringbuffer->ctrl->tail);
+	/* pairs with smp_store_release() in apt_usbtrx_ringbuffer_write() */
+	head = smp_load_acquire(&ringbuffer->ctrl->head);
+
+	todo = head - *tail;
+	/* tail may be corrupted by a user space reader, never go beyond the ring */
+	if (todo > ringbuffer->buffer_size) {
+		todo = ringbuffer->buffer_size;
+	}
+	if (todo > size) {
+		todo = size;
+	}
+
+	offset = *tail & ringbuffer->mask;
+	*first = min(todo, ringbuffer->buffer_size - offset);
+	*second = todo - *first;
+
+	return todo;
+}
+
 /*!
  * @brief read
  */
 ssize_t apt_usbtrx_ringbuffer_read(apt_usbtrx_ringbuffer_t *ringbuffer, u8 *buffer, size_t size)
 {
-	size_t read_size = 0;
-	u8 *pread;
-	u8 *pwrite;
+	size_t read_size;
+	unsigned int tail;
+	size_t first;
+	size_t second;
 
 	if (ringbuffer == NULL) {
 		EMSG("ringbuffer is NULL");
@@ -124,62 +202,24 @@ ssize_t apt_usbtrx_ringbuffer_read(apt_usbtrx_ringbuffer_t *ringbuffer, u8 *buff
 		return 0;
 	}
 
-	pread = ringbuffer->read;
-	pwrite = ringbuffer->write;
-
-	if (pread < pwrite) {
-		size_t todo;
-
-		if ((pread + size) <= pwrite) {
-			todo = size;
-		} else {
-			todo = pwrite - pread;
-		}
+	read_size = apt_usbtrx_ringbuffer_get_read_region(ringbuffer, size, &tail, &first, &second);
+	if (read_size == 0) {
+		return 0;
+	}
 
-		if (copy_to_user(buffer, pread, todo) != 0) {
+	if (copy_to_user(buffer, ringbuffer->buffer + (tail & ringbuffer->mask), first) != 0) {
+		EMSG("copy_to_user().. Error");
+		return -1;
+	}
+	if (second > 0) {
+		if (copy_to_user(buffer + first, ringbuffer->buffer, second) != 0) {
 			EMSG("copy_to_user().. Error");
 			return -1;
 		}
-		pread += todo;
-		read_size = todo;
-	} else if (pread > pwrite) {
-		if ((pread + size) <= ringbuffer->end) {
-			if (copy_to_user(buffer, pread, size) != 0) {
-				EMSG("copy_to_user().. Error");
-				return -1;
-			}
-			pread += size;
-			read_size = size;
-		} else {
-			size_t first = ringbuffer->end - pread;
-			size_t second = size - first;
-
-			if ((ringbuffer->begin + second) > pwrite) {
-				second = pwrite - ringbuffer->begin;
-			}
-
-			if (first > 0) {
-				if (copy_to_user(buffer, pread, first) != 0) {
-					EMSG("copy_to_user().. Error");
-					return -1;
-				}
-			}
-			if (second > 0) {
-				if (copy_to_user(buffer + first, ringbuffer->begin, second) != 0) {
-					EMSG("copy_to_user().. Error");
-					return -1;
-				}
-			}
-			pread = ringbuffer->begin + second;
-			read_size = first + second;
-		}
-	} else {
-		read_size = 0;
 	}
 
-	if (read_size > 0) {
-		ringbuffer->read = pread;
-	}
+	/* pairs with smp_load_acquire() in apt_usbtrx_ringbuffer_write() */
+	smp_store_release(&ringbuffer->ctrl->tail, tail + (unsigned int)read_size);
 
 	return read_size;
 }
@@ -189,9 +229,10 @@ ssize_t apt_usbtrx_ringbuffer_read(apt_usbtrx_ringbuffer_t *ringbuffer, u8 *buff
  */
 ssize_t apt_usbtrx_ringbuffer_rawread(apt_usbtrx_ringbuffer_t *ringbuffer, u8 *buffer, size_t size)
 {
-	size_t read_size = 0;
-	u8 *pread;
-	u8 *pwrite;
+	size_t read_size;
+	unsigned int tail;
+	size_t first;
+	size_t second;
 
 	if (ringbuffer == NULL) {
 		EMSG("ringbuffer is NULL");
@@ -208,62 +249,151 @@ ssize_t apt_usbtrx_ringbuffer_rawread(apt_usbtrx_ringbuffer_t *ringbuffer, u8 *b
 		return 0;
 	}
 
-	pread = ringbuffer->read;
-	pwrite = ringbuffer->write;
+	read_size = apt_usbtrx_ringbuffer_get_read_region(ringbuffer, size, &tail, &first, &second);
+	if (read_size == 0) {
+		return 0;
+	}
 
-	if (pread < pwrite) {
-		size_t todo;
+	memcpy(buffer, ringbuffer->buffer + (tail & ringbuffer->mask), first);
+	if (second > 0) {
+		memcpy(buffer + first, ringbuffer->buffer, second);
+	}
 
-		if ((pread + size) <= pwrite) {
-			todo = size;
-		} else {
-			todo = pwrite - pread;
-		}
+	/* pairs with smp_load_acquire() in apt_usbtrx_ringbuffer_write() */
+	smp_store_release(&ringbuffer->ctrl->tail, tail + (unsigned int)read_size);
 
-		memcpy(buffer, pread, todo);
-		pread += todo;
-		read_size = todo;
-	} else if (pread > pwrite) {
-		if ((pread + size) <= ringbuffer->end) {
-			memcpy(buffer, pread, size);
-			pread += size;
-			read_size = size;
-		} else {
-			size_t first = ringbuffer->end - pread;
-			size_t second = size - first;
-
-			if ((ringbuffer->begin + second) > pwrite) {
-				second = pwrite - ringbuffer->begin;
-			}
-
-			if (first > 0) {
-				memcpy(buffer, pread, first);
-			}
-			if (second > 0) {
-				memcpy(buffer + first, ringbuffer->begin, second);
-			}
-			pread = ringbuffer->begin + second;
-			read_size = first + second;
-		}
-	} else {
-		read_size = 0;
+	return read_size;
+}
+
+/*!
+ * @brief peek
+ */
+ssize_t apt_usbtrx_ringbuffer_peek(apt_usbtrx_ringbuffer_t *ringbuffer, u8 *buffer, size_t size)
+{
+	size_t read_size;
+	unsigned int tail;
+	size_t first;
+	size_t second;
+
+	if (ringbuffer == NULL) {
+		EMSG("ringbuffer is NULL");
+		return -1;
 	}
 
-	if (read_size > 0) {
-		ringbuffer->read = pread;
+	if (buffer == NULL) {
+		EMSG("buffer is NULL");
+		return -1;
+	}
+
+	if (size == 0) {
+		EMSG("size is Zero");
+		return 0;
+	}
+
+	read_size = apt_usbtrx_ringbuffer_get_read_region(ringbuffer, size, &tail, &first, &second);
+	if (read_size == 0) {
+		return 0;
+	}
+
+	memcpy(buffer, ringbuffer->buffer + (tail & ringbuffer->mask), first);
+	if (second > 0) {
+		memcpy(buffer + first, ringbuffer->buffer, second);
 	}
 
 	return read_size;
 }
 
+/*!
+ * @brief get size of the record at pos
+ *
+ * A record wrapping at the end of the ring is passed to get_record_size() contiguously.
+ */
+static int apt_usbtrx_ringbuffer_get_record_size_at(apt_usbtrx_ringbuffer_t *ringbuffer, unsigned int pos,
+						    size_t left,
+						    int (*get_record_size)(void *context, const void *record),
+						    void *context)
+{
+	u8 record[APT_USBTRX_MSG_LENGTH_TO_PAYLOAD(APT_USBTRX_CMD_MAX_LENGTH)];
+	size_t offset = pos & ringbuffer->mask;
+	size_t len = min(left, sizeof(record));
+	const u8 *p = ringbuffer->buffer + offset;
+
+	if (ringbuffer->buffer_size - offset < len) {
+		size_t len_first = ringbuffer->buffer_size - offset;
+
+		memcpy(record, p, len_first);
+		memcpy(record + len_first, ringbuffer->buffer, len - len_first);
+		p = record;
+	}
+
+	return get_record_size(context, p);
+}
+
+/*!
+ * @brief get size of the whole records that fit (consumer)
+ *
+ * Walks the records from tail with get_record_size() and returns the total size
+ * of the leading whole records that fit into size, or -1 if a record is broken.
+ * Published records are never modified by the producer, so a following read of
+ * the returned size consumes exactly these records.
+ */
+ssize_t apt_usbtrx_ringbuffer_get_record_size(apt_usbtrx_ringbuffer_t *ringbuffer, size_t size,
+					      int (*get_record_size)(void *context, const void *record), void *context,
+					      size_t *records)
+{
+	size_t used_size;
+	size_t total = 0;
+	size_t count = 0;
+	unsigned int tail;
+	size_t first;
+	size_t second;
+
+	if (ringbuffer == NULL) {
+		EMSG("ringbuffer is NULL");
+		return -1;
+	}
+
+	if (get_record_size == NULL) {
+		EMSG("get_record_size is NULL");
+		return -1;
+	}
+
+	used_size = apt_usbtrx_ringbuffer_get_read_region(ringbuffer, ringbuffer->buffer_size, &tail, &first, &second);
+	while (total < used_size) {
+		size_t left = used_size - total;
+		int record_size;
+
+		record_size = apt_usbtrx_ringbuffer_get_record_size_at(ringbuffer, tail + total, left, get_record_size,
+								       context);
+		if (record_size <= 0 || (size_t)record_size > left) {
+			EMSG_RL("invalid record, <size:%d> <left:%zu>", record_size, left);
+			return -1;
+		}
+		if (total + record_size > size) {
+			break;
+		}
+
+		total += record_size;
+		count++;
+	}
+
+	if (records != NULL) {
+		*records = count;
+	}
+
+	return total;
+}
+
 /*!
  * @brief write
  */
 ssize_t apt_usbtrx_ringbuffer_write(apt_usbtrx_ringbuffer_t *ringbuffer, const u8 *buffer, size_t size)
 {
-	u8 *pread;
-	u8 *pwrite;
-	size_t skip_count = 0;
+	unsigned int head;
+	unsigned int tail;
+	size_t used_size;
+	size_t offset;
+	size_t first;
 
 	if (ringbuffer == NULL) {
 		EMSG("ringbuffer is NULL");
@@ -280,41 +410,17 @@ ssize_t apt_usbtrx_ringbuffer_write(apt_usbtrx_ringbuffer_t *ringbuffer, const u
 		return 0;
 	}
 
-	pread = ringbuffer->read;
-	pwrite = ringbuffer->write;
-
-	if (pread <= pwrite) {
-		if ((pwrite + size) <= ringbuffer->end) {
-			memcpy(pwrite, buffer, size);
-			pwrite += size;
-		} else {
-			size_t first = ringbuffer->end - pwrite;
-			size_t second = size - first;
-
-			if ((ringbuffer->begin + second) < pread) {
-				if (first > 0) {
-					memcpy(pwrite, buffer, first);
-				}
-				if (second > 0) {
-					memcpy(ringbuffer->begin, buffer + first, second);
-				}
-				pwrite = ringbuffer->begin + second;
-			} else {
-				skip_count = size;
-			}
-		}
-	} else {
-		if ((pwrite + size) < pread) {
-			memcpy(pwrite, buffer, size);
-			pwrite += size;
-		} else {
-			skip_count = size;
-		}
+	head = ringbuffer->ctrl->head;
+	/* pairs with smp_store_release() in the consumer functions */
+	tail = smp_load_acquire(&ringbuffer->ctrl->tail);
+
+	used_size = head - tail;
+	if (used_size > ringbuffer->buffer_size) {
+		used_size = ringbuffer->buffer_size;
 	}
 
-	ringbuffer->write = pwrite;
-	if (skip_count > 0) {
-		ringbuffer->skip_count += skip_count;
+	if (size > ringbuffer->buffer_size - used_size) {
+		ringbuffer->skip_count += size;
 		if (ringbuffer->log_write_buffer_is_full) {
 			EMSG("ringbuffer is full");
 			/* disable log continue output */
@@ -323,33 +429,82 @@ ssize_t apt_usbtrx_ringbuffer_write(apt_usbtrx_ringbuffer_t *ringbuffer, const u
 		return -1;
 	}
 
+	offset = head & ringbuffer->mask;
+	first = min(size, ringbuffer->buffer_size - offset);
+
+	memcpy(ringbuffer->buffer + offset, buffer, first);
+	if (size > first) {
+		memcpy(ringbuffer->buffer, buffer + first, size - first);
+	}
+
+	/* pairs with smp_load_acquire() in the consumer functions */
+	smp_store_release(&ringbuffer->ctrl->head, head + (unsigned int)size);
+
 	return size;
 }
 
 /*!
- * @brief is empty
+ * @brief write, overwriting the oldest records (producer owning tail)
+ *
+ * The oldest whole records are dropped until size fits. The producer updates
+ * tail as well, so no consumer may read the ring in the meantime.
  */
-bool apt_usbtrx_ringbuffer_is_empty(apt_usbtrx_ringbuffer_t *ringbuffer)
+ssize_t apt_usbtrx_ringbuffer_write_overwrite(apt_usbtrx_ringbuffer_t *ringbuffer, const u8 *buffer, size_t size,
+					      int (*get_record_size)(void *context, const void *record),
+					      void *context)
 {
-	bool empty;
-	u8 *pread;
-	u8 *pwrite;
+	unsigned int head;
+	unsigned int tail;
+	size_t used_size;
 
 	if (ringbuffer == NULL) {
 		EMSG("ringbuffer is NULL");
-		return false;
+		return -1;
+	}
+
+	if (size > ringbuffer->buffer_size) {
+		EMSG("size is too large, <size:%zu>", size);
+		return -1;
+	}
+
+	head = ringbuffer->ctrl->head;
+	tail = READ_ONCE(ringbuffer->ctrl->tail);
+
+	used_size = head - tail;
+	if (used_size > ringbuffer->buffer_size) {
+		/* tail is corrupted, drop everything */
+		tail = head;
+		used_size = 0;
 	}
 
-	pread = ringbuffer->read;
-	pwrite = ringbuffer->write;
+	while (size > ringbuffer->buffer_size - used_size) {
+		int record_size = apt_usbtrx_ringbuffer_get_record_size_at(ringbuffer, tail, used_size,
+									   get_record_size, context);
 
-	if (pread == pwrite) {
-		empty = true;
-	} else {
-		empty = false;
+		if (record_size <= 0 || (size_t)record_size > used_size) {
+			EMSG_RL("invalid record, <size:%d> <used:%zu>", record_size, used_size);
+			record_size = used_size;
+		}
+		tail += record_size;
+		used_size -= record_size;
 	}
 
-	return empty;
+	smp_store_release(&ringbuffer->ctrl->tail, tail);
+
+	return apt_usbtrx_ringbuffer_write(ringbuffer, buffer, size);
+}
+
+/*!
+ * @brief is empty
+ */
+bool apt_usbtrx_ringbuffer_is_empty(apt_usbtrx_ringbuffer_t *ringbuffer)
+{
+	if (ringbuffer == NULL) {
+		EMSG("ringbuffer is NULL");
+		return false;
+	}
+
+	return smp_load_acquire(&ringbuffer->ctrl->head) == READ_ONCE(ringbuffer->ctrl->tail);
 }
 
 /*!
@@ -362,10 +517,10 @@ int apt_usbtrx_ringbuffer_clear(apt_usbtrx_ringbuffer_t *ringbuffer)
 		return RESULT_Failure;
 	}
 
-	ringbuffer->read = ringbuffer->buffer;
-	ringbuffer->write = ringbuffer->buffer;
+	/* drop everything published so far, called on the consumer side */
+	smp_store_release(&ringbuffer->ctrl->tail, smp_load_acquire(&ringbuffer->ctrl->head));
 
-	ringbuffer->log_write_buffer_is_full = true;
+	WRITE_ONCE(ringbuffer->log_write_buffer_is_full, true);
 
 	return RESULT_Success;
 }
@@ -375,8 +530,8 @@ int apt_usbtrx_ringbuffer_clear(apt_usbtrx_ringbuffer_t *ringbuffer)
  */
 size_t apt_usbtrx_ringbuffer_get_used_size(apt_usbtrx_ringbuffer_t *ringbuffer)
 {
-	u8 *pread;
-	u8 *pwrite;
+	unsigned int head;
+	unsigned int tail;
 	size_t used_size;
 
 	if (ringbuffer == NULL) {
@@ -384,13 +539,12 @@ size_t apt_usbtrx_ringbuffer_get_used_size(apt_usbtrx_ringbuffer_t *ringbuffer)
 		return 0;
 	}
 
-	pread = ringbuffer->read;
-	pwrite = ringbuffer->write;
+	tail = smp_load_acquire(&ringbuffer->ctrl->tail);
+	head = smp_load_acquire(&ringbuffer->ctrl->head);
 
-	if (pwrite >= pread) {
-		used_size = pwrite - pread;
-	} else {
-		used_size = (pwrite - ringbuffer->begin) + (ringbuffer->end - pread);
+	used_size = head - tail;
+	if (used_size > ringbuffer->buffer_size) {
+		used_size = ringbuffer->buffer_size;
 	}
 
 	return used_size;
@@ -404,3 +558,36 @@ size_t apt_usbtrx_ringbuffer_get_free_size(apt_usbtrx_ringbuffer_t *ringbuffer)
 	size_t used_size = apt_usbtrx_ringbuffer_get_used_size(ringbuffer);
 	return (ringbuffer->buffer_size - used_size);
 }
+
+/*!
+ * @brief mmap
+ */
+int apt_usbtrx_ringbuffer_mmap(apt_usbtrx_ringbuffer_t *ringbuffer, struct vm_area_struct *vma)
+{
+	unsigned long size;
+	int result;
+
+	if (ringbuffer == NULL) {
+		EMSG("ringbuffer is NULL");
+		return RESULT_Failure;
+	}
+
+	if (ringbuffer->ctrl == NULL) {
+		EMSG("ringbuffer is not initialized");
+		return RESULT_Failure;
+	}
+
+	size = vma->vm_end - vma->vm_start;
+	if (vma->vm_pgoff != 0 || size > PAGE_SIZE + ringbuffer->buffer_size) {
+		EMSG("invalid mapping, <pgoff:%lu> <size:%lu>", vma->vm_pgoff, size);
+		return RESULT_Failure;
+	}
+
+	result = remap_vmalloc_range(vma, ringbuffer->ctrl, 0);
+	if (result != 0) {
+		EMSG("remap_vmalloc_range().. Error, <errno:%d>", result);
+		return RESULT_Failure;
+	}
+
+	return RESULT_Success;
+}
@@ -8,25 +8,41 @@
 #define __APT_USBTRX_RINGBUFFER_H__
 
 #include <linux/types.h>
+#include <linux/cache.h>
+#include <linux/wait.h>
+
+struct apt_usbtrx_mmap_ctrl_s;
+struct vm_area_struct;
 
 /*!
  * @brief ring buffer structrue
+ *
+ * Lock-free single-producer/single-consumer ring.
+ * buffer_size is always a power of two and head/tail are free-running indices
+ * masked with (buffer_size - 1). head is only written by the producer and tail
+ * only by the consumer, each published with release semantics and observed by
+ * the other side with acquire semantics.
+ * head/tail live in a control page placed right before the ring data, on
+ * separate cache lines, so that the ring can be mapped to user space as is.
  */
 struct apt_usbtrx_ringbuffer_s {
+	struct apt_usbtrx_mmap_ctrl_s *ctrl; /*!< control page (head/tail) */
 	u8 *buffer; /*!< */
-	size_t buffer_size; /*!< */
-	u8 *begin; /*!< */
-	u8 *end; /*!< */
-	u8 *read; /*!< */
-	u8 *write; /*!< */
-	u64 skip_count; /*!< */
-	wait_queue_head_t wq; /*!< */
+	size_t buffer_size; /*!< power of two */
+	size_t mask; /*!< buffer_size - 1 */
+
+	/* producer side */
+	u64 skip_count ____cacheline_aligned_in_smp; /*!< */
 	bool log_write_buffer_is_full; /*!< */
+
+	wait_queue_head_t wq ____cacheline_aligned_in_smp; /*!< */
 };
 typedef struct apt_usbtrx_ringbuffer_s apt_usbtrx_ringbuffer_t;
 
 /*!
  * @brief init
+ *
+ * size is rounded up to the next power of two.
  */
 int apt_usbtrx_ringbuffer_init(apt_usbtrx_ringbuffer_t *ringbuffer, size_t size);
 
@@ -36,27 +52,53 @@ int apt_usbtrx_ringbuffer_init(apt_usbtrx_ringbuffer_t *ringbuffer, size_t size)
 int apt_usbtrx_ringbuffer_term(apt_usbtrx_ringbuffer_t *ringbuffer);
 
 /*!
- * @brief read
+ * @brief resize
+ *
+ * size is rounded up to the next power of two, queued data is discarded.
+ */
+int apt_usbtrx_ringbuffer_resize(apt_usbtrx_ringbuffer_t *ringbuffer, size_t size);
+
+/*!
+ * @brief read (consumer)
  */
 ssize_t apt_usbtrx_ringbuffer_read(apt_usbtrx_ringbuffer_t *ringbuffer, u8 *buffer, size_t size);
 
 /*!
- * @brief raw read
+ * @brief raw read (consumer)
  */
 ssize_t apt_usbtrx_ringbuffer_rawread(apt_usbtrx_ringbuffer_t *ringbuffer, u8 *buffer, size_t size);
 
 /*!
- * @brief write
+ * @brief peek (consumer), read without consuming
+ */
+ssize_t apt_usbtrx_ringbuffer_peek(apt_usbtrx_ringbuffer_t *ringbuffer, u8 *buffer, size_t size);
+
+/*!
+ * @brief get size of the whole records that fit (consumer)
+ */
+ssize_t apt_usbtrx_ringbuffer_get_record_size(apt_usbtrx_ringbuffer_t *ringbuffer, size_t size,
+					      int (*get_record_size)(void *context, const void *record), void *context,
+					      size_t *records);
+
+/*!
+ * @brief write (producer)
  */
 ssize_t apt_usbtrx_ringbuffer_write(apt_usbtrx_ringbuffer_t *ringbuffer, const u8 *buffer, size_t size);
 
+/*!
+ * @brief write, overwriting the oldest records (producer owning tail)
+ */
+ssize_t apt_usbtrx_ringbuffer_write_overwrite(apt_usbtrx_ringbuffer_t *ringbuffer, const u8 *buffer, size_t size,
+					      int (*get_record_size)(void *context, const void *record),
+					      void *context);
+
 /*!
  * @brief is buffer empty
  */
 bool apt_usbtrx_ringbuffer_is_empty(apt_usbtrx_ringbuffer_t *ringbuffer);
 
 /*!
- * @brief clear
+ * @brief clear (consumer)
  */
 int apt_usbtrx_ringbuffer_clear(apt_usbtrx_ringbuffer_t *ringbuffer);
 
@@ -70,4 +112,9 @@ size_t apt_usbtrx_ringbuffer_get_used_size(apt_usbtrx_ringbuffer_t *ringbuffer);
  */
 size_t apt_usbtrx_ringbuffer_get_free_size(apt_usbtrx_ringbuffer_t *ringbuffer);
 
+/*!
+ * @brief map control page and ring data to user space
+ */
+int apt_usbtrx_ringbuffer_mmap(apt_usbtrx_ringbuffer_t *ringbuffer, struct vm_area_struct *vma);
+
 #endif /* #ifndef __APT_USBTRX_RINGBUFFER_H__ */
@@ -7,8 +7,10 @@
  */
 
 #include <linux/device.h>
+#include <linux/log2.h>
 
 #include "apt_usbtrx_def.h"
+#include "apt_usbtrx_core.h"
 
 /*!
  * @brief model_name
@@ -87,6 +89,7 @@ static ssize_t apt_usbtrx_sysfs_basetime_clock_id_store(struct device *dev, stru
 		EMSG("Only \"CLOCK_MONOTONIC\" or \"COCK_MONOTONIC_RAW\" available");
 		return -EINVAL;
 	}
+	apt_usbtrx_clock_reset(&usbtrx_dev->clock);
 
 	return count;
 }
@@ -145,6 +148,173 @@ static ssize_t apt_usbtrx_sysfs_sync_pulse_show(struct device *dev, struct devic
 }
 static DEVICE_ATTR(sync_pulse, S_IRUGO, apt_usbtrx_sysfs_sync_pulse_show, NULL);
 
+/*!
+ * @brief clock_drift
+ * NOTE: "<skew ppb> <offset usec> <samples>", skew and offset are 0 until enough samples are collected.
+ */
+static ssize_t apt_usbtrx_sysfs_clock_drift_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	apt_usbtrx_dev_t *usbtrx_dev = NULL;
+	s64 skew_ppb;
+	s64 offset_us;
+	unsigned int samples;
+
+	usbtrx_dev = dev_get_drvdata(dev);
+	apt_usbtrx_clock_get_fit(&usbtrx_dev->clock, &skew_ppb, &offset_us, &samples);
+	return sprintf(buf, "%lld %lld %u\n", skew_ppb, offset_us, samples);
+}
+static DEVICE_ATTR(clock_drift, S_IRUGO, apt_usbtrx_sysfs_clock_drift_show, NULL);
+
+/*!
+ * @brief rx_resync
+ * NOTE: "<resync count> <discarded bytes>"
+ */
+static ssize_t apt_usbtrx_sysfs_rx_resync_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	apt_usbtrx_dev_t *usbtrx_dev = NULL;
+
+	usbtrx_dev = dev_get_drvdata(dev);
+	return sprintf(buf, "%lld %lld\n", (s64)atomic64_read(&usbtrx_dev->rx_resync_count),
+		       (s64)atomic64_read(&usbtrx_dev->rx_resync_bytes));
+}
+static DEVICE_ATTR(rx_resync, S_IRUGO, apt_usbtrx_sysfs_rx_resync_show, NULL);
+
+/*!
+ * @brief tx_aggregate
+ */
+static ssize_t apt_usbtrx_sysfs_tx_aggregate_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	apt_usbtrx_dev_t *usbtrx_dev = NULL;
+
+	usbtrx_dev = dev_get_drvdata(dev);
+	return sprintf(buf, "%d\n", atomic_read(&usbtrx_dev->tx_aggregate) ? 1 : 0);
+}
+static ssize_t apt_usbtrx_sysfs_tx_aggregate_store(struct device *dev, struct device_attribute *attr, const char *buf,
+						   size_t count)
+{
+	apt_usbtrx_dev_t *usbtrx_dev = NULL;
+	bool enable;
+
+	usbtrx_dev = dev_get_drvdata(dev);
+
+	if (kstrtobool(buf, &enable) != 0) {
+		EMSG("Only \"0\" or \"1\" available");
+		return -EINVAL;
+	}
+	atomic_set(&usbtrx_dev->tx_aggregate, enable);
+
+	return count;
+}
+/* NOTE: writable attrs must be listed in conf/30-apt-usb.rules */
+static DEVICE_ATTR(tx_aggregate, S_IWUSR | S_IRUGO, apt_usbtrx_sysfs_tx_aggregate_show,
+		   apt_usbtrx_sysfs_tx_aggregate_store);
+
+/*!
+ * @brief echo_skb_max
+ * NOTE: applied at the next socketcan interface up.
+ */
+static ssize_t apt_usbtrx_sysfs_echo_skb_max_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	apt_usbtrx_dev_t *usbtrx_dev = NULL;
+
+	usbtrx_dev = dev_get_drvdata(dev);
+	return sprintf(buf, "%u\n", READ_ONCE(usbtrx_dev->echo_skb_max));
+}
+static ssize_t apt_usbtrx_sysfs_echo_skb_max_store(struct device *dev, struct device_attribute *attr, const char *buf,
+						   size_t count)
+{
+	apt_usbtrx_dev_t *usbtrx_dev = NULL;
+	unsigned int value;
+
+	usbtrx_dev = dev_get_drvdata(dev);
+
+	if (kstrtouint(buf, 10, &value) != 0 || value > APT_USBTRX_ECHO_SKB_MAX || !is_power_of_2(value)) {
+		EMSG("Only powers of 2 from 1 to %d available", APT_USBTRX_ECHO_SKB_MAX);
+		return -EINVAL;
+	}
+	WRITE_ONCE(usbtrx_dev->echo_skb_max, value);
+
+	return count;
+}
+/* NOTE: writable attrs must be listed in conf/30-apt-usb.rules */
+static DEVICE_ATTR(echo_skb_max, S_IWUSR | S_IRUGO, apt_usbtrx_sysfs_echo_skb_max_show,
+		   apt_usbtrx_sysfs_echo_skb_max_store);
+
+/*!
+ * @brief rx_buffer_size
+ * NOTE: writable only while the device file is closed, rounded up to a power of two.
+ */
+static ssize_t apt_usbtrx_sysfs_rx_buffer_size_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	apt_usbtrx_dev_t *usbtrx_dev = NULL;
+
+	usbtrx_dev = dev_get_drvdata(dev);
+	return sprintf(buf, "%zu\n", READ_ONCE(usbtrx_dev->rx_data.buffer_size));
+}
+static ssize_t apt_usbtrx_sysfs_rx_buffer_size_store(struct device *dev, struct device_attribute *attr,
+						     const char *buf, size_t count)
+{
+	apt_usbtrx_dev_t *usbtrx_dev = NULL;
+	unsigned int value;
+	int result;
+
+	usbtrx_dev = dev_get_drvdata(dev);
+
+	if (kstrtouint(buf, 0, &value) != 0 || value < APT_USBTRX_DATA_BUFFER_MIN_SIZE ||
+	    value > APT_USBTRX_DATA_BUFFER_MAX_SIZE) {
+		EMSG("Only %d to %d available", APT_USBTRX_DATA_BUFFER_MIN_SIZE, APT_USBTRX_DATA_BUFFER_MAX_SIZE);
+		return -EINVAL;
+	}
+
+	result = apt_usbtrx_resize_rx_data(usbtrx_dev, value);
+	if (result != 0) {
+		return result;
+	}
+
+	return count;
+}
+/* NOTE: writable attrs must be listed in conf/30-apt-usb.rules */
+static DEVICE_ATTR(rx_buffer_size, S_IWUSR | S_IRUGO, apt_usbtrx_sysfs_rx_buffer_size_show,
+		   apt_usbtrx_sysfs_rx_buffer_size_store);
+
+/*!
+ * @brief tx_buffer_size
+ * NOTE: writable only while the device file and the socketcan interface are closed,
+ *       rounded up to a power of two.
+ */
+static ssize_t apt_usbtrx_sysfs_tx_buffer_size_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	apt_usbtrx_dev_t *usbtrx_dev = NULL;
+
+	usbtrx_dev = dev_get_drvdata(dev);
+	return sprintf(buf, "%zu\n", READ_ONCE(usbtrx_dev->tx_data.buffer_size));
+}
+static ssize_t apt_usbtrx_sysfs_tx_buffer_size_store(struct device *dev, struct device_attribute *attr,
+						     const char *buf, size_t count)
+{
+	apt_usbtrx_dev_t *usbtrx_dev = NULL;
+	unsigned int value;
+	int result;
+
+	usbtrx_dev = dev_get_drvdata(dev);
+
+	if (kstrtouint(buf, 0, &value) != 0 || value < APT_USBTRX_DATA_BUFFER_MIN_SIZE ||
+	    value > APT_USBTRX_DATA_BUFFER_MAX_SIZE) {
+		EMSG("Only %d to %d available", APT_USBTRX_DATA_BUFFER_MIN_SIZE, APT_USBTRX_DATA_BUFFER_MAX_SIZE);
+		return -EINVAL;
+	}
+
+	result = apt_usbtrx_resize_tx_data(usbtrx_dev, value);
+	if (result != 0) {
+		return result;
+	}
+
+	return count;
+}
+/* NOTE: writable attrs must be listed in conf/30-apt-usb.rules */
+static DEVICE_ATTR(tx_buffer_size, S_IWUSR | S_IRUGO, apt_usbtrx_sysfs_tx_buffer_size_show,
+		   apt_usbtrx_sysfs_tx_buffer_size_store);
+
 /*!
  * @brief sysfs initialize
  */
@@ -193,6 +363,36 @@ int apt_usbtrx_sysfs_init(struct device *dev)
 		EMSG("device_create_file().. Error, <name:%s>", "sync_pulse");
 	}
 
+	result = device_create_file(dev, &dev_attr_clock_drift);
+	if (result != 0) {
+		EMSG("device_create_file().. Error, <name:%s>", "clock_drift");
+	}
+
+	result = device_create_file(dev, &dev_attr_rx_resync);
+	if (result != 0) {
+		EMSG("device_create_file().. Error, <name:%s>", "rx_resync");
+	}
+
+	result = device_create_file(dev, &dev_attr_tx_aggregate);
+	if (result != 0) {
+		EMSG("device_create_file().. Error, <name:%s>", "tx_aggregate");
+	}
+
+	result = device_create_file(dev, &dev_attr_echo_skb_max);
+	if (result != 0) {
+		EMSG("device_create_file().. Error, <name:%s>", "echo_skb_max");
+	}
+
+	result = device_create_file(dev, &dev_attr_rx_buffer_size);
+	if (result != 0) {
+		EMSG("device_create_file().. Error, <name:%s>", "rx_buffer_size");
+	}
+
+	result = device_create_file(dev, &dev_attr_tx_buffer_size);
+	if (result != 0) {
+		EMSG("device_create_file().. Error, <name:%s>", "tx_buffer_size");
+	}
+
 	usbtrx_dev = dev_get_drvdata(dev);
 	if (usbtrx_dev == NULL) {
 		EMSG("dev_get_drvdata().. Error");
@@ -228,6 +428,12 @@ int apt_usbtrx_sysfs_term(struct device *dev)
 	device_remove_file(dev, &dev_attr_firmware_version);
 	device_remove_file(dev, &dev_attr_ch);
 	device_remove_file(dev, &dev_attr_sync_pulse);
+	device_remove_file(dev, &dev_attr_clock_drift);
+	device_remove_file(dev, &dev_attr_rx_resync);
+	device_remove_file(dev, &dev_attr_tx_aggregate);
+	device_remove_file(dev, &dev_attr_echo_skb_max);
+	device_remove_file(dev, &dev_attr_rx_buffer_size);
+	device_remove_file(dev, &dev_attr_tx_buffer_size);
 
 	usbtrx_dev = dev_get_drvdata(dev);
 	if (usbtrx_dev == NULL) {
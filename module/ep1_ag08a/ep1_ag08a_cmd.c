@@ -5,8 +5,6 @@
  * Copyright (C) 2020 aptpod Inc.
  */
 
-#include <linux/slab.h>
-
 #include "../apt_usbtrx_core.h" /* send_msg(), wait_msg() */
 #include "ep1_ag08a_cmd.h"
 #include "ep1_ag08a_msg.h"
@@ -17,6 +15,7 @@
 int ep1_ag08a_get_status(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_resp_get_status_t *status)
 {
 	int req_data_size = EP1_AG08A_CMD_LENGTH_GET_STATUS;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = EP1_AG08A_CMD_LENGTH_RESPONSE_GET_STATUS;
 	char *resp_data;
@@ -26,18 +25,9 @@ int ep1_ag08a_get_status(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_resp_get_status_t
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = EP1_AG08A_CMD_GetStatus;
@@ -45,16 +35,14 @@ int ep1_ag08a_get_status(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_resp_get_status_t
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -63,29 +51,25 @@ int ep1_ag08a_get_status(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_resp_get_status_t
 				     resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = ep1_ag08a_msg_parse_response_get_status(resp_msg.payload, resp_msg.payload_size, status);
 	if (result != RESULT_Success) {
 		EMSG("ep1_ag08a_msg_parse_response_get_status().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -97,6 +81,7 @@ int ep1_ag08a_get_status(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_resp_get_status_t
 int ep1_ag08a_set_analog_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_input_t *param, bool *success)
 {
 	int req_data_size = EP1_AG08A_CMD_LENGTH_SET_ANALOG_INPUT;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_ACK;
 	char *resp_data;
@@ -107,18 +92,9 @@ int ep1_ag08a_set_analog_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_i
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = EP1_AG08A_CMD_SetAnalogInput;
@@ -126,24 +102,21 @@ int ep1_ag08a_set_analog_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_i
 	result = ep1_ag08a_msg_pack_set_analog_input(param, req_msg.payload, req_msg.payload_size);
 	if (result != RESULT_Success) {
 		EMSG("ep1_ag08a_msg_pack_set_analog_input().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -151,31 +124,27 @@ int ep1_ag08a_set_analog_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_i
 	result = apt_usbtrx_wait_msg(dev, APT_USBTRX_CMD_ACK, APT_USBTRX_CMD_NACK, resp_data, resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &id);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_ack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	if (id != EP1_AG08A_CMD_SetAnalogInput) {
 		EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, id);
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -188,8 +157,7 @@ int ep1_ag08a_set_analog_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_i
 		break;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -201,6 +169,7 @@ int ep1_ag08a_set_analog_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_i
 int ep1_ag08a_control_analog_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control_analog_input_t *param, bool *success)
 {
 	int req_data_size = EP1_AG08A_CMD_LENGTH_CONTROL_ANALOG_INPUT;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_ACK;
 	char *resp_data;
@@ -211,18 +180,9 @@ int ep1_ag08a_control_analog_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control_
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = EP1_AG08A_CMD_ControlAnalogInput;
@@ -230,24 +190,21 @@ int ep1_ag08a_control_analog_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control_
 	result = ep1_ag08a_msg_pack_control_analog_input(param, req_msg.payload, req_msg.payload_size);
 	if (result != RESULT_Success) {
 		EMSG("ep1_ag08a_msg_pack_control_analog_input().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -255,31 +212,27 @@ int ep1_ag08a_control_analog_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control_
 	result = apt_usbtrx_wait_msg(dev, APT_USBTRX_CMD_ACK, APT_USBTRX_CMD_NACK, resp_data, resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &id);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_ack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	if (id != EP1_AG08A_CMD_ControlAnalogInput) {
 		EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, id);
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -292,8 +245,7 @@ int ep1_ag08a_control_analog_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control_
 		break;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -305,6 +257,7 @@ int ep1_ag08a_control_analog_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control_
 int ep1_ag08a_set_analog_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_output_t *param, bool *success)
 {
 	int req_data_size = EP1_AG08A_CMD_LENGTH_SET_ANALOG_OUTPUT;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_ACK;
 	char *resp_data;
@@ -315,18 +268,9 @@ int ep1_ag08a_set_analog_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = EP1_AG08A_CMD_SetAnalogOutput;
@@ -334,24 +278,21 @@ int ep1_ag08a_set_analog_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_
 	result = ep1_ag08a_msg_pack_set_analog_output(param, req_msg.payload, req_msg.payload_size);
 	if (result != RESULT_Success) {
 		EMSG("ep1_ag08a_msg_pack_set_analog_output().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -359,31 +300,27 @@ int ep1_ag08a_set_analog_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_
 	result = apt_usbtrx_wait_msg(dev, APT_USBTRX_CMD_ACK, APT_USBTRX_CMD_NACK, resp_data, resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &id);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_ack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	if (id != EP1_AG08A_CMD_SetAnalogOutput) {
 		EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, id);
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -396,8 +333,7 @@ int ep1_ag08a_set_analog_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_
 		break;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -409,6 +345,7 @@ int ep1_ag08a_set_analog_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_
 int ep1_ag08a_control_analog_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control_analog_output_t *param, bool *success)
 {
 	int req_data_size = EP1_AG08A_CMD_LENGTH_CONTROL_ANALOG_OUTPUT;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_ACK;
 	char *resp_data;
@@ -419,18 +356,9 @@ int ep1_ag08a_control_analog_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = EP1_AG08A_CMD_ControlAnalogOutput;
@@ -438,24 +366,21 @@ int ep1_ag08a_control_analog_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control
 	result = ep1_ag08a_msg_pack_control_analog_output(param, req_msg.payload, req_msg.payload_size);
 	if (result != RESULT_Success) {
 		EMSG("ep1_ag08a_msg_pack_control_analog_output().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -463,31 +388,27 @@ int ep1_ag08a_control_analog_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control
 	result = apt_usbtrx_wait_msg(dev, APT_USBTRX_CMD_ACK, APT_USBTRX_CMD_NACK, resp_data, resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &id);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_ack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	if (id != EP1_AG08A_CMD_ControlAnalogOutput) {
 		EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, id);
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -500,8 +421,7 @@ int ep1_ag08a_control_analog_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control
 		break;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -7,11 +7,12 @@
 
 #include <linux/iio/buffer.h>
 
+#include "../apt_usbtrx_core.h" /* apt_usbtrx_write_rx_data(), APT_USBTRX_MSG_COMMON_ENTRIES */
 #include "ep1_ag08a_core.h"
 #include "ep1_ag08a_msg.h"
 #include "ep1_ag08a_iio.h"
 
-static void ep1_ag08a_iio_data_copy(apt_usbtrx_msg_t *msg, ep1_ag08a_iio_data_t *priv)
+static void ep1_ag08a_iio_data_copy(apt_usbtrx_msg_view_t *msg, ep1_ag08a_iio_data_t *priv)
 {
 	ep1_ag08a_payload_notify_analog_input_t *p = (ep1_ag08a_payload_notify_analog_input_t *)msg->payload;
 	int exclude_size = sizeof(p->timestamp) + sizeof(p->channel);
@@ -25,58 +26,48 @@ static void ep1_ag08a_iio_data_copy(apt_usbtrx_msg_t *msg, ep1_ag08a_iio_data_t
 }
 
 /*!
- * @brief dispatch message
+ * @brief dispatch NotifyAnalogInput (message handler)
  */
-int ep1_ag08a_dispatch_msg(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_t *msg)
+static int ep1_ag08a_dispatch_analog_input(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg)
 {
 	ep1_ag08a_unique_data_t *unique_data = get_unique_data(dev);
+	ep1_ag08a_payload_notify_analog_input_t *p = (ep1_ag08a_payload_notify_analog_input_t *)msg->payload;
+	int if_type = atomic_read(&unique_data->if_type);
 
-	switch (msg->id) {
-	case EP1_AG08A_CMD_NotifyAnalogInput: {
-		int if_type = atomic_read(&unique_data->if_type);
-
-		if (if_type == EP1_AG08A_IF_TYPE_FILE) {
-			apt_usbtrx_ringbuffer_write(&dev->rx_data, msg->payload, msg->payload_size);
-			wake_up_interruptible(&dev->rx_data.wq);
-		} else if (if_type == EP1_AG08A_IF_TYPE_IIO) {
-			struct iio_dev *indio_dev = unique_data->indio_dev;
-			ep1_ag08a_iio_data_t *priv = iio_priv(indio_dev);
-			ep1_ag08a_payload_notify_analog_input_t *p =
-				(ep1_ag08a_payload_notify_analog_input_t *)msg->payload;
-			s64 time_ns;
+	if (if_type == EP1_AG08A_IF_TYPE_FILE) {
+		apt_usbtrx_write_rx_data(dev, &p->timestamp, msg->payload, msg->payload_size);
+		apt_usbtrx_notify_rx_data(dev);
+	} else if (if_type == EP1_AG08A_IF_TYPE_IIO) {
+		struct iio_dev *indio_dev = unique_data->indio_dev;
+		ep1_ag08a_iio_data_t *priv = iio_priv(indio_dev);
+		s64 time_ns;
 
-			ep1_ag08a_iio_data_copy(msg, priv);
+		ep1_ag08a_iio_data_copy(msg, priv);
 
-			if (priv->hw_timestamp) {
-				time_ns = p->timestamp.ts_sec * NSEC_PER_SEC + p->timestamp.ts_usec * NSEC_PER_USEC;
-			} else {
-				time_ns = wrap_iio_get_time_ns(indio_dev);
-			}
-			iio_push_to_buffers_with_timestamp(indio_dev, priv->buffer, time_ns);
-		}
-		break;
-	}
-	case EP1_AG08A_CMD_ResponseGetStatus: {
-		if (dev->rx_complete.id == EP1_AG08A_CMD_GetStatus) {
-			DMSG("complete!, <id:0x%02x> length=%d", msg->id,
-			     APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size));
-			dev->rx_complete.data_size = APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size);
-			memcpy(dev->rx_complete.buffer, data, dev->rx_complete.data_size);
-			complete(&dev->rx_complete.complete);
+		if (priv->hw_timestamp) {
+			time_ns = p->timestamp.ts_sec * NSEC_PER_SEC + p->timestamp.ts_usec * NSEC_PER_USEC;
+		} else {
+			time_ns = wrap_iio_get_time_ns(indio_dev);
 		}
-		break;
-	}
-	default:
-		return RESULT_Failure;
+		iio_push_to_buffers_with_timestamp(indio_dev, priv->buffer, time_ns);
 	}
 
 	return RESULT_Success;
 }
 
+/*!
+ * @brief message dispatch table
+ */
+const apt_usbtrx_msg_entry_t ep1_ag08a_msg_table[APT_USBTRX_MSG_ID_MAX] = {
+	APT_USBTRX_MSG_COMMON_ENTRIES,
+	APT_USBTRX_MSG_HANDLER(EP1_AG08A_CMD_NotifyAnalogInput, ep1_ag08a_dispatch_analog_input),
+	APT_USBTRX_MSG_RESPONSE(EP1_AG08A_CMD_ResponseGetStatus, EP1_AG08A_CMD_GetStatus),
+};
+
 /*!
  * @brief write bulk callback
  */
-void ep1_ag08a_write_bulk_callback(struct urb *urb)
+void ep1_ag08a_write_bulk_callback(apt_usbtrx_dev_t *dev, int msg_count, int status)
 {
 	return;
 }
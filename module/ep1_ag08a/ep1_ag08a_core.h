@@ -11,13 +11,13 @@
 #include "../apt_usbtrx_msg.h"
 
 /*!
- * @brief unique function prototype
+ * @brief message dispatch table
  */
-int ep1_ag08a_dispatch_msg(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_t *msg);
+extern const apt_usbtrx_msg_entry_t ep1_ag08a_msg_table[APT_USBTRX_MSG_ID_MAX];
 
 /*!
  * @brief write bulk callback
  */
-void ep1_ag08a_write_bulk_callback(struct urb *urb);
+void ep1_ag08a_write_bulk_callback(apt_usbtrx_dev_t *dev, int msg_count, int status);
 
 #endif /* __EP1_AG08A_CORE_H__ */
@@ -8,6 +8,7 @@
 #define __EP1_AG08A_DEF_H__
 
 #include <linux/types.h>
+#include <linux/mutex.h>
 #include <linux/iio/iio.h>
 
 /*!
@@ -27,6 +28,7 @@
 #define EP1_AG08A_FW_DATA_SIZE (192 * 1024)
 #define EP1_AG08A_CH_NUM (8)
 #define EP1_AG08A_RXDATA_BUFFER_SIZE (64 * 1024)
+#define EP1_AG08A_TXDATA_BUFFER_SIZE (4 * 1024) /* write is not supported */
 #define EP1_AG08A_IIO_DATA_SIZE (sizeof(u16) * EP1_AG08A_CH_NUM + sizeof(s64))
 /*!
  * @brief interface type
@@ -36,9 +38,14 @@ enum EP1_AG08A_IF_TYPE { EP1_AG08A_IF_TYPE_NONE, EP1_AG08A_IF_TYPE_FILE, EP1_AG0
 /*!
  * @brief device unique data
  */
+struct ep1_ag08a_msg_resp_get_status_s;
+
 struct ep1_ag08a_unique_data_s {
 	atomic_t if_type;
 	struct iio_dev *indio_dev;
+	struct mutex status_lock; /*!< protects status_valid and status_cache */
+	bool status_valid; /*!< */
+	struct ep1_ag08a_msg_resp_get_status_s *status_cache; /*!< last known device status */
 };
 typedef struct ep1_ag08a_unique_data_s ep1_ag08a_unique_data_t;
 
@@ -6,18 +6,10 @@
  */
 
 #include <linux/uaccess.h>
+#include <linux/bitops.h>
 
 #include "ep1_ag08a_fops.h"
 
-static int count_bits(int n)
-{
-	int sum;
-	sum = (n >> 1) & 03333333333;
-	sum = n - sum - ((sum >> 1) & 03333333333);
-	sum = ((sum + (sum >> 3)) & 0707070707) % 077;
-	return sum;
-}
-
 /*!
  * @brief get read-payload size
  *
@@ -41,7 +33,7 @@ int ep1_ag08a_get_read_payload_size(const void *payload)
 		return -1;
 	}
 
-	no_data_ch_count = 8 - count_bits(p->channel);
+	no_data_ch_count = 8 - hweight8(p->channel);
 	cmd_size = EP1_AG08A_CMD_LENGTH_NOTIFY_ANALOG_INPUT - (sizeof(u16) * no_data_ch_count);
 
 	return APT_USBTRX_MSG_LENGTH_TO_PAYLOAD(cmd_size);
@@ -61,24 +53,6 @@ int ep1_ag08a_get_write_payload_size(const void *payload)
 	return -1;
 }
 
-/*!
- * @brief get read-payload timestamp
- *
- * FIXME: It is assumed that it can be acquired
- */
-apt_usbtrx_timestamp_t *ep1_ag08a_get_read_payload_timestamp(const void *payload)
-{
-	ep1_ag08a_payload_notify_analog_input_t *read_payload;
-
-	if (payload == NULL) {
-		return NULL;
-	}
-
-	read_payload = (ep1_ag08a_payload_notify_analog_input_t *)payload;
-
-	return &read_payload->timestamp;
-}
-
 /*!
  * @brief get write cmd id
  */
@@ -111,9 +85,9 @@ long ep1_ag08a_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		ep1_ag08a_msg_resp_get_status_t status;
 		int ch;
 
-		result = ep1_ag08a_get_status(dev, &status);
+		result = ep1_ag08a_refresh_cached_status(dev, &status);
 		if (result != RESULT_Success) {
-			EMSG("ep1_ag08a_get_status().. Error");
+			EMSG("ep1_ag08a_refresh_cached_status().. Error");
 			return -EIO;
 		}
 
@@ -248,6 +222,7 @@ long ep1_ag08a_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
  */
 int ep1_ag08a_set_device_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_input_t *cfg)
 {
+	ep1_ag08a_unique_data_t *unique_data = get_unique_data(dev);
 	int result;
 	bool start = true;
 	bool success = false;
@@ -266,6 +241,7 @@ int ep1_ag08a_set_device_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_i
 	result = ep1_ag08a_set_analog_input(dev, cfg, &success);
 	if (result != RESULT_Success) {
 		EMSG("ep1_ag08a_set_analog_input().. Error");
+		ep1_ag08a_invalidate_cached_status(dev);
 		return RESULT_Failure;
 	}
 	if (success != true) {
@@ -273,6 +249,10 @@ int ep1_ag08a_set_device_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_i
 		return RESULT_Failure;
 	}
 
+	mutex_lock(&unique_data->status_lock);
+	unique_data->status_cache->in.cfg = *cfg;
+	mutex_unlock(&unique_data->status_lock);
+
 	return RESULT_Success;
 }
 
@@ -281,6 +261,7 @@ int ep1_ag08a_set_device_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_i
  */
 int ep1_ag08a_set_device_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_output_t *cfg)
 {
+	ep1_ag08a_unique_data_t *unique_data = get_unique_data(dev);
 	int result;
 	bool start = true;
 	bool success = false;
@@ -299,6 +280,7 @@ int ep1_ag08a_set_device_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_
 	result = ep1_ag08a_set_analog_output(dev, cfg, &success);
 	if (result != RESULT_Success) {
 		EMSG("ep1_ag08a_set_analog_output().. Error");
+		ep1_ag08a_invalidate_cached_status(dev);
 		return RESULT_Failure;
 	}
 	if (success != true) {
@@ -306,6 +288,10 @@ int ep1_ag08a_set_device_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_
 		return RESULT_Failure;
 	}
 
+	mutex_lock(&unique_data->status_lock);
+	unique_data->status_cache->out.cfg = *cfg;
+	mutex_unlock(&unique_data->status_lock);
+
 	return RESULT_Success;
 }
 
@@ -314,12 +300,14 @@ int ep1_ag08a_set_device_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_set_analog_
  */
 int ep1_ag08a_control_device_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control_analog_input_t *ctrl)
 {
+	ep1_ag08a_unique_data_t *unique_data = get_unique_data(dev);
 	int result;
 	bool success = false;
 
 	result = ep1_ag08a_control_analog_input(dev, ctrl, &success);
 	if (result != RESULT_Success) {
 		EMSG("ep1_ag08a_control_analog_input().. Error");
+		ep1_ag08a_invalidate_cached_status(dev);
 		return RESULT_Failure;
 	}
 	if (success != true) {
@@ -327,6 +315,10 @@ int ep1_ag08a_control_device_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control_
 		return RESULT_Failure;
 	}
 
+	mutex_lock(&unique_data->status_lock);
+	unique_data->status_cache->in.ctrl = *ctrl;
+	mutex_unlock(&unique_data->status_lock);
+
 	return RESULT_Success;
 }
 
@@ -335,12 +327,14 @@ int ep1_ag08a_control_device_input(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control_
  */
 int ep1_ag08a_control_device_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control_analog_output_t *ctrl)
 {
+	ep1_ag08a_unique_data_t *unique_data = get_unique_data(dev);
 	int result;
 	bool success = false;
 
 	result = ep1_ag08a_control_analog_output(dev, ctrl, &success);
 	if (result != RESULT_Success) {
 		EMSG("ep1_ag08a_control_analog_output().. Error");
+		ep1_ag08a_invalidate_cached_status(dev);
 		return RESULT_Failure;
 	}
 	if (success != true) {
@@ -348,6 +342,10 @@ int ep1_ag08a_control_device_output(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_control
 		return RESULT_Failure;
 	}
 
+	mutex_lock(&unique_data->status_lock);
+	unique_data->status_cache->out.ctrl = *ctrl;
+	mutex_unlock(&unique_data->status_lock);
+
 	return RESULT_Success;
 }
 
@@ -387,9 +385,9 @@ int ep1_ag08a_is_device_input_start(apt_usbtrx_dev_t *dev, bool *start)
 	int result;
 	int ch;
 
-	result = ep1_ag08a_get_status(dev, &status);
+	result = ep1_ag08a_get_cached_status(dev, &status);
 	if (result != RESULT_Success) {
-		EMSG("ep1_ag08a_get_status().. Error");
+		EMSG("ep1_ag08a_get_cached_status().. Error");
 		return RESULT_Failure;
 	}
 
@@ -412,9 +410,9 @@ int ep1_ag08a_is_device_output_start(apt_usbtrx_dev_t *dev, bool *start)
 	ep1_ag08a_msg_resp_get_status_t status;
 	int result;
 
-	result = ep1_ag08a_get_status(dev, &status);
+	result = ep1_ag08a_get_cached_status(dev, &status);
 	if (result != RESULT_Success) {
-		EMSG("ep1_ag08a_get_status().. Error");
+		EMSG("ep1_ag08a_get_cached_status().. Error");
 		return RESULT_Failure;
 	}
 
@@ -427,6 +425,62 @@ int ep1_ag08a_is_device_output_start(apt_usbtrx_dev_t *dev, bool *start)
 	return RESULT_Success;
 }
 
+/*!
+ * @brief refresh cached device status
+ * NOTE: always reads the status from the device.
+ */
+int ep1_ag08a_refresh_cached_status(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_resp_get_status_t *status)
+{
+	ep1_ag08a_unique_data_t *unique_data = get_unique_data(dev);
+	int result;
+
+	mutex_lock(&unique_data->status_lock);
+	result = ep1_ag08a_get_status(dev, unique_data->status_cache);
+	if (result != RESULT_Success) {
+		EMSG("ep1_ag08a_get_status().. Error");
+		unique_data->status_valid = false;
+		mutex_unlock(&unique_data->status_lock);
+		return RESULT_Failure;
+	}
+	unique_data->status_valid = true;
+	*status = *unique_data->status_cache;
+	mutex_unlock(&unique_data->status_lock);
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief get cached device status
+ * NOTE: reads the status from the device only if the cache is invalid.
+ *       The cache is updated by every successful set/control command.
+ */
+int ep1_ag08a_get_cached_status(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_resp_get_status_t *status)
+{
+	ep1_ag08a_unique_data_t *unique_data = get_unique_data(dev);
+
+	mutex_lock(&unique_data->status_lock);
+	if (unique_data->status_valid == true) {
+		*status = *unique_data->status_cache;
+		mutex_unlock(&unique_data->status_lock);
+		return RESULT_Success;
+	}
+	mutex_unlock(&unique_data->status_lock);
+
+	return ep1_ag08a_refresh_cached_status(dev, status);
+}
+
+/*!
+ * @brief invalidate cached device status
+ */
+void ep1_ag08a_invalidate_cached_status(apt_usbtrx_dev_t *dev)
+{
+	ep1_ag08a_unique_data_t *unique_data = get_unique_data(dev);
+
+	mutex_lock(&unique_data->status_lock);
+	unique_data->status_valid = false;
+	mutex_unlock(&unique_data->status_lock);
+}
+
 /*!
  * @brief open (file operation)
  */
@@ -441,6 +495,7 @@ int ep1_ag08a_open(apt_usbtrx_dev_t *dev)
 	}
 
 	atomic_set(&unique_data->if_type, EP1_AG08A_IF_TYPE_FILE);
+	ep1_ag08a_invalidate_cached_status(dev);
 
 	return 0;
 }
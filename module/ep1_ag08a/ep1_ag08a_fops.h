@@ -15,7 +15,6 @@
  */
 int ep1_ag08a_get_read_payload_size(const void *payload);
 int ep1_ag08a_get_write_payload_size(const void *payload);
-apt_usbtrx_timestamp_t *ep1_ag08a_get_read_payload_timestamp(const void *payload);
 int ep1_ag08a_get_write_cmd_id(void);
 int ep1_ag08a_get_fw_size(void);
 long ep1_ag08a_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
@@ -27,6 +26,9 @@ int ep1_ag08a_stop_device_input(apt_usbtrx_dev_t *dev);
 int ep1_ag08a_stop_device_output(apt_usbtrx_dev_t *dev);
 int ep1_ag08a_is_device_input_start(apt_usbtrx_dev_t *dev, bool *start);
 int ep1_ag08a_is_device_output_start(apt_usbtrx_dev_t *dev, bool *start);
+int ep1_ag08a_get_cached_status(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_resp_get_status_t *status);
+int ep1_ag08a_refresh_cached_status(apt_usbtrx_dev_t *dev, ep1_ag08a_msg_resp_get_status_t *status);
+void ep1_ag08a_invalidate_cached_status(apt_usbtrx_dev_t *dev);
 int ep1_ag08a_open(apt_usbtrx_dev_t *dev);
 int ep1_ag08a_close(apt_usbtrx_dev_t *dev);
 
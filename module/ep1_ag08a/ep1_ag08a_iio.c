@@ -86,7 +86,7 @@ static int ep1_ag08a_get_in_volt_range_mode(struct iio_dev *indio_dev, const str
 	int ch = chan->channel;
 	int ret, i, voltage;
 
-	ret = ep1_ag08a_get_status(dev, &status);
+	ret = ep1_ag08a_get_cached_status(dev, &status);
 	if (ret != RESULT_Success) {
 		return -EIO;
 	}
@@ -121,7 +121,7 @@ static int ep1_ag08a_set_in_volt_range_mode(struct iio_dev *indio_dev, const str
 		return -EIO;
 	}
 
-	ret = ep1_ag08a_get_status(dev, &status);
+	ret = ep1_ag08a_get_cached_status(dev, &status);
 	if (ret != RESULT_Success) {
 		return -EIO;
 	}
@@ -149,7 +149,7 @@ static int ep1_ag08a_get_in_volt_samp_freq_mode(struct iio_dev *indio_dev, const
 	ep1_ag08a_msg_resp_get_status_t status;
 	int ret, i;
 
-	ret = ep1_ag08a_get_status(dev, &status);
+	ret = ep1_ag08a_get_cached_status(dev, &status);
 	if (ret != RESULT_Success) {
 		return -EIO;
 	}
@@ -181,7 +181,7 @@ static int ep1_ag08a_set_in_volt_samp_freq_mode(struct iio_dev *indio_dev, const
 		return -EIO;
 	}
 
-	ret = ep1_ag08a_get_status(dev, &status);
+	ret = ep1_ag08a_get_cached_status(dev, &status);
 	if (ret != RESULT_Success) {
 		return -EIO;
 	}
@@ -203,7 +203,7 @@ static int ep1_ag08a_get_out_volt_waveform_type_mode(struct iio_dev *indio_dev,
 	ep1_ag08a_msg_resp_get_status_t status;
 	int ret, i;
 
-	ret = ep1_ag08a_get_status(dev, &status);
+	ret = ep1_ag08a_get_cached_status(dev, &status);
 	if (ret != RESULT_Success) {
 		return -EIO;
 	}
@@ -235,7 +235,7 @@ static int ep1_ag08a_set_out_volt_waveform_type_mode(struct iio_dev *indio_dev,
 		return -EIO;
 	}
 
-	ret = ep1_ag08a_get_status(dev, &status);
+	ret = ep1_ag08a_get_cached_status(dev, &status);
 	if (ret != RESULT_Success) {
 		return -EIO;
 	}
@@ -369,7 +369,7 @@ static int ep1_ag08a_read_raw(struct iio_dev *indio_dev, struct iio_chan_spec co
 	int ret;
 	int ch = chan->channel;
 
-	ret = ep1_ag08a_get_status(dev, &status);
+	ret = ep1_ag08a_get_cached_status(dev, &status);
 	if (ret != RESULT_Success) {
 		return -EIO;
 	}
@@ -421,7 +421,7 @@ static int ep1_ag08a_write_raw(struct iio_dev *indio_dev, struct iio_chan_spec c
 	ep1_ag08a_msg_resp_get_status_t status;
 	int ret;
 
-	ret = ep1_ag08a_get_status(dev, &status);
+	ret = ep1_ag08a_get_cached_status(dev, &status);
 	if (ret != RESULT_Success) {
 		return -EIO;
 	}
@@ -487,7 +487,7 @@ static int ep1_ag08a_buffer_postenable(struct iio_dev *indio_dev)
 	ep1_ag08a_msg_resp_get_status_t status;
 	int ch, ret;
 
-	ret = ep1_ag08a_get_status(dev, &status);
+	ret = ep1_ag08a_get_cached_status(dev, &status);
 	if (ret != RESULT_Success) {
 		atomic_set(&unique_data->if_type, EP1_AG08A_IF_TYPE_NONE);
 		return -EIO;
@@ -10,6 +10,7 @@
 #include "ep1_ag08a_main.h"
 #include "ep1_ag08a_def.h"
 #include "ep1_ag08a_iio.h"
+#include "ep1_ag08a_cmd_def.h"
 
 /*!
  * @brief initialize unique data
@@ -32,6 +33,16 @@ int ep1_ag08a_init_data(apt_usbtrx_dev_t *dev)
 	unique_data = get_unique_data(dev);
 	atomic_set(&unique_data->if_type, EP1_AG08A_IF_TYPE_NONE);
 	unique_data->indio_dev = NULL;
+	mutex_init(&unique_data->status_lock);
+	unique_data->status_valid = false;
+
+	unique_data->status_cache = kzalloc(sizeof(ep1_ag08a_msg_resp_get_status_t), GFP_KERNEL);
+	if (unique_data->status_cache == NULL) {
+		EMSG("kzalloc().. Error, <size:%zu>", sizeof(ep1_ag08a_msg_resp_get_status_t));
+		kfree(dev->unique_data);
+		dev->unique_data = NULL;
+		return RESULT_Failure;
+	}
 
 	return RESULT_Success;
 }
@@ -48,6 +59,7 @@ int ep1_ag08a_free_data(apt_usbtrx_dev_t *dev)
 		return RESULT_Failure;
 	}
 
+	kfree(unique_data->status_cache);
 	kfree(unique_data);
 	unique_data = NULL;
 
@@ -23,6 +23,7 @@ static int ep1_cf02a_cmd_common(apt_usbtrx_dev_t *dev, void *req_message, void *
 				unsigned int timeout_msec)
 {
 	int result;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	char *resp_data;
 	apt_usbtrx_msg_t req_msg;
@@ -31,18 +32,9 @@ static int ep1_cf02a_cmd_common(apt_usbtrx_dev_t *dev, void *req_message, void *
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = req_cmd_id;
@@ -51,8 +43,7 @@ static int ep1_cf02a_cmd_common(apt_usbtrx_dev_t *dev, void *req_message, void *
 		result = pack_req(req_message, req_msg.payload, req_msg.payload_size);
 		if (result != RESULT_Success) {
 			EMSG("pack_req().. Error");
-			kfree(req_data);
-			kfree(resp_data);
+			apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 			return RESULT_Failure;
 		}
 	}
@@ -60,16 +51,14 @@ static int ep1_cf02a_cmd_common(apt_usbtrx_dev_t *dev, void *req_message, void *
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -78,16 +67,14 @@ static int ep1_cf02a_cmd_common(apt_usbtrx_dev_t *dev, void *req_message, void *
 					     timeout_msec);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -95,22 +82,19 @@ static int ep1_cf02a_cmd_common(apt_usbtrx_dev_t *dev, void *req_message, void *
 		result = parse_resp(resp_msg.payload, resp_msg.payload_size, resp_message);
 		if (result != RESULT_Success) {
 			EMSG("parse_resp().. Error");
-			kfree(req_data);
-			kfree(resp_data);
+			apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 			return RESULT_Failure;
 		}
 	} else {
 		result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &resp_id);
 		if (result != RESULT_Success) {
 			EMSG("apt_usbtrx_msg_parse_ack().. Error");
-			kfree(req_data);
-			kfree(resp_data);
+			apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 			return RESULT_Failure;
 		}
 		if (resp_id != req_cmd_id) {
 			EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, resp_id);
-			kfree(req_data);
-			kfree(resp_data);
+			apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 			return RESULT_Failure;
 		}
 
@@ -124,8 +108,7 @@ static int ep1_cf02a_cmd_common(apt_usbtrx_dev_t *dev, void *req_message, void *
 		}
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -217,8 +200,10 @@ int ep1_cf02a_set_iso_mode(apt_usbtrx_dev_t *dev, ep1_cf02a_msg_set_iso_mode_t *
 				    EP1_CF02A_CMD_FLASH_MEMORY_WRITE_RECV_TIMEOUT);
 }
 
-static int ep1_cf02a_check_bit_timing(const struct can_bittiming_const *btc,
-				      const ep1_cf02a_msg_set_bit_timing_t *timing)
+/*!
+ * @brief check bit timing against the device constants
+ */
+int ep1_cf02a_check_bit_timing(const struct can_bittiming_const *btc, const ep1_cf02a_msg_set_bit_timing_t *timing)
 {
 	uint32_t timing_tseg1 = timing->prop_seg + timing->phase_seg1;
 	uint32_t timing_tseg2 = timing->phase_seg2;
@@ -618,3 +603,168 @@ int ep1_cf02a_reset_can_statistics(apt_usbtrx_dev_t *dev, bool *success)
 	return ep1_cf02a_set_common(dev, NULL, EP1_CF02A_CMD_LENGTH_RESET_CAN_STATISTICS,
 				    EP1_CF02A_CMD_ResetCanStatistics, NULL, success, APT_USBTRX_RECV_TIMEOUT);
 }
+
+/*!
+ * @brief set command definition (ep1_cf02a_set_multi())
+ */
+struct ep1_cf02a_set_cmd_s {
+	int cmd_id;
+	int data_size;
+	int (*pack_req)(void *req_message, u8 *data, int data_size);
+};
+typedef struct ep1_cf02a_set_cmd_s ep1_cf02a_set_cmd_t;
+
+static const ep1_cf02a_set_cmd_t ep1_cf02a_set_cmds[] = {
+	{ EP1_CF02A_CMD_SetSilentMode, EP1_CF02A_CMD_LENGTH_SET_SILENT_MODE, ep1_cf02a_msg_pack_set_silent_mode },
+	{ EP1_CF02A_CMD_SetFDMode, EP1_CF02A_CMD_LENGTH_SET_FD_MODE, ep1_cf02a_msg_pack_set_fd_mode },
+	{ EP1_CF02A_CMD_SetISOMode, EP1_CF02A_CMD_LENGTH_SET_ISO_MODE, ep1_cf02a_msg_pack_set_iso_mode },
+	{ EP1_CF02A_CMD_SetBitTiming, EP1_CF02A_CMD_LENGTH_SET_BIT_TIMING, ep1_cf02a_msg_pack_set_bit_timing },
+	{ EP1_CF02A_CMD_SetDataBitTiming, EP1_CF02A_CMD_LENGTH_SET_DATA_BIT_TIMING,
+	  ep1_cf02a_msg_pack_set_data_bit_timing },
+	{ EP1_CF02A_CMD_SetStoreEnable, EP1_CF02A_CMD_LENGTH_SET_STORE_ENABLE, ep1_cf02a_msg_pack_set_store_enable },
+	{ EP1_CF02A_CMD_SetStoreMaxDuration, EP1_CF02A_CMD_LENGTH_SET_STORE_MAX_DURATION,
+	  ep1_cf02a_msg_pack_set_store_max_duration },
+};
+
+/*!
+ * @brief find set command definition
+ */
+static const ep1_cf02a_set_cmd_t *ep1_cf02a_find_set_cmd(int cmd_id)
+{
+	int idx;
+
+	for (idx = 0; idx < ARRAY_SIZE(ep1_cf02a_set_cmds); idx++) {
+		if (ep1_cf02a_set_cmds[idx].cmd_id == cmd_id) {
+			return &ep1_cf02a_set_cmds[idx];
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * @brief update driver state after a successful set command
+ */
+static void ep1_cf02a_set_multi_update(apt_usbtrx_dev_t *dev, const ep1_cf02a_set_req_t *req)
+{
+	ep1_cf02a_unique_data_t *unique_data = get_unique_data(dev);
+
+	if (req->success != true) {
+		return;
+	}
+
+	switch (req->cmd_id) {
+	case EP1_CF02A_CMD_SetBitTiming:
+		memcpy(unique_data->bittiming, req->message, sizeof(ep1_cf02a_msg_bit_timing_t));
+		break;
+	case EP1_CF02A_CMD_SetDataBitTiming:
+		memcpy(unique_data->data_bittiming, req->message, sizeof(ep1_cf02a_msg_bit_timing_t));
+		break;
+	}
+}
+
+/*!
+ * @brief set multiple settings
+ * NOTE: All requests are sent as one pipelined burst and the responses are collected afterwards,
+ *       the device applies them in the given order. reqs[n].success reports ACK/NACK of each one.
+ */
+int ep1_cf02a_set_multi(apt_usbtrx_dev_t *dev, ep1_cf02a_set_req_t *reqs, int count)
+{
+	const ep1_cf02a_set_cmd_t *cmd;
+	apt_usbtrx_cmd_req_t *cmd_reqs;
+	apt_usbtrx_cmd_req_t **cmd_req_list;
+	apt_usbtrx_msg_t msg;
+	u8 *data;
+	int offset = 0;
+	int result;
+	int resp_id;
+	int idx;
+
+	CHKMSG("ENTER");
+
+	for (idx = 0; idx < count; idx++) {
+		if (ep1_cf02a_find_set_cmd(reqs[idx].cmd_id) == NULL) {
+			EMSG("not supported, <id:0x%02x>", reqs[idx].cmd_id);
+			return RESULT_Failure;
+		}
+		reqs[idx].success = false;
+	}
+
+	if (atomic_read(&dev->rx_ongoing) != true) {
+		/* no rx urb to complete pipelined requests, send one by one */
+		for (idx = 0; idx < count; idx++) {
+			cmd = ep1_cf02a_find_set_cmd(reqs[idx].cmd_id);
+			result = ep1_cf02a_set_common(dev, reqs[idx].message, cmd->data_size, cmd->cmd_id,
+						      cmd->pack_req, &reqs[idx].success,
+						      EP1_CF02A_CMD_FLASH_MEMORY_WRITE_RECV_TIMEOUT);
+			if (result != RESULT_Success) {
+				EMSG("ep1_cf02a_set_common().. Error, <id:0x%02x>", cmd->cmd_id);
+				return result;
+			}
+			ep1_cf02a_set_multi_update(dev, &reqs[idx]);
+		}
+		CHKMSG("LEAVE");
+		return RESULT_Success;
+	}
+
+	cmd_reqs = kcalloc(count, sizeof(apt_usbtrx_cmd_req_t), GFP_KERNEL);
+	cmd_req_list = kcalloc(count, sizeof(apt_usbtrx_cmd_req_t *), GFP_KERNEL);
+	data = kzalloc(count * APT_USBTRX_CMD_MAX_LENGTH, GFP_KERNEL);
+	if (cmd_reqs == NULL || cmd_req_list == NULL || data == NULL) {
+		EMSG("kzalloc().. Error");
+		result = RESULT_Failure;
+		goto out;
+	}
+
+	/*** request ***/
+	for (idx = 0; idx < count; idx++) {
+		cmd = ep1_cf02a_find_set_cmd(reqs[idx].cmd_id);
+
+		msg.id = cmd->cmd_id;
+		msg.payload_size = APT_USBTRX_MSG_LENGTH_TO_PAYLOAD(cmd->data_size);
+		result = cmd->pack_req(reqs[idx].message, msg.payload, msg.payload_size);
+		if (result != RESULT_Success) {
+			EMSG("pack_req().. Error, <id:0x%02x>", cmd->cmd_id);
+			goto out;
+		}
+		result = apt_usbtrx_msg_pack(&msg, &data[offset], cmd->data_size);
+		if (result != RESULT_Success) {
+			EMSG("apt_usbtrx_msg_pack().. Error, <id:0x%02x>", cmd->cmd_id);
+			goto out;
+		}
+
+		apt_usbtrx_cmd_req_init(&cmd_reqs[idx], &data[offset], cmd->data_size,
+					EP1_CF02A_CMD_FLASH_MEMORY_WRITE_RECV_TIMEOUT, NULL, NULL);
+		cmd_req_list[idx] = &cmd_reqs[idx];
+		offset += cmd->data_size;
+	}
+
+	result = apt_usbtrx_cmd_exec(dev, cmd_req_list, count);
+	if (result != RESULT_Success) {
+		EMSG("apt_usbtrx_cmd_exec().. Error");
+	}
+
+	/*** response ***/
+	for (idx = 0; idx < count; idx++) {
+		if (cmd_reqs[idx].status != RESULT_Success) {
+			continue;
+		}
+		if (apt_usbtrx_msg_parse(cmd_reqs[idx].resp, cmd_reqs[idx].resp_size, &msg) != RESULT_Success ||
+		    apt_usbtrx_msg_parse_ack(msg.payload, msg.payload_size, &resp_id) != RESULT_Success ||
+		    resp_id != reqs[idx].cmd_id) {
+			EMSG("%s(): invalid ack/nack, <id:0x%02x>", __func__, reqs[idx].cmd_id);
+			result = RESULT_Failure;
+			continue;
+		}
+		reqs[idx].success = (msg.id == APT_USBTRX_CMD_ACK);
+		ep1_cf02a_set_multi_update(dev, &reqs[idx]);
+	}
+
+out:
+	kfree(data);
+	kfree(cmd_req_list);
+	kfree(cmd_reqs);
+
+	CHKMSG("LEAVE");
+	return result;
+}
@@ -5,8 +5,19 @@
 #ifndef __EP1_CF02A_CMD_H__
 #define __EP1_CF02A_CMD_H__
 
+#include <linux/can/netlink.h>
 #include "ep1_cf02a_cmd_def.h"
 
+/*!
+ * @brief set request (ep1_cf02a_set_multi())
+ */
+struct ep1_cf02a_set_req_s {
+	int cmd_id; /*!< EP1_CF02A_CMD_Set* */
+	void *message; /*!< ep1_cf02a_msg_set_*_t of cmd_id */
+	bool success; /*!< [OUT] ACK:true, NACK:false */
+};
+typedef struct ep1_cf02a_set_req_s ep1_cf02a_set_req_t;
+
 /*!
  * @brief get silent mode
  */
@@ -178,4 +189,14 @@ int ep1_cf02a_get_can_statistics(apt_usbtrx_dev_t *dev, ep1_cf02a_msg_get_can_st
  */
 int ep1_cf02a_reset_can_statistics(apt_usbtrx_dev_t *dev, bool *success);
 
+/*!
+ * @brief check bit timing against the device constants
+ */
+int ep1_cf02a_check_bit_timing(const struct can_bittiming_const *btc, const ep1_cf02a_msg_set_bit_timing_t *timing);
+
+/*!
+ * @brief set multiple settings
+ */
+int ep1_cf02a_set_multi(apt_usbtrx_dev_t *dev, ep1_cf02a_set_req_t *reqs, int count);
+
 #endif /* __EP1_CF02A_CMD_H__ */
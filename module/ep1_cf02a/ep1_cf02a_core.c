@@ -7,21 +7,11 @@
 #include <linux/version.h>
 #include <linux/can/dev.h>
 
+#include "../apt_usbtrx_core.h" /* apt_usbtrx_complete_echo_skb(), apt_usbtrx_free_echo_skb() */
 #include "ep1_cf02a_core.h"
 #include "ep1_cf02a_cmd_def.h"
 #include "ep1_cf02a_msg.h"
 
-static void ep1_cf02a_dispatch_msg_common_response(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_t *msg,
-						   int request_id)
-{
-	if (dev->rx_complete.id == request_id) {
-		DMSG("complete! <id:0x%02x> length=%d", msg->id, APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size));
-		dev->rx_complete.data_size = APT_USBTRX_PAYLOAD_LENGTH_TO_MSG(msg->payload_size);
-		memcpy(dev->rx_complete.buffer, data, dev->rx_complete.data_size);
-		complete(&dev->rx_complete.complete);
-	}
-}
-
 #ifdef SUPPORT_NETDEV
 /*!
  * @brief dispatch message
@@ -42,6 +32,7 @@ static void ep1_cf02a_rx_can_msg(apt_usbtrx_dev_t *dev, ep1_cf02a_payload_notify
 		return;
 	}
 
+	apt_usbtrx_add_clock_sample(dev, &recv_can_frame->timestamp);
 	apt_usbtrx_convert_timestamp_to_timespec64(&recv_can_frame->timestamp, &ts);
 	ts = timespec64_sub(ts, candev->reset_ts);
 
@@ -109,124 +100,123 @@ static void ep1_cf02a_rx_can_msg(apt_usbtrx_dev_t *dev, ep1_cf02a_payload_notify
 #endif
 
 /*!
- * @brief dispatch message
+ * @brief dispatch NotifyRecvCANFrame (message handler)
  */
-int ep1_cf02a_dispatch_msg(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_t *msg)
+static int ep1_cf02a_dispatch_recv_can_frame(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg)
 {
 	ep1_cf02a_unique_data_t *unique_data = get_unique_data(dev);
-
-	switch (msg->id) {
-	case EP1_CF02A_CMD_NotifyRecvCANFrame: {
-		int if_type = atomic_read(&unique_data->if_type);
-
-		if (if_type == EP1_CF02A_IF_TYPE_FILE) {
-			apt_usbtrx_ringbuffer_write(&dev->rx_data, msg->payload, msg->payload_size);
-			wake_up_interruptible(&dev->rx_data.wq);
-		} else if (if_type == EP1_CF02A_IF_TYPE_NET) {
+	ep1_cf02a_payload_notify_recv_can_frame_t *recv_can_frame =
+		(ep1_cf02a_payload_notify_recv_can_frame_t *)msg->payload;
+	int if_type = atomic_read(&unique_data->if_type);
+
+	if (if_type == EP1_CF02A_IF_TYPE_FILE) {
+		u32 can_id = recv_can_frame->id[0] | recv_can_frame->id[1] << 8 | recv_can_frame->id[2] << 16 |
+			     (u32)recv_can_frame->id[3] << 24;
+
+		apt_usbtrx_rx_capture_match_can_id(dev, can_id);
+		apt_usbtrx_write_rx_data(dev, &recv_can_frame->timestamp, msg->payload, msg->payload_size);
+		apt_usbtrx_notify_rx_data(dev);
+	} else if (if_type == EP1_CF02A_IF_TYPE_NET) {
 #ifdef SUPPORT_NETDEV
-			ep1_cf02a_rx_can_msg(dev, (ep1_cf02a_payload_notify_recv_can_frame_t *)msg->payload);
+		ep1_cf02a_rx_can_msg(dev, recv_can_frame);
 #endif
-		}
-		break;
-	}
-	case EP1_CF02A_CMD_NotifyStoreDataRecvCanFrame: {
-		ssize_t write_size =
-			apt_usbtrx_ringbuffer_write(&unique_data->rx_store_data, msg->payload, msg->payload_size);
-		if (write_size > 0) {
-			atomic_add(write_size, &unique_data->received_store_data_size);
-		}
-		wake_up_interruptible(&unique_data->rx_store_data.wq);
-		break;
 	}
-	case EP1_CF02A_CMD_NotifyStoreDataRecvCanFrameComplete:
-		unique_data->notify_store_data_recv_can_frame_complete = true;
-		wake_up_interruptible(&unique_data->rx_store_data.wq);
-		break;
-	case EP1_CF02A_CMD_ResponseGetSilentMode:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetSilentMode);
-		break;
-	case EP1_CF02A_CMD_ResponseGetFDMode:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetFDMode);
-		break;
-	case EP1_CF02A_CMD_ResponseGetISOMode:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetISOMode);
-		break;
-	case EP1_CF02A_CMD_ResponseGetBitTiming:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetBitTiming);
-		break;
-	case EP1_CF02A_CMD_ResponseGetDataBitTiming:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetDataBitTiming);
-		break;
-	case EP1_CF02A_CMD_ResponseGetTxRxControl:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetTxRxControl);
-		break;
-	case EP1_CF02A_CMD_ResponseGetCANClock:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetCANClock);
-		break;
-	case EP1_CF02A_CMD_ResponseGetDeviceTimestampResetTime:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetDeviceTimestampResetTime);
-		break;
-	case EP1_CF02A_CMD_ResponseGetRTCTime:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetRTCTime);
-		break;
-	case EP1_CF02A_CMD_ResponseGetCurrentStoreDataState:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetCurrentStoreDataState);
-		break;
-	case EP1_CF02A_CMD_ResponseGetStoreDataIDListCount:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetStoreDataIDListCount);
-		break;
-	case EP1_CF02A_CMD_ResponseGetStoreDataID:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetStoreDataID);
-		break;
-	case EP1_CF02A_CMD_ResponseGetStoreDataMeta:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetStoreDataMeta);
-		break;
-	case EP1_CF02A_CMD_ResponseGetStoreDataRxControl:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetStoreDataRxControl);
-		break;
-	case EP1_CF02A_CMD_ResponseGetStoreEnable:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetStoreEnable);
-		break;
-	case EP1_CF02A_CMD_ResponseGetStoreMaxDuration:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetStoreMaxDuration);
-		break;
-	case EP1_CF02A_CMD_ResponseGetCapabilities:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetCapabilities);
-		break;
-	case EP1_CF02A_CMD_ResponseGetCanStatistics:
-		ep1_cf02a_dispatch_msg_common_response(dev, data, msg, EP1_CF02A_CMD_GetCanStatistics);
-		break;
-	default:
-		WMSG("msg in not support, <id:0x%02x>", msg->id);
-		return RESULT_Failure;
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief dispatch NotifyStoreDataRecvCanFrame (message handler)
+ */
+static int ep1_cf02a_dispatch_store_data_recv_can_frame(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_view_t *msg)
+{
+	ep1_cf02a_unique_data_t *unique_data = get_unique_data(dev);
+	ssize_t write_size = apt_usbtrx_ringbuffer_write(&unique_data->rx_store_data, msg->payload, msg->payload_size);
+
+	if (write_size > 0) {
+		atomic_add(write_size, &unique_data->received_store_data_size);
 	}
+	wake_up_interruptible(&unique_data->rx_store_data.wq);
+
 	return RESULT_Success;
 }
 
+/*!
+ * @brief dispatch NotifyStoreDataRecvCanFrameComplete (message handler)
+ */
+static int ep1_cf02a_dispatch_store_data_recv_can_frame_complete(apt_usbtrx_dev_t *dev, u8 *data,
+								 apt_usbtrx_msg_view_t *msg)
+{
+	ep1_cf02a_unique_data_t *unique_data = get_unique_data(dev);
+
+	unique_data->notify_store_data_recv_can_frame_complete = true;
+	wake_up_interruptible(&unique_data->rx_store_data.wq);
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief message dispatch table
+ */
+const apt_usbtrx_msg_entry_t ep1_cf02a_msg_table[APT_USBTRX_MSG_ID_MAX] = {
+	APT_USBTRX_MSG_COMMON_ENTRIES,
+	APT_USBTRX_MSG_HANDLER(EP1_CF02A_CMD_NotifyRecvCANFrame, ep1_cf02a_dispatch_recv_can_frame),
+	APT_USBTRX_MSG_HANDLER(EP1_CF02A_CMD_NotifyStoreDataRecvCanFrame, ep1_cf02a_dispatch_store_data_recv_can_frame),
+	APT_USBTRX_MSG_HANDLER(EP1_CF02A_CMD_NotifyStoreDataRecvCanFrameComplete,
+			       ep1_cf02a_dispatch_store_data_recv_can_frame_complete),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetSilentMode, EP1_CF02A_CMD_GetSilentMode),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetFDMode, EP1_CF02A_CMD_GetFDMode),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetISOMode, EP1_CF02A_CMD_GetISOMode),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetBitTiming, EP1_CF02A_CMD_GetBitTiming),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetDataBitTiming, EP1_CF02A_CMD_GetDataBitTiming),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetTxRxControl, EP1_CF02A_CMD_GetTxRxControl),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetCANClock, EP1_CF02A_CMD_GetCANClock),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetDeviceTimestampResetTime,
+				EP1_CF02A_CMD_GetDeviceTimestampResetTime),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetRTCTime, EP1_CF02A_CMD_GetRTCTime),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetCurrentStoreDataState, EP1_CF02A_CMD_GetCurrentStoreDataState),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetStoreDataIDListCount, EP1_CF02A_CMD_GetStoreDataIDListCount),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetStoreDataID, EP1_CF02A_CMD_GetStoreDataID),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetStoreDataMeta, EP1_CF02A_CMD_GetStoreDataMeta),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetStoreDataRxControl, EP1_CF02A_CMD_GetStoreDataRxControl),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetStoreEnable, EP1_CF02A_CMD_GetStoreEnable),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetStoreMaxDuration, EP1_CF02A_CMD_GetStoreMaxDuration),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetCapabilities, EP1_CF02A_CMD_GetCapabilities),
+	APT_USBTRX_MSG_RESPONSE(EP1_CF02A_CMD_ResponseGetCanStatistics, EP1_CF02A_CMD_GetCanStatistics),
+};
+
 /*!
  * @brief write bulk callback
+ * NOTE: status is -ECANCELED for messages dropped by the driver.
  */
-void ep1_cf02a_write_bulk_callback(struct urb *urb)
+void ep1_cf02a_write_bulk_callback(apt_usbtrx_dev_t *dev, int msg_count, int status)
 {
 #ifdef SUPPORT_NETDEV
-	apt_usbtrx_dev_t *dev = urb->context;
 	ep1_cf02a_unique_data_t *unique_data = get_unique_data(dev);
 	struct net_device *netdev = unique_data->netdev;
 	ep1_cf02a_candev_t *candev = netdev_priv(netdev);
+	unsigned int packets;
+	u64 bytes;
 
-	if (!netif_device_present(netdev)) {
+	if (atomic_read(&unique_data->if_type) != EP1_CF02A_IF_TYPE_NET) {
 		return;
 	}
 
-	atomic64_inc(&candev->tx_packets);
-	atomic64_add(candev->tx_data_size, &candev->tx_bytes);
+	if (!netif_device_present(netdev)) {
+		return;
+	}
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 12, 0)
-	can_get_echo_skb(netdev, 0, NULL);
-#else
-	can_get_echo_skb(netdev, 0);
-#endif
-	netif_wake_queue(netdev);
+	if (status == 0) {
+		packets = apt_usbtrx_complete_echo_skb(dev, netdev, msg_count, &bytes);
+		atomic64_add(packets, &candev->tx_packets);
+		atomic64_add(bytes, &candev->tx_bytes);
+	} else if (status == -ECANCELED) {
+		packets = apt_usbtrx_free_echo_skb(dev, netdev, msg_count);
+		atomic64_add(packets, &candev->tx_dropped);
+	} else {
+		packets = apt_usbtrx_free_echo_skb(dev, netdev, msg_count);
+		atomic64_add(packets, &candev->tx_errors);
+	}
 #endif
 
 	return;
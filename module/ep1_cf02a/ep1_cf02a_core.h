@@ -10,10 +10,14 @@
 #include "ep1_cf02a_def.h"
 #include "ep1_cf02a.h"
 
+/*!
+ * @brief message dispatch table
+ */
+extern const apt_usbtrx_msg_entry_t ep1_cf02a_msg_table[APT_USBTRX_MSG_ID_MAX];
+
 /*!
  * @brief unique function prototype
  */
-int ep1_cf02a_dispatch_msg(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_t *msg);
-void ep1_cf02a_write_bulk_callback(struct urb *urb);
+void ep1_cf02a_write_bulk_callback(apt_usbtrx_dev_t *dev, int msg_count, int status);
 
 #endif /* __EP1_CF02A_CORE_H__ */
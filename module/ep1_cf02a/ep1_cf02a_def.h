@@ -6,6 +6,7 @@
 #define __EP1_CF02A_DEF_H__
 
 #include <linux/types.h>
+#include <linux/mutex.h>
 #include <linux/netdevice.h>
 #include <linux/can/dev.h>
 #include "ep1_cf02a_cmd_def.h"
@@ -23,6 +24,9 @@
 #define EP1_CF02A_RXDATA_BUFFER_SIZE (128 * 4 * 1024)
 #define EP1_CF02A_STORE_DATA_BUFFER_SIZE (8 * 4 * 1024)
 
+#define EP1_CF02A_STATISTICS_MAX_AGE_MS_DEFAULT (2000)
+#define EP1_CF02A_STATISTICS_MAX_AGE_MS_MAX (60 * 1000)
+
 #define EP1_CF02A_CAN_SYNC_SEG 1
 #define EP1_CF02A_CAN_CALC_MAX_ERROR 50 /* in one-tenth of a percent */
 
@@ -51,6 +55,11 @@ struct ep1_cf02a_unique_data_s {
 	atomic_t if_type;
 	struct net_device *netdev;
 	atomic_t on_terminating;
+	struct mutex statistics_lock; /*!< protects the statistics cache */
+	ep1_cf02a_msg_get_can_statistics_t statistics; /*!< last fetched can statistics */
+	bool statistics_valid; /*!< */
+	unsigned long statistics_updated; /*!< jiffies of the last fetch */
+	unsigned int statistics_max_age_ms; /*!< sysfs statistics_max_age_ms */
 };
 typedef struct ep1_cf02a_unique_data_s ep1_cf02a_unique_data_t;
 
@@ -59,13 +68,14 @@ typedef struct ep1_cf02a_unique_data_s ep1_cf02a_unique_data_t;
  */
 struct ep1_cf02a_candev_s {
 	struct can_priv can; /* must be the first member */
-	u8 tx_data_size;
 	apt_usbtrx_dev_t *dev;
 	struct timespec64 reset_ts;
 	atomic64_t rx_packets;
 	atomic64_t rx_bytes;
 	atomic64_t tx_packets;
 	atomic64_t tx_bytes;
+	atomic64_t tx_dropped;
+	atomic64_t tx_errors;
 	atomic64_t fw_rx_dropped;
 	struct delayed_work statistics_work;
 };
@@ -16,6 +16,7 @@
 #endif
 
 #include "../apt_usbtrx_fops.h" /* apt_usbtrx_write_tx_rb() */
+#include "../apt_usbtrx_core.h" /* apt_usbtrx_put_echo_skb() */
 #include "ep1_cf02a_fops.h"
 #include "ep1_cf02a_cmd_def.h"
 #include "ep1_cf02a_cmd.h"
@@ -47,22 +48,6 @@ int ep1_cf02a_get_write_payload_size(const void *payload)
 	return sizeof(ep1_cf02a_payload_send_can_frame_t);
 }
 
-/*!
- * @brief get read-payload timestamp
- */
-apt_usbtrx_timestamp_t *ep1_cf02a_get_read_payload_timestamp(const void *payload)
-{
-	ep1_cf02a_payload_notify_recv_can_frame_t *read_payload = NULL;
-
-	if (payload == NULL) {
-		return NULL;
-	}
-
-	read_payload = (ep1_cf02a_payload_notify_recv_can_frame_t *)payload;
-
-	return &read_payload->timestamp;
-}
-
 /*!
  * @brief get write cmd id
  */
@@ -1649,6 +1634,173 @@ static long ep1_cf02a_ioctl_set_store_max_duration(apt_usbtrx_dev_t *dev, unsign
 	return 0;
 }
 
+/*!
+ * @brief ioctl - apply config
+ * NOTE: The whole configuration is validated before anything is sent, then the settings are sent
+ *       as one pipelined burst. TX/RX control is applied last, only if all settings were accepted.
+ */
+static long ep1_cf02a_ioctl_apply_config(apt_usbtrx_dev_t *dev, unsigned long arg)
+{
+	ep1_cf02a_unique_data_t *unique_data = get_unique_data(dev);
+	ep1_cf02a_ioctl_apply_config_t param;
+	ep1_cf02a_msg_set_silent_mode_t silent;
+	ep1_cf02a_msg_set_fd_mode_t fd;
+	ep1_cf02a_msg_set_iso_mode_t iso;
+	ep1_cf02a_msg_set_bit_timing_t timing;
+	ep1_cf02a_msg_set_data_bit_timing_t data_timing;
+	ep1_cf02a_msg_set_store_enable_t store_enable;
+	ep1_cf02a_msg_set_store_max_duration_t store_max_duration;
+	ep1_cf02a_set_req_t reqs[7];
+	unsigned int req_fields[7];
+	int count = 0;
+	int result;
+	int idx;
+
+	result = copy_from_user(&param, (void __user *)arg, sizeof(ep1_cf02a_ioctl_apply_config_t));
+	if (result != 0) {
+		EMSG("copy_from_user().. Error");
+		return -EFAULT;
+	}
+	param.failed = 0;
+
+	/*** validate ***/
+	if ((param.mask & ~EP1_CF02A_CONFIG_ALL) != 0) {
+		EMSG("invalid mask, <mask:0x%x>", param.mask);
+		return -EINVAL;
+	}
+	if ((param.mask & EP1_CF02A_CONFIG_BITRATE) && (param.mask & EP1_CF02A_CONFIG_BIT_TIMING)) {
+		EMSG("bitrate and bit timing are exclusive");
+		return -EINVAL;
+	}
+	if ((param.mask & EP1_CF02A_CONFIG_DATA_BITRATE) && (param.mask & EP1_CF02A_CONFIG_DATA_BIT_TIMING)) {
+		EMSG("data bitrate and data bit timing are exclusive");
+		return -EINVAL;
+	}
+
+	if (param.mask & EP1_CF02A_CONFIG_BITRATE) {
+		result = ep1_cf02a_calc_bit_timing(dev, param.bitrate.bitrate, param.bitrate.sample_point,
+						   unique_data->bittiming_const, &timing);
+		if (result != RESULT_Success) {
+			EMSG("ep1_cf02a_calc_bit_timing().. Error");
+			return -EINVAL;
+		}
+	} else if (param.mask & EP1_CF02A_CONFIG_BIT_TIMING) {
+		timing.prop_seg = param.bit_timing.prop_seg;
+		timing.phase_seg1 = param.bit_timing.phase_seg1;
+		timing.phase_seg2 = param.bit_timing.phase_seg2;
+		timing.sjw = param.bit_timing.sjw;
+		timing.brp = param.bit_timing.brp;
+	}
+	if (param.mask & (EP1_CF02A_CONFIG_BITRATE | EP1_CF02A_CONFIG_BIT_TIMING)) {
+		if (ep1_cf02a_check_bit_timing(unique_data->bittiming_const, &timing) != 0) {
+			EMSG("ep1_cf02a_check_bit_timing().. Error");
+			return -EINVAL;
+		}
+	}
+
+	if (param.mask & EP1_CF02A_CONFIG_DATA_BITRATE) {
+		result = ep1_cf02a_calc_bit_timing(dev, param.data_bitrate.bitrate, param.data_bitrate.sample_point,
+						   unique_data->data_bittiming_const, &data_timing);
+		if (result != RESULT_Success) {
+			EMSG("ep1_cf02a_calc_bit_timing().. Error");
+			return -EINVAL;
+		}
+	} else if (param.mask & EP1_CF02A_CONFIG_DATA_BIT_TIMING) {
+		data_timing.prop_seg = param.data_bit_timing.prop_seg;
+		data_timing.phase_seg1 = param.data_bit_timing.phase_seg1;
+		data_timing.phase_seg2 = param.data_bit_timing.phase_seg2;
+		data_timing.sjw = param.data_bit_timing.sjw;
+		data_timing.brp = param.data_bit_timing.brp;
+	}
+	if (param.mask & (EP1_CF02A_CONFIG_DATA_BITRATE | EP1_CF02A_CONFIG_DATA_BIT_TIMING)) {
+		if (ep1_cf02a_check_bit_timing(unique_data->data_bittiming_const, &data_timing) != 0) {
+			EMSG("ep1_cf02a_check_bit_timing().. Error");
+			return -EINVAL;
+		}
+	}
+
+	/*** build requests (in the order the device has to apply them) ***/
+	if (param.mask & EP1_CF02A_CONFIG_FD_MODE) {
+		fd.fd = param.fd;
+		reqs[count].cmd_id = EP1_CF02A_CMD_SetFDMode;
+		reqs[count].message = &fd;
+		req_fields[count++] = EP1_CF02A_CONFIG_FD_MODE;
+	}
+	if (param.mask & EP1_CF02A_CONFIG_ISO_MODE) {
+		iso.non_iso_mode = param.non_iso_mode;
+		reqs[count].cmd_id = EP1_CF02A_CMD_SetISOMode;
+		reqs[count].message = &iso;
+		req_fields[count++] = EP1_CF02A_CONFIG_ISO_MODE;
+	}
+	if (param.mask & EP1_CF02A_CONFIG_SILENT_MODE) {
+		silent.silent = param.silent;
+		reqs[count].cmd_id = EP1_CF02A_CMD_SetSilentMode;
+		reqs[count].message = &silent;
+		req_fields[count++] = EP1_CF02A_CONFIG_SILENT_MODE;
+	}
+	if (param.mask & (EP1_CF02A_CONFIG_BITRATE | EP1_CF02A_CONFIG_BIT_TIMING)) {
+		reqs[count].cmd_id = EP1_CF02A_CMD_SetBitTiming;
+		reqs[count].message = &timing;
+		req_fields[count++] = param.mask & (EP1_CF02A_CONFIG_BITRATE | EP1_CF02A_CONFIG_BIT_TIMING);
+	}
+	if (param.mask & (EP1_CF02A_CONFIG_DATA_BITRATE | EP1_CF02A_CONFIG_DATA_BIT_TIMING)) {
+		reqs[count].cmd_id = EP1_CF02A_CMD_SetDataBitTiming;
+		reqs[count].message = &data_timing;
+		req_fields[count++] =
+			param.mask & (EP1_CF02A_CONFIG_DATA_BITRATE | EP1_CF02A_CONFIG_DATA_BIT_TIMING);
+	}
+	if (param.mask & EP1_CF02A_CONFIG_STORE_ENABLE) {
+		store_enable.enable = param.store_enable;
+		reqs[count].cmd_id = EP1_CF02A_CMD_SetStoreEnable;
+		reqs[count].message = &store_enable;
+		req_fields[count++] = EP1_CF02A_CONFIG_STORE_ENABLE;
+	}
+	if (param.mask & EP1_CF02A_CONFIG_STORE_MAX_DURATION) {
+		store_max_duration.max_duration = param.store_max_duration;
+		reqs[count].cmd_id = EP1_CF02A_CMD_SetStoreMaxDuration;
+		reqs[count].message = &store_max_duration;
+		req_fields[count++] = EP1_CF02A_CONFIG_STORE_MAX_DURATION;
+	}
+
+	/*** apply ***/
+	if (count > 0) {
+		result = ep1_cf02a_set_multi(dev, reqs, count);
+		for (idx = 0; idx < count; idx++) {
+			if (reqs[idx].success != true) {
+				param.failed |= req_fields[idx];
+			}
+		}
+		if (result != RESULT_Success || param.failed != 0) {
+			EMSG("ep1_cf02a_set_multi().. Error, <failed:0x%x>", param.failed);
+			if (copy_to_user((void __user *)arg, &param, sizeof(ep1_cf02a_ioctl_apply_config_t)) != 0) {
+				EMSG("copy_to_user().. Error");
+				return -EFAULT;
+			}
+			return -EIO;
+		}
+	}
+
+	if (param.mask & EP1_CF02A_CONFIG_TX_RX_CONTROL) {
+		if (param.start) {
+			result = ep1_cf02a_start_can_interface(dev);
+		} else {
+			result = ep1_cf02a_stop_can_interface(dev);
+		}
+		if (result != RESULT_Success) {
+			EMSG("ep1_cf02a_%s_can_interface().. Error", param.start ? "start" : "stop");
+			param.failed |= EP1_CF02A_CONFIG_TX_RX_CONTROL;
+		}
+	}
+
+	result = copy_to_user((void __user *)arg, &param, sizeof(ep1_cf02a_ioctl_apply_config_t));
+	if (result != 0) {
+		EMSG("copy_to_user().. Error");
+		return -EFAULT;
+	}
+
+	return param.failed != 0 ? -EIO : 0;
+}
+
 /*!
  * @brief ioctl
  */
@@ -1723,6 +1875,8 @@ long ep1_cf02a_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		return ep1_cf02a_ioctl_get_store_max_duration(dev, arg);
 	case EP1_CF02A_IOCTL_SET_STORE_MAX_DURATION:
 		return ep1_cf02a_ioctl_set_store_max_duration(dev, arg);
+	case EP1_CF02A_IOCTL_APPLY_CONFIG:
+		return ep1_cf02a_ioctl_apply_config(dev, arg);
 	default:
 		EMSG("not supported, <ioctl:0x%02x>", cmd);
 		return -EFAULT;
@@ -2016,6 +2170,8 @@ static int ep1_cf02a_netdev_start(struct net_device *netdev)
 		return -EIO;
 	}
 	apt_usbtrx_convert_timestamp_to_timespec64(&time.ts, &candev->reset_ts);
+	/* the ptp clock follows the hardware timestamps, which are relative to reset_ts */
+	WRITE_ONCE(dev->ptp_offset_us, (s64)time.ts.ts_sec * USEC_PER_SEC + time.ts.ts_usec);
 
 	result = ep1_cf02a_start_can_interface(dev);
 	if (result != RESULT_Success) {
@@ -2045,10 +2201,14 @@ int ep1_cf02a_netdev_open(struct net_device *netdev)
 		return -EBUSY;
 	}
 
+	/* tx_data is not resized while the netdev is open */
+	apt_usbtrx_data_buffer_get(dev);
+
 	/* common open */
 	err = open_candev(netdev);
 	if (err) {
 		netdev_err(netdev, "candev open failed: %d\n", err);
+		apt_usbtrx_data_buffer_put(dev);
 		return err;
 	}
 
@@ -2057,9 +2217,11 @@ int ep1_cf02a_netdev_open(struct net_device *netdev)
 	if (err) {
 		netdev_err(netdev, "couldn't start device: %d\n", err);
 		close_candev(netdev);
+		apt_usbtrx_data_buffer_put(dev);
 		return err;
 	}
 
+	apt_usbtrx_reset_echo_skb(dev);
 	netif_start_queue(netdev);
 
 	/* Start periodic statistics polling */
@@ -2092,6 +2254,7 @@ int ep1_cf02a_netdev_close(struct net_device *netdev)
 
 	candev->can.state = CAN_STATE_STOPPED;
 	atomic_set(&unique_data->if_type, EP1_CF02A_IF_TYPE_NONE);
+	apt_usbtrx_data_buffer_put(dev);
 
 	return 0;
 }
@@ -2158,25 +2321,36 @@ netdev_tx_t ep1_cf02a_netdev_start_xmit(struct sk_buff *skb, struct net_device *
 		tx_data_size = cf->can_dlc;
 	}
 
-	candev->tx_data_size = tx_data_size;
-
-	netif_stop_queue(netdev);
+	/* SOF_TIMESTAMPING_TX_SOFTWARE, before the echo skb may replace skb with a clone */
+	skb_tx_timestamp(skb);
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 12, 0)
-	can_put_echo_skb(skb, netdev, 0, 0);
-#else
-	can_put_echo_skb(skb, netdev, 0);
-#endif
+	result = apt_usbtrx_put_echo_skb(dev, netdev, skb, tx_data_size);
+	if (result != RESULT_Success) {
+		return NETDEV_TX_BUSY;
+	}
 
 	result = apt_usbtrx_write_tx_rb(dev, &send_cf, sizeof(send_cf));
 	if (result < 0) {
 		EMSG("apt_usbtrx_write_tx_rb().. Error");
-		return NETDEV_TX_BUSY;
+		/* the echo skb already owns the frame, drop it instead of requeueing */
+		apt_usbtrx_cancel_echo_skb(dev, netdev);
+		atomic64_inc(&candev->tx_dropped);
+		return NETDEV_TX_OK;
 	}
 
 	return NETDEV_TX_OK;
 }
 
+/*!
+ * @brief get timestamping info (ethtool operation)
+ */
+int ep1_cf02a_netdev_get_ts_info(struct net_device *netdev, apt_usbtrx_ethtool_ts_info_t *info)
+{
+	ep1_cf02a_candev_t *candev = netdev_priv(netdev);
+
+	return apt_usbtrx_ptp_get_ts_info(candev->dev, info);
+}
+
 /*!
  * @brief set mode (netdev)
  */
@@ -2208,6 +2382,69 @@ int ep1_cf02a_netdev_set_mode(struct net_device *netdev, enum can_mode mode)
 	return 0;
 }
 
+/*!
+ * @brief load can statistics from the cache or the device
+ * NOTE: freshness is checked under statistics_lock, so concurrent callers with
+ *       a stale cache send GetCanStatistics only once and the rest share the result.
+ */
+static int ep1_cf02a_load_can_statistics(apt_usbtrx_dev_t *dev, ep1_cf02a_msg_get_can_statistics_t *statistics,
+					 bool use_cache)
+{
+	ep1_cf02a_unique_data_t *unique_data = get_unique_data(dev);
+	unsigned long max_age = msecs_to_jiffies(READ_ONCE(unique_data->statistics_max_age_ms));
+	int result;
+
+	mutex_lock(&unique_data->statistics_lock);
+	if (use_cache == true && unique_data->statistics_valid == true &&
+	    time_before_eq(jiffies, unique_data->statistics_updated + max_age)) {
+		*statistics = unique_data->statistics;
+		mutex_unlock(&unique_data->statistics_lock);
+		return RESULT_Success;
+	}
+
+	result = ep1_cf02a_get_can_statistics(dev, &unique_data->statistics);
+	if (result != RESULT_Success) {
+		unique_data->statistics_valid = false;
+		mutex_unlock(&unique_data->statistics_lock);
+		return result;
+	}
+	unique_data->statistics_valid = true;
+	unique_data->statistics_updated = jiffies;
+	*statistics = unique_data->statistics;
+	mutex_unlock(&unique_data->statistics_lock);
+
+	return RESULT_Success;
+}
+
+/*!
+ * @brief fetch can statistics from the device and update the cache
+ */
+int ep1_cf02a_fetch_can_statistics(apt_usbtrx_dev_t *dev, ep1_cf02a_msg_get_can_statistics_t *statistics)
+{
+	return ep1_cf02a_load_can_statistics(dev, statistics, false);
+}
+
+/*!
+ * @brief get can statistics from the cache
+ * NOTE: fetches from the device only if the cache is older than statistics_max_age_ms.
+ */
+int ep1_cf02a_get_cached_can_statistics(apt_usbtrx_dev_t *dev, ep1_cf02a_msg_get_can_statistics_t *statistics)
+{
+	return ep1_cf02a_load_can_statistics(dev, statistics, true);
+}
+
+/*!
+ * @brief invalidate can statistics cache
+ */
+void ep1_cf02a_invalidate_can_statistics(apt_usbtrx_dev_t *dev)
+{
+	ep1_cf02a_unique_data_t *unique_data = get_unique_data(dev);
+
+	mutex_lock(&unique_data->statistics_lock);
+	unique_data->statistics_valid = false;
+	mutex_unlock(&unique_data->statistics_lock);
+}
+
 /*!
  * @brief statistics work function (periodic polling)
  */
@@ -2230,7 +2467,7 @@ void ep1_cf02a_statistics_work_func(struct work_struct *work)
 		return;
 	}
 
-	result = ep1_cf02a_get_can_statistics(dev, &statistics);
+	result = ep1_cf02a_fetch_can_statistics(dev, &statistics);
 	if (result != RESULT_Success) {
 		/* Keep current state on error */
 		goto reschedule;
@@ -2304,6 +2541,8 @@ ep1_cf02a_netdev_get_stats64(struct net_device *netdev, struct rtnl_link_stats64
 	storage->rx_bytes = atomic64_read(&candev->rx_bytes);
 	storage->tx_bytes = atomic64_read(&candev->tx_bytes);
 	storage->rx_dropped += atomic64_read(&candev->fw_rx_dropped);
+	storage->tx_dropped = atomic64_read(&candev->tx_dropped);
+	storage->tx_errors = atomic64_read(&candev->tx_errors);
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
 	return;
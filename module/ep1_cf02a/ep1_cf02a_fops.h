@@ -10,13 +10,14 @@
 #include <linux/version.h>
 #include <net/rtnetlink.h>
 #include "../apt_usbtrx_def.h"
+#include "../apt_usbtrx_ptp.h"
+#include "ep1_cf02a_cmd_def.h"
 
 /*!
  * @brief unique function prototype
  */
 int ep1_cf02a_get_read_payload_size(const void *payload);
 int ep1_cf02a_get_write_payload_size(const void *payload);
-apt_usbtrx_timestamp_t *ep1_cf02a_get_read_payload_timestamp(const void *payload);
 int ep1_cf02a_get_write_cmd_id(void);
 int ep1_cf02a_get_fw_size(void);
 long ep1_cf02a_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
@@ -34,6 +35,10 @@ int ep1_cf02a_netdev_open(struct net_device *netdev);
 int ep1_cf02a_netdev_close(struct net_device *netdev);
 netdev_tx_t ep1_cf02a_netdev_start_xmit(struct sk_buff *skb, struct net_device *netdev);
 int ep1_cf02a_netdev_set_mode(struct net_device *netdev, enum can_mode mode);
+int ep1_cf02a_netdev_get_ts_info(struct net_device *netdev, apt_usbtrx_ethtool_ts_info_t *info);
+int ep1_cf02a_fetch_can_statistics(apt_usbtrx_dev_t *dev, ep1_cf02a_msg_get_can_statistics_t *statistics);
+int ep1_cf02a_get_cached_can_statistics(apt_usbtrx_dev_t *dev, ep1_cf02a_msg_get_can_statistics_t *statistics);
+void ep1_cf02a_invalidate_can_statistics(apt_usbtrx_dev_t *dev);
 void ep1_cf02a_statistics_work_func(struct work_struct *work);
 int ep1_cf02a_netdev_get_state(const struct net_device *netdev, enum can_state *state);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
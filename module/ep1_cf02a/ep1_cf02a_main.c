@@ -49,6 +49,13 @@ static const struct net_device_ops ep1_cf02a_netdev_ops = {
 	.ndo_get_stats64 = ep1_cf02a_netdev_get_stats64,
 };
 
+/*!
+ * @brief ethtool operation structure
+ */
+static const struct ethtool_ops ep1_cf02a_ethtool_ops = {
+	.get_ts_info = ep1_cf02a_netdev_get_ts_info,
+};
+
 static void ep1_cf02a_bit_timing_to_can_bittiming(apt_usbtrx_dev_t *dev, const ep1_cf02a_msg_bit_timing_t *src,
 						  struct can_bittiming *dst)
 {
@@ -85,7 +92,7 @@ static int ep1_cf02a_create_candev(struct usb_interface *intf, const struct usb_
 	ep1_cf02a_candev_t *candev;
 	int err = 0;
 
-	netdev = alloc_candev(sizeof(ep1_cf02a_candev_t), 1);
+	netdev = alloc_candev(sizeof(ep1_cf02a_candev_t), APT_USBTRX_ECHO_SKB_MAX);
 	if (!netdev) {
 		EMSG("ep1_cf02a_create_candev().. Error, couldn't alloc candev");
 		return -ENOMEM;
@@ -100,6 +107,8 @@ static int ep1_cf02a_create_candev(struct usb_interface *intf, const struct usb_
 	atomic64_set(&candev->rx_bytes, 0);
 	atomic64_set(&candev->tx_packets, 0);
 	atomic64_set(&candev->tx_bytes, 0);
+	atomic64_set(&candev->tx_dropped, 0);
+	atomic64_set(&candev->tx_errors, 0);
 	atomic64_set(&candev->fw_rx_dropped, 0);
 	INIT_DELAYED_WORK(&candev->statistics_work, ep1_cf02a_statistics_work_func);
 
@@ -129,6 +138,7 @@ static int ep1_cf02a_create_candev(struct usb_interface *intf, const struct usb_
 	/* netdev init */
 	netdev->flags |= IFF_ECHO; /* we support local echo */
 	netdev->netdev_ops = &ep1_cf02a_netdev_ops;
+	netdev->ethtool_ops = &ep1_cf02a_ethtool_ops;
 
 	SET_NETDEV_DEV(netdev, &intf->dev);
 	netdev->dev_id = dev->ch;
@@ -214,6 +224,11 @@ int ep1_cf02a_init_data(apt_usbtrx_dev_t *dev)
 	unique_data->netdev = NULL;
 	atomic_set(&unique_data->on_terminating, false);
 
+	mutex_init(&unique_data->statistics_lock);
+	unique_data->statistics_valid = false;
+	unique_data->statistics_updated = jiffies;
+	unique_data->statistics_max_age_ms = EP1_CF02A_STATISTICS_MAX_AGE_MS_DEFAULT;
+
 	return RESULT_Success;
 }
 
@@ -7,6 +7,7 @@
 #include "ep1_cf02a_sysfs.h"
 #include "ep1_cf02a_def.h"
 #include "ep1_cf02a_cmd.h"
+#include "ep1_cf02a_fops.h"
 
 /*!
  * @brief store data enabled
@@ -33,9 +34,9 @@ static ssize_t ep1_cf02a_sysfs_fw_rx_dropped_show(struct device *dev, struct dev
 		return sprintf(buf, "0\n");
 	}
 
-	result = ep1_cf02a_get_can_statistics(usbtrx_dev, &statistics);
+	result = ep1_cf02a_get_cached_can_statistics(usbtrx_dev, &statistics);
 	if (result != RESULT_Success) {
-		EMSG("ep1_cf02a_get_can_statistics().. Error");
+		EMSG("ep1_cf02a_get_cached_can_statistics().. Error");
 		return sprintf(buf, "0\n");
 	}
 
@@ -58,9 +59,9 @@ static ssize_t ep1_cf02a_sysfs_can_state_show(struct device *dev, struct device_
 		return sprintf(buf, "unknown\n");
 	}
 
-	result = ep1_cf02a_get_can_statistics(usbtrx_dev, &statistics);
+	result = ep1_cf02a_get_cached_can_statistics(usbtrx_dev, &statistics);
 	if (result != RESULT_Success) {
-		EMSG("ep1_cf02a_get_can_statistics().. Error");
+		EMSG("ep1_cf02a_get_cached_can_statistics().. Error");
 		return sprintf(buf, "unknown\n");
 	}
 
@@ -102,6 +103,7 @@ static ssize_t ep1_cf02a_sysfs_reset_fw_statistics_store(struct device *dev, str
 	}
 
 	result = ep1_cf02a_reset_can_statistics(usbtrx_dev, &success);
+	ep1_cf02a_invalidate_can_statistics(usbtrx_dev);
 	if (result != RESULT_Success || !success) {
 		EMSG("ep1_cf02a_reset_can_statistics().. Error");
 		return -EIO;
@@ -113,6 +115,38 @@ static ssize_t ep1_cf02a_sysfs_reset_fw_statistics_store(struct device *dev, str
 /* NOTE: writable attrs must be listed in conf/30-apt-usb.rules */
 static DEVICE_ATTR(reset_fw_statistics, S_IWUSR, NULL, ep1_cf02a_sysfs_reset_fw_statistics_store);
 
+/*!
+ * @brief maximum age of the statistics cache (fw_rx_dropped, can_state)
+ */
+static ssize_t ep1_cf02a_sysfs_statistics_max_age_ms_show(struct device *dev, struct device_attribute *attr,
+							  char *buf)
+{
+	apt_usbtrx_dev_t *usbtrx_dev = dev_get_drvdata(dev);
+	ep1_cf02a_unique_data_t *unique_data = get_unique_data(usbtrx_dev);
+
+	return sprintf(buf, "%u\n", READ_ONCE(unique_data->statistics_max_age_ms));
+}
+
+static ssize_t ep1_cf02a_sysfs_statistics_max_age_ms_store(struct device *dev, struct device_attribute *attr,
+							   const char *buf, size_t count)
+{
+	apt_usbtrx_dev_t *usbtrx_dev = dev_get_drvdata(dev);
+	ep1_cf02a_unique_data_t *unique_data = get_unique_data(usbtrx_dev);
+	unsigned int value;
+
+	if (kstrtouint(buf, 10, &value) != 0 || value > EP1_CF02A_STATISTICS_MAX_AGE_MS_MAX) {
+		EMSG("Only 0 to %d available", EP1_CF02A_STATISTICS_MAX_AGE_MS_MAX);
+		return -EINVAL;
+	}
+	WRITE_ONCE(unique_data->statistics_max_age_ms, value);
+
+	return count;
+}
+
+/* NOTE: writable attrs must be listed in conf/30-apt-usb.rules */
+static DEVICE_ATTR(statistics_max_age_ms, S_IWUSR | S_IRUGO, ep1_cf02a_sysfs_statistics_max_age_ms_show,
+		   ep1_cf02a_sysfs_statistics_max_age_ms_store);
+
 /*!
  * @brief can clock
  */
@@ -249,6 +283,10 @@ int ep1_cf02a_sysfs_init(struct device *dev)
 	if (result != 0) {
 		EMSG("device_create_file().. Error, <name:%s>", "reset_fw_statistics");
 	}
+	result = device_create_file(dev, &dev_attr_statistics_max_age_ms);
+	if (result != 0) {
+		EMSG("device_create_file().. Error, <name:%s>", "statistics_max_age_ms");
+	}
 	result = device_create_file(dev, &dev_attr_can_clock);
 	if (result != 0) {
 		EMSG("device_create_file().. Error, <name:%s>", "can_clock");
@@ -312,6 +350,7 @@ int ep1_cf02a_sysfs_term(struct device *dev)
 	device_remove_file(dev, &dev_attr_fw_rx_dropped);
 	device_remove_file(dev, &dev_attr_can_state);
 	device_remove_file(dev, &dev_attr_reset_fw_statistics);
+	device_remove_file(dev, &dev_attr_statistics_max_age_ms);
 	device_remove_file(dev, &dev_attr_can_clock);
 
 	device_remove_file(dev, &dev_attr_bt_prop_seg);
@@ -6,8 +6,6 @@
  * Copyright (C) 2021 aptpod Inc.
  */
 
-#include <linux/slab.h>
-
 #include "../apt_usbtrx_core.h" /* send_msg(), wait_msg() */
 #include "ep1_ch02a_cmd.h"
 #include "ep1_ch02a_msg.h"
@@ -18,6 +16,7 @@
 int ep1_ch02a_get_status(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_resp_get_status_t *status)
 {
 	int req_data_size = EP1_CH02A_CMD_LENGTH_GET_STATUS;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = EP1_CH02A_CMD_LENGTH_RESPONSE_GET_STATUS;
 	char *resp_data;
@@ -27,18 +26,9 @@ int ep1_ch02a_get_status(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_resp_get_status_t
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = EP1_CH02A_CMD_GetStatus;
@@ -46,16 +36,14 @@ int ep1_ch02a_get_status(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_resp_get_status_t
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -64,16 +52,14 @@ int ep1_ch02a_get_status(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_resp_get_status_t
 				     resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -87,13 +73,11 @@ int ep1_ch02a_get_status(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_resp_get_status_t
 	result = ep1_ch02a_msg_parse_response_get_status(resp_msg.payload, resp_msg.payload_size, status);
 	if (result != RESULT_Success) {
 		EMSG("ep1_ch02a_msg_parse_response_get_status().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -105,6 +89,7 @@ int ep1_ch02a_get_status(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_resp_get_status_t
 int ep1_ch02a_set_bit_timing(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_set_bit_timing_t *param, bool *success)
 {
 	int req_data_size = EP1_CH02A_CMD_LENGTH_SET_BIT_TIMING;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = APT_USBTRX_CMD_LENGTH_ACK;
 	char *resp_data;
@@ -115,18 +100,9 @@ int ep1_ch02a_set_bit_timing(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_set_bit_timing
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = EP1_CH02A_CMD_SetBitTiming;
@@ -134,8 +110,7 @@ int ep1_ch02a_set_bit_timing(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_set_bit_timing
 	result = ep1_ch02a_msg_pack_set_bit_timing(param, req_msg.payload, req_msg.payload_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack_set_bit_timing().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -149,16 +124,14 @@ int ep1_ch02a_set_bit_timing(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_set_bit_timing
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -166,30 +139,26 @@ int ep1_ch02a_set_bit_timing(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_set_bit_timing
 	result = apt_usbtrx_wait_msg(dev, APT_USBTRX_CMD_ACK, APT_USBTRX_CMD_NACK, resp_data, resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse_ack(resp_msg.payload, resp_msg.payload_size, &id);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse_ack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	if (id != EP1_CH02A_CMD_SetBitTiming) {
 		EMSG("%s(): ack/nack is not match, <id:0x%02x>", __func__, id);
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 	switch (resp_msg.id) {
@@ -201,8 +170,7 @@ int ep1_ch02a_set_bit_timing(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_set_bit_timing
 		break;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -211,6 +179,7 @@ int ep1_ch02a_set_bit_timing(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_set_bit_timing
 int ep1_ch02a_get_bit_timing(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_resp_get_bit_timing_t *status)
 {
 	int req_data_size = EP1_CH02A_CMD_LENGTH_GET_BIT_TIMING;
+	apt_usbtrx_cmd_buf_t *cmd_buf;
 	char *req_data;
 	int resp_data_size = EP1_CH02A_CMD_LENGTH_RESPONSE_GET_BIT_TIMING;
 	char *resp_data;
@@ -220,18 +189,9 @@ int ep1_ch02a_get_bit_timing(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_resp_get_bit_t
 
 	CHKMSG("ENTER");
 
-	req_data = kzalloc(req_data_size, GFP_KERNEL);
-	if (req_data == NULL) {
-		EMSG("kzalloc().. Error");
-		return RESULT_Failure;
-	}
-
-	resp_data = kzalloc(resp_data_size, GFP_KERNEL);
-	if (resp_data == NULL) {
-		EMSG("kzalloc().. Error");
-		kfree(req_data);
-		return RESULT_Failure;
-	}
+	cmd_buf = apt_usbtrx_cmd_buf_get(dev);
+	req_data = cmd_buf->req;
+	resp_data = cmd_buf->resp;
 
 	/*** request ***/
 	req_msg.id = EP1_CH02A_CMD_GetBitTiming;
@@ -239,16 +199,14 @@ int ep1_ch02a_get_bit_timing(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_resp_get_bit_t
 	result = apt_usbtrx_msg_pack(&req_msg, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_pack().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_send_msg_sync(dev, req_data, req_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_send_msg_sync().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -257,16 +215,14 @@ int ep1_ch02a_get_bit_timing(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_resp_get_bit_t
 				     resp_data_size);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_wait_msg().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
 	result = apt_usbtrx_msg_parse(resp_data, resp_data_size, &resp_msg);
 	if (result != RESULT_Success) {
 		EMSG("apt_usbtrx_msg_parse().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
@@ -280,13 +236,11 @@ int ep1_ch02a_get_bit_timing(apt_usbtrx_dev_t *dev, ep1_ch02a_msg_resp_get_bit_t
 	result = ep1_ch02a_msg_parse_response_get_bit_timing(resp_msg.payload, resp_msg.payload_size, status);
 	if (result != RESULT_Success) {
 		EMSG("ep1_ch02a_msg_parse_response_get_bit_timing().. Error");
-		kfree(req_data);
-		kfree(resp_data);
+		apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 		return RESULT_Failure;
 	}
 
-	kfree(req_data);
-	kfree(resp_data);
+	apt_usbtrx_cmd_buf_put(dev, cmd_buf);
 
 	CHKMSG("LEAVE");
 	return RESULT_Success;
@@ -12,8 +12,8 @@
 #include "../apt_usbtrx_msg.h"
 
 /*!
- * @brief unique function prototype
+ * @brief message dispatch table
  */
-int ep1_ch02a_dispatch_msg(apt_usbtrx_dev_t *dev, u8 *data, apt_usbtrx_msg_t *msg);
+extern const apt_usbtrx_msg_entry_t ep1_ch02a_msg_table[APT_USBTRX_MSG_ID_MAX];
 
 #endif /* __EP1_CH02A_CORE_H__ */
@@ -45,6 +45,13 @@ static const struct net_device_ops ep1_ch02a_netdev_ops = {
 #endif
 };
 
+/*!
+ * @brief ethtool operation structure
+ */
+static const struct ethtool_ops ep1_ch02a_ethtool_ops = {
+	.get_ts_info = apt_usbtrx_unique_can_netdev_get_ts_info,
+};
+
 static const struct can_bittiming_const ep1_ch02a_netdev_bittiming_const = {
 	.name = "ep1_ch02a",
 	.tseg1_min = 1,
@@ -93,7 +100,7 @@ static int ep1_ch02a_create_candev(struct usb_interface *intf, const struct usb_
 	apt_usbtrx_candev_t *candev;
 	int err = 0;
 
-	netdev = alloc_candev(sizeof(apt_usbtrx_candev_t), 1);
+	netdev = alloc_candev(sizeof(apt_usbtrx_candev_t), APT_USBTRX_ECHO_SKB_MAX);
 	if (!netdev) {
 		EMSG("apt_usbtrx_create_candev().. Error, couldn't alloc candev");
 		return -ENOMEM;
@@ -116,6 +123,7 @@ static int ep1_ch02a_create_candev(struct usb_interface *intf, const struct usb_
 	/* netdev init */
 	netdev->flags |= IFF_ECHO; /* we support local echo */
 	netdev->netdev_ops = &ep1_ch02a_netdev_ops;
+	netdev->ethtool_ops = &ep1_ch02a_ethtool_ops;
 
 	SET_NETDEV_DEV(netdev, &intf->dev);
 	netdev->dev_id = dev->ch;